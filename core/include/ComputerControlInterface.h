@@ -28,16 +28,17 @@
 #include <QList>
 #include <QObject>
 #include <QSize>
+#include <QTimer>
 
 #include "Computer.h"
 #include "Feature.h"
+#include "FeatureMessage.h"
 #include "VeyonCore.h"
+#include "VeyonVncConnection.h"
 
 class QImage;
 
 class BuiltinFeatures;
-class FeatureMessage;
-class VeyonVncConnection;
 class VeyonCoreConnection;
 
 class VEYON_CORE_EXPORT ComputerControlInterface : public QObject
@@ -83,10 +84,20 @@ public:
 
 	void setScaledScreenSize( QSize size );
 
+	bool isScreenVisible() const
+	{
+		return m_screenVisible;
+	}
+
+	/** \brief Sets whether the screen is currently visible to the user - updates are reduced for hidden screens */
+	void setScreenVisible( bool visible );
+
 	QImage scaledScreen() const;
 
 	QImage screen() const;
 
+	VeyonVncConnection::Statistics connectionStatistics() const;
+
 	bool hasScreenUpdates() const
 	{
 		return m_screenUpdated;
@@ -118,8 +129,34 @@ public:
 
 	void setDesignatedModeFeature( Feature::Uid designatedModeFeature );
 
+	/** \brief Returns the feature of the last broadcast message not acknowledged by the computer or a null UID */
+	Feature::Uid undeliveredFeature() const
+	{
+		return m_undeliveredFeature;
+	}
+
+	// called by FeatureMessageBroadcast once the delivery of a message has been confirmed or failed
+	void setFeatureMessageDelivered( Feature::Uid featureUid, bool delivered );
+
 	void sendFeatureMessage( const FeatureMessage& featureMessage );
 
+	FeatureMessage::Format featureMessageFormat() const;
+
+	/** \brief Sends feature message serialized via VeyonCoreConnection::serializeFeatureMessage() - returns false if not connected */
+	bool sendSerializedFeatureMessage( const QByteArray& message );
+
+	/** \brief Lets the server confirm that it has processed all messages sent so far
+	 *
+	 * Returns the number passed to featureMessagesAcknowledged() once confirmed or 0 if not connected.
+	 */
+	quint32 requestAcknowledgement();
+
+	// called by FeatureControl for each reply to an active features query
+	void acknowledgeActiveFeaturesQuery();
+
+	// called by FeatureControl and UserSessionControl once the server pushed a notification
+	void setServerNotificationsAvailable();
+
 
 private slots:
 	void setScreenUpdateFlag()
@@ -130,16 +167,25 @@ private slots:
 	void updateState();
 	void updateUser();
 	void updateActiveFeatures();
+	void pollServerState();
 
 	void handleFeatureMessage( const FeatureMessage& message );
 
 private:
+	enum {
+		ServerPollingInterval = 1000
+	};
+
+	void subscribeServerNotifications();
+	void updateFramebufferUpdateInterval();
+
 	Computer m_computer;
 
 	State m_state;
 	QString m_user;
 	FeatureUidList m_activeFeatures;
 	Feature::Uid m_designatedModeFeature;
+	Feature::Uid m_undeliveredFeature;
 
 	QSize m_scaledScreenSize;
 
@@ -148,11 +194,22 @@ private:
 	BuiltinFeatures* m_builtinFeatures;
 
 	bool m_screenUpdated;
+	bool m_screenVisible;
+
+	// the server answers queries in order so each reply confirms all previously sent messages
+	quint32 m_activeFeaturesQueryCount;
+	quint32 m_activeFeaturesReplyCount;
+
+	// servers not supporting notifications have to be polled
+	QTimer m_serverPollingTimer;
 
 signals:
 	void featureMessageReceived( const FeatureMessage&, ComputerControlInterface::Pointer );
+	void featureMessagesAcknowledged( quint32 acknowledgement );
+	void stateChanged();
 	void userChanged();
 	void activeFeaturesChanged();
+	void undeliveredFeatureChanged();
 
 };
 
@@ -25,6 +25,7 @@
 #ifndef FEATURE_CONTROL_H
 #define FEATURE_CONTROL_H
 
+#include "FeatureSubscriptions.h"
 #include "SimpleFeatureProvider.h"
 
 class VEYON_CORE_EXPORT FeatureControl : public QObject, public SimpleFeatureProvider, public PluginInterface
@@ -37,6 +38,9 @@ public:
 
 	bool queryActiveFeatures( const ComputerControlInterfaceList& computerControlInterfaces );
 
+	// let servers send active features whenever they change
+	bool subscribeActiveFeatures( const ComputerControlInterfaceList& computerControlInterfaces );
+
 	Plugin::Uid uid() const override
 	{
 		return QStringLiteral("f5ec79e0-186c-4af0-89a2-7e5687cc32b2");
@@ -77,10 +81,15 @@ public:
 
 	bool handleFeatureMessage( VeyonServerInterface& server, const FeatureMessage& message ) override;
 
+private slots:
+	void notifyActiveFeaturesSubscribers( const FeatureUidList& activeFeatures );
+
 private:
 	enum Commands
 	{
 		QueryActiveFeatures,
+		SubscribeActiveFeatures,
+		ActiveFeaturesChanged,
 	};
 
 	enum Arguments
@@ -91,8 +100,13 @@ private:
 	const Feature m_featureControlFeature;
 	const FeatureList m_features;
 
+	// query is sent very frequently so serialize it only once per format
+	QVector<QByteArray> m_queryActiveFeaturesMessages;
+
 	FeatureUidList m_activeFeatures;
 
+	FeatureSubscriptions m_activeFeaturesSubscriptions;
+
 };
 
 #endif // FEATURE_CONTROL_H
@@ -37,7 +37,16 @@ public:
 	typedef quint32 MessageSize;
 	typedef Feature::Uid FeatureUid;
 	typedef qint32 Command;
-	typedef QMap<QString, QVariant> Arguments;
+	typedef QMap<int, QVariant> Arguments;
+
+	// the first byte of each message payload equals its format - legacy messages always start with
+	// the high byte of the QVariant type ID of the feature UID which is 0
+	typedef enum Formats {
+		LegacyFormat,	// feature UID, command and arguments with string keys as QVariants
+		CompactFormat,	// fixed-size header followed by arguments with integer keys
+		FormatCount,
+		LatestFormat = CompactFormat
+	} Format;
 
 	enum SpecialCommands
 	{
@@ -99,22 +108,23 @@ public:
 
 	FeatureMessage &addArgument( int index, const QVariant& value )
 	{
-		m_arguments[QString::number(index)] = value;
+		m_arguments[index] = value;
 		return *this;
 	}
 
 	QVariant argument( int index ) const
 	{
-		return m_arguments[QString::number(index)];
+		return m_arguments.value( index );
 	}
 
 	bool hasArgument( int index ) const
 	{
-		return m_arguments.contains( QString::number( index ) );
+		return m_arguments.contains( index );
 	}
 
 	bool send();
 	bool send( QIODevice* ioDevice ) const;
+	bool send( QIODevice* ioDevice, Format format ) const;
 
 	bool isReadyForReceive();
 
@@ -125,7 +135,18 @@ public:
 		return m_ioDevice;
 	}
 
+	/** \brief Sets format negotiated with the peer at given IO device which is used by send() */
+	static void setFormat( QIODevice* ioDevice, Format format );
+	static Format format( const QIODevice* ioDevice );
+
 private:
+	enum {
+		MaxMessageSize = 1024*1024*32
+	};
+
+	bool receiveLegacyFormat( QIODevice* ioDevice );
+	bool receiveCompactFormat( QIODevice* ioDevice );
+
 	QIODevice* m_ioDevice;
 
 	FeatureUid m_featureUid;
@@ -0,0 +1,105 @@
+/*
+ * FeatureMessageBroadcast.h - declaration of FeatureMessageBroadcast class
+ *
+ * Copyright (c) 2018 Tobias Junghans <tobydox@veyon.io>
+ *
+ * This file is part of Veyon - http://veyon.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef FEATURE_MESSAGE_BROADCAST_H
+#define FEATURE_MESSAGE_BROADCAST_H
+
+#include <QMap>
+#include <QPointer>
+#include <QTimer>
+
+#include "ComputerControlInterface.h"
+
+/** \brief Sends a feature message to many computers and tracks its delivery
+ *
+ * The message is serialized only once per feature message format and the resulting data is shared
+ * by all connections.
+ * Each computer is asked to acknowledge the message afterwards so the master gets notified
+ * about computers which did not receive or process the message. The result is reported to
+ * each computer's ComputerControlInterface as well.
+ */
+class VEYON_CORE_EXPORT FeatureMessageBroadcast : public QObject
+{
+	Q_OBJECT
+public:
+	enum {
+		AcknowledgementTimeout = 10000
+	};
+
+	typedef enum DeliveryStates {
+		DeliveryPending,
+		DeliveryAcknowledged,
+		DeliveryFailed,
+		DeliveryStateCount
+	} DeliveryState;
+
+	typedef QMap<QString, DeliveryState> DeliveryStateMap;
+
+	FeatureMessageBroadcast( const FeatureMessage& message, QObject* parent = nullptr );
+	~FeatureMessageBroadcast() override;
+
+	/** \brief Sends message to given computers and deletes broadcast once all deliveries have finished */
+	static FeatureMessageBroadcast* send( const FeatureMessage& message,
+										  const ComputerControlInterfaceList& computerControlInterfaces );
+
+	void sendTo( const ComputerControlInterfaceList& computerControlInterfaces );
+
+	/** \brief Returns delivery state per host */
+	const DeliveryStateMap& deliveryStates() const
+	{
+		return m_deliveryStates;
+	}
+
+	int count( DeliveryState state ) const;
+
+	bool isFinished() const
+	{
+		return count( DeliveryPending ) == 0;
+	}
+
+signals:
+	void deliveryStateChanged( const QString& host, FeatureMessageBroadcast::DeliveryState state );
+	void finished();
+
+private:
+	void setDeliveryState( const QString& host, DeliveryState state );
+	void abortPendingDeliveries();
+	void finish();
+
+	const QByteArray& serializedMessage( FeatureMessage::Format format );
+
+	const FeatureMessage m_message;
+	QVector<QByteArray> m_serializedMessages;
+
+	DeliveryStateMap m_deliveryStates;
+	QMap<QString, QMetaObject::Connection> m_connections;
+	QMap<QString, QPointer<ComputerControlInterface> > m_computerControlInterfaces;
+
+	QTimer m_timeoutTimer;
+	bool m_sending;
+	bool m_finished;
+
+} ;
+
+#endif
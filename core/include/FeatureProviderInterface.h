@@ -27,6 +27,7 @@
 
 #include "ComputerControlInterface.h"
 #include "FeatureMessage.h"
+#include "FeatureMessageBroadcast.h"
 #include "Feature.h"
 #include "PluginInterface.h"
 
@@ -94,10 +95,8 @@ protected:
 	bool sendFeatureMessage( const FeatureMessage& message,
 							 const ComputerControlInterfaceList& computerControlInterfaces )
 	{
-		for( auto controlInterface : computerControlInterfaces )
-		{
-			controlInterface->sendFeatureMessage( message );
-		}
+		// serializes message only once and reports computers which did not acknowledge it
+		FeatureMessageBroadcast::send( message, computerControlInterfaces );
 
 		return true;
 	}
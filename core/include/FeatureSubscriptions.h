@@ -0,0 +1,69 @@
+/*
+ * FeatureSubscriptions.h - declaration of FeatureSubscriptions class
+ *
+ * Copyright (c) 2018 Tobias Junghans <tobydox@veyon.io>
+ *
+ * This file is part of Veyon - http://veyon.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef FEATURE_SUBSCRIPTIONS_H
+#define FEATURE_SUBSCRIPTIONS_H
+
+#include <QMutex>
+#include <QObject>
+
+#include "VeyonCore.h"
+
+class QIODevice;
+class FeatureMessage;
+class VeyonServerInterface;
+
+/** \brief Keeps track of clients which subscribed to notifications of a feature on the server
+ *
+ * Clients are unsubscribed automatically as soon as their connection is closed.
+ */
+class VEYON_CORE_EXPORT FeatureSubscriptions : public QObject
+{
+	Q_OBJECT
+public:
+	FeatureSubscriptions( QObject* parent = nullptr );
+	~FeatureSubscriptions() override;
+
+	// may be called from any thread
+	void subscribe( VeyonServerInterface& server, QIODevice* ioDevice );
+
+	bool isEmpty();
+
+	// sends message to all subscribed clients - may be called from any thread
+	void notify( const FeatureMessage& message );
+
+signals:
+	// emitted within the thread of the connection of the last subscriber
+	void subscribersGone();
+
+private:
+	void unsubscribe( QObject* ioDevice );
+
+	QMutex m_mutex;
+	VeyonServerInterface* m_server;
+	QList<QIODevice *> m_subscribers;
+
+} ;
+
+#endif
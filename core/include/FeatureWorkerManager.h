@@ -49,7 +49,14 @@ public:
 	FeatureWorkerManager( VeyonServerInterface& server, FeatureManager& featureManager, QObject* parent = nullptr );
 	~FeatureWorkerManager() override;
 
-	Q_INVOKABLE void startWorker( const Feature& feature, WorkerProcessMode workerProcessMode );
+	// command line argument for worker processes which get a feature assigned later on
+	static QString standbyWorkerArgument()
+	{
+		return QStringLiteral( "standby" );
+	}
+
+	// use qualified type name so it matches the one passed to QMetaObject::invokeMethod()
+	Q_INVOKABLE void startWorker( const Feature& feature, FeatureWorkerManager::WorkerProcessMode workerProcessMode );
 	Q_INVOKABLE void stopWorker( const Feature& feature );
 
 	Q_INVOKABLE void sendMessage( const FeatureMessage& message );
@@ -57,6 +64,9 @@ public:
 	bool isWorkerRunning( const Feature& feature );
 	FeatureUidList runningWorkers();
 
+signals:
+	void runningWorkersChanged( const FeatureUidList& runningWorkers );
+
 private slots:
 	void acceptConnection();
 	void processConnection( QTcpSocket* socket );
@@ -65,6 +75,9 @@ private slots:
 	void sendPendingMessages();
 
 private:
+	void startStandbyWorker();
+	void stopStandbyWorker();
+
 	VeyonServerInterface& m_server;
 	FeatureManager& m_featureManager;
 	QTcpServer m_tcpServer;
@@ -104,8 +117,15 @@ private:
 	typedef QMap<Feature::Uid, Worker> WorkerMap;
 	WorkerMap m_workers;
 
+	// initialized managed system process which is assigned to the next feature started -
+	// only accessed within our thread
+	const bool m_standbyWorkerEnabled;
+	Worker m_standbyWorker;
+
 	QMutex m_workersMutex;
 
 } ;
 
+Q_DECLARE_METATYPE(FeatureWorkerManager::WorkerProcessMode)
+
 #endif
@@ -0,0 +1,60 @@
+/*
+ * ImageScaler.h - declaration of ImageScaler class
+ *
+ * Copyright (c) 2018 Tobias Junghans <tobydox@veyon.io>
+ *
+ * This file is part of Veyon - http://veyon.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef IMAGE_SCALER_H
+#define IMAGE_SCALER_H
+
+#include <QImage>
+#include <QRect>
+
+#include "VeyonCore.h"
+
+/** \brief Fast area averaging (box filter) downscaler for 32 bit images
+ *
+ * Each destination pixel is the average of all source pixels it covers. Unlike
+ * QImage::scaled() it allows updating parts of an existing destination image only,
+ * e.g. the areas affected by a framebuffer update.
+ */
+class VEYON_CORE_EXPORT ImageScaler
+{
+public:
+	/** \brief Returns the area of a destination image with given size affected by changes in given source area */
+	static QRect mapToDestination( const QRect& sourceRect, QSize sourceSize, QSize destinationSize );
+
+	/** \brief Scales source image into given area of destination image - both images have to be 32 bits per pixel */
+	static bool scale( const QImage& source, QImage& destination, const QRect& destinationRect );
+
+private:
+	enum {
+		MaximumVectorizedSpan = 256	/**< Source pixels per destination pixel and row which can be summed up in 16 bit lanes */
+	};
+
+	static void sumRow( const QRgb* sourceLine, const int* columnStarts, const int* columnEnds,
+						int width, quint32* sums );
+	static void storeAverages( const quint32* sums, const int* columnStarts, const int* columnEnds,
+							   int rowCount, int width, QRgb* destinationLine );
+
+} ;
+
+#endif
@@ -0,0 +1,118 @@
+/*
+ * LockFreeQueue.h - declaration of LockFreeQueue class template
+ *
+ * Copyright (c) 2018 Tobias Junghans <tobydox@veyon.io>
+ *
+ * This file is part of Veyon - http://veyon.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef LOCK_FREE_QUEUE_H
+#define LOCK_FREE_QUEUE_H
+
+#include <QAtomicInt>
+#include <QVector>
+
+/** \brief Bounded wait-free queue for exactly one producer and one consumer thread
+ *
+ * enqueue() may only be called by the producer thread while peek() and dequeue() may only be
+ * called by the consumer thread. Items are stored by value in a preallocated ring buffer.
+ */
+template<typename T>
+class LockFreeQueue
+{
+public:
+	explicit LockFreeQueue( int capacity ) :
+		m_items( capacity + 1 ),
+		m_data( m_items.data() ),
+		m_head( 0 ),
+		m_tail( 0 )
+	{
+	}
+
+	int capacity() const
+	{
+		return m_items.size() - 1;
+	}
+
+	bool isEmpty() const
+	{
+		return m_head.loadAcquire() == m_tail.loadAcquire();
+	}
+
+	/** \brief Appends item to the queue - returns false if queue is full */
+	bool enqueue( const T& item )
+	{
+		const int tail = m_tail.load();
+		const int nextTail = ( tail + 1 ) % m_items.size();
+
+		if( nextTail == m_head.loadAcquire() )
+		{
+			return false;
+		}
+
+		m_data[tail] = item;
+		m_tail.storeRelease( nextTail );
+
+		return true;
+	}
+
+	/** \brief Returns the first item of the queue without removing it or nullptr if queue is empty */
+	const T* peek() const
+	{
+		const int head = m_head.load();
+
+		if( head == m_tail.loadAcquire() )
+		{
+			return nullptr;
+		}
+
+		return &m_data[head];
+	}
+
+	/** \brief Removes the first item of the queue and stores it in given item - returns false if queue is empty */
+	bool dequeue( T& item )
+	{
+		const int head = m_head.load();
+
+		if( head == m_tail.loadAcquire() )
+		{
+			return false;
+		}
+
+		item = m_data[head];
+
+		// release resources held by item
+		m_data[head] = T();
+
+		m_head.storeRelease( ( head + 1 ) % m_items.size() );
+
+		return true;
+	}
+
+private:
+	Q_DISABLE_COPY(LockFreeQueue)
+
+	QVector<T> m_items;
+	T* m_data;	// accessed by both threads so never let QVector detach
+	QAtomicInt m_head;
+	QAtomicInt m_tail;
+
+} ;
+
+#endif
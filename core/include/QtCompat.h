@@ -26,6 +26,7 @@
 #define QT_COMPAT_H
 
 #include <QtGlobal>
+#include <QRegion>
 #include <QSet>
 
 template<class A, class B>
@@ -38,6 +39,19 @@ static inline bool intersects( const QSet<A>& a, const QSet<B>& b )
 #endif
 }
 
+// QRegion::rects() is deprecated since Qt 5.8 which allows iterating over a QRegion directly
+#if QT_VERSION >= 0x050800
+static inline const QRegion& regionRects( const QRegion& region )
+{
+	return region;
+}
+#else
+static inline QVector<QRect> regionRects( const QRegion& region )
+{
+	return region.rects();
+}
+#endif
+
 #if QT_VERSION >= 0x050600
 #include <QVersionNumber>
 #else
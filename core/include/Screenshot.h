@@ -38,6 +38,7 @@ class VEYON_CORE_EXPORT Screenshot : public QObject
 public:
 	Screenshot( const QString &fileName = QString(), QObject* parent = nullptr );
 
+	// grabs screen asynchronously and saves screenshot as soon as it has been received
 	void take( ComputerControlInterface::Pointer computerControlInterface );
 
 	bool isValid() const
@@ -67,6 +68,12 @@ public:
 
 
 private:
+	enum {
+		GrabScreenTimeout = 10000
+	};
+
+	static void save( QImage image, const QString& caption, const QString& fileName );
+
 	QString m_fileName;
 	QImage m_image;
 
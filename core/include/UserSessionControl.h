@@ -27,6 +27,7 @@
 
 #include <QReadWriteLock>
 
+#include "FeatureSubscriptions.h"
 #include "SimpleFeatureProvider.h"
 
 class QThread;
@@ -42,6 +43,9 @@ public:
 
 	bool getUserSessionInfo( const ComputerControlInterfaceList& computerControlInterfaces );
 
+	// let servers send user session information whenever it changes
+	bool subscribeUserSessionInfo( const ComputerControlInterfaceList& computerControlInterfaces );
+
 	Plugin::Uid uid() const override
 	{
 		return QStringLiteral("80580500-2e59-4297-9e35-e53959b028cd");
@@ -86,11 +90,17 @@ public:
 	bool handleFeatureMessage( VeyonServerInterface& server, const FeatureMessage& message ) override;
 
 private:
+	enum {
+		UserInformationUpdateInterval = 5000
+	};
+
 	enum Commands
 	{
 		GetInfo,
 		LogonUser,
-		LogoutUser
+		LogoutUser,
+		SubscribeInfo,
+		InfoChanged
 	};
 
 	enum Arguments
@@ -99,6 +109,9 @@ private:
 	};
 
 	void queryUserInformation();
+	void startUserInformationUpdates();
+	void updateUserInformation();
+	QString userInformation();
 	bool confirmFeatureExecution( const Feature& feature, QWidget* parent );
 
 	const Feature m_userSessionInfoFeature;
@@ -112,6 +125,8 @@ private:
 	QString m_userName;
 	QString m_userFullName;
 
+	FeatureSubscriptions m_userSessionInfoSubscriptions;
+
 };
 
 #endif // USER_SESSION_CONTROL_H
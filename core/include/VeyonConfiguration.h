@@ -60,6 +60,7 @@ public slots:
 	void setServiceAutostart( bool );
 	void setMultiSessionServiceEnabled( bool );
 	void setSoftwareSASEnabled( bool );
+	void setFeatureWorkerStandbyEnabled( bool );
 	void setLogLevel( int );
 	void setLogToStdErr( bool );
 	void setLogToSystem( bool );
@@ -78,9 +79,14 @@ public slots:
 	void setDemoServerPort( int );
 	void setFirewallExceptionEnabled( bool );
 	void setLocalConnectOnly( bool );
+	void setFramebufferUpdateSharingEnabled( bool );
+	void setConnectionThreadCount( int );
 	void setUserConfigurationDirectory( const QString & );
 	void setScreenshotDirectory( const QString & );
 	void setComputerMonitoringUpdateInterval( int );
+	void setComputerMonitoringMaximumUpdateInterval( int );
+	void setComputerMonitoringHiddenUpdateInterval( int );
+	void setComputerMonitoringThreadCount( int );
 	void setComputerDisplayRoleContent( int );
 	void setComputerMonitoringBackgroundColor( const QColor& );
 	void setAccessControlForMasterEnabled( bool );
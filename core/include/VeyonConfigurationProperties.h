@@ -40,6 +40,7 @@
 	OP( VeyonConfiguration, VeyonCore::config(), BOOL, isMultiSessionServiceEnabled, setMultiSessionServiceEnabled, "MultiSession", "Service" );			\
 	OP( VeyonConfiguration, VeyonCore::config(), BOOL, autostartService, setServiceAutostart, "Autostart", "Service" );			\
 	OP( VeyonConfiguration, VeyonCore::config(), BOOL, isSoftwareSASEnabled, setSoftwareSASEnabled, "SoftwareSASEnabled", "Service" );			\
+	OP( VeyonConfiguration, VeyonCore::config(), BOOL, isFeatureWorkerStandbyEnabled, setFeatureWorkerStandbyEnabled, "FeatureWorkerStandbyEnabled", "Service" );			\
 
 #define FOREACH_VEYON_NETWORK_OBJECT_DIRECTORY_CONFIG_PROPERTY(OP)				\
 	OP( VeyonConfiguration, VeyonCore::config(), UUID, networkObjectDirectoryPlugin, setNetworkObjectDirectoryPlugin, "Plugin", "NetworkObjectDirectory" );			\
@@ -68,6 +69,8 @@
 	OP( VeyonConfiguration, VeyonCore::config(), INT, demoServerPort, setDemoServerPort, "DemoServerPort", "Network" );			\
 	OP( VeyonConfiguration, VeyonCore::config(), BOOL, isFirewallExceptionEnabled, setFirewallExceptionEnabled, "FirewallExceptionEnabled", "Network" );	\
 	OP( VeyonConfiguration, VeyonCore::config(), BOOL, localConnectOnly, setLocalConnectOnly, "LocalConnectOnly", "Network" );					\
+	OP( VeyonConfiguration, VeyonCore::config(), BOOL, isFramebufferUpdateSharingEnabled, setFramebufferUpdateSharingEnabled, "FramebufferUpdateSharingEnabled", "Network" );	\
+	OP( VeyonConfiguration, VeyonCore::config(), INT, connectionThreadCount, setConnectionThreadCount, "ConnectionThreadCount", "Network" );	\
 
 #define FOREACH_VEYON_DIRECTORIES_CONFIG_PROPERTY(OP) \
 	OP( VeyonConfiguration, VeyonCore::config(), STRING, userConfigurationDirectory, setUserConfigurationDirectory, "UserConfiguration", "Directories" );	\
@@ -75,6 +78,9 @@
 
 #define FOREACH_VEYON_MASTER_CONFIG_PROPERTY(OP) \
 	OP( VeyonConfiguration, VeyonCore::config(), INT, computerMonitoringUpdateInterval, setComputerMonitoringUpdateInterval, "ComputerMonitoringUpdateInterval", "Master" );	\
+	OP( VeyonConfiguration, VeyonCore::config(), INT, computerMonitoringMaximumUpdateInterval, setComputerMonitoringMaximumUpdateInterval, "ComputerMonitoringMaximumUpdateInterval", "Master" );	\
+	OP( VeyonConfiguration, VeyonCore::config(), INT, computerMonitoringHiddenUpdateInterval, setComputerMonitoringHiddenUpdateInterval, "ComputerMonitoringHiddenUpdateInterval", "Master" );	\
+	OP( VeyonConfiguration, VeyonCore::config(), INT, computerMonitoringThreadCount, setComputerMonitoringThreadCount, "ComputerMonitoringThreadCount", "Master" );	\
 	OP( VeyonConfiguration, VeyonCore::config(), INT, computerDisplayRoleContent, setComputerDisplayRoleContent, "ComputerDisplayRoleContent", "Master" );	\
 	OP( VeyonConfiguration, VeyonCore::config(), COLOR, computerMonitoringBackgroundColor, setComputerMonitoringBackgroundColor, "ComputerMonitoringBackgroundColor", "Master" );	\
 	OP( VeyonConfiguration, VeyonCore::config(), BOOL, accessControlForMasterEnabled, setAccessControlForMasterEnabled, "AccessControlForMasterEnabled", "Master" );	\
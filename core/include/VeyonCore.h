@@ -26,6 +26,7 @@
 #define VEYON_CORE_H
 
 #include <QtEndian>
+#include <QMutex>
 #include <QString>
 #include <QDebug>
 
@@ -53,6 +54,7 @@ class PlatformPluginManager;
 class PluginManager;
 class UserGroupsBackendManager;
 class VeyonConfiguration;
+class VncConnectionPool;
 
 // clazy:excludeall=ctor-missing-parent-argument
 
@@ -117,6 +119,8 @@ public:
 		return *( instance()->m_localComputerControlInterface );
 	}
 
+	static VncConnectionPool& vncConnectionPool();
+
 	static void setupApplicationParameters();
 	bool initAuthentication( int credentialTypes );
 
@@ -169,6 +173,9 @@ private:
 
 	ComputerControlInterface* m_localComputerControlInterface;
 
+	QMutex m_vncConnectionPoolMutex;
+	VncConnectionPool* m_vncConnectionPool;
+
 	QString m_applicationName;
 	QString m_authenticationKeyName;
 
@@ -29,12 +29,11 @@
 
 #include "rfb/rfbproto.h"
 
+#include "FeatureMessage.h"
 #include "VeyonCore.h"
 #include "VeyonVncConnection.h"
 
 
-class FeatureMessage;
-
 class VEYON_CORE_EXPORT VeyonCoreConnection : public QObject
 {
 	Q_OBJECT
@@ -67,7 +66,17 @@ public:
 		return m_userHomeDir;
 	}
 
+	FeatureMessage::Format featureMessageFormat() const
+	{
+		return m_vncConn ? m_vncConn->featureMessageFormat() : FeatureMessage::LegacyFormat;
+	}
+
 	void sendFeatureMessage( const FeatureMessage &featureMessage );
+	void sendSerializedFeatureMessage( const QByteArray& message );
+
+	/** \brief Returns complete RFB message for given feature message which can be sent to any number of
+	 * connections using the given feature message format */
+	static QByteArray serializeFeatureMessage( const FeatureMessage& featureMessage, FeatureMessage::Format format );
 
 signals:
 	void featureMessageReceived( const FeatureMessage& );
@@ -26,11 +26,43 @@
 #ifndef VEYON_RFB_EXT_H
 #define VEYON_RFB_EXT_H
 
+#include <stdint.h>
+
 typedef struct _rfbClient rfbClient;
 
 // new rfb command which tells server or client that a Veyon feature message is following
 #define rfbVeyonFeatureMessage		41
 
+// new rfb command which tells server to send downscaled framebuffer updates (thumbnails) of given
+// size or to send native framebuffer updates again if width or height is zero - the server sends
+// this message with zero size to acknowledge that it supports thumbnails
+#define rfbVeyonThumbnailMessage	42
+
+// pseudo encoding announced by clients which are able to handle rfbVeyonThumbnailMessage
+#define rfbEncodingVeyonThumbnail	0x56455931
+
+typedef struct {
+	uint8_t type;			/* always rfbVeyonThumbnailMessage */
+	uint8_t pad;
+	uint16_t width;
+	uint16_t height;
+} rfbVeyonThumbnailMsg;
+
+#define sz_rfbVeyonThumbnailMsg 6
+
+// new rfb command which tells the demo server the size of the screen the client displays the demo on
+// so it can send framebuffer updates in a matching resolution
+#define rfbVeyonScreenSizeMessage	43
+
+typedef struct {
+	uint8_t type;			/* always rfbVeyonScreenSizeMessage */
+	uint8_t pad;
+	uint16_t width;
+	uint16_t height;
+} rfbVeyonScreenSizeMsg;
+
+#define sz_rfbVeyonScreenSizeMsg 6
+
 
 #define rfbSecTypeVeyon 40
 
@@ -25,6 +25,8 @@
 #ifndef VEYON_SERVER_INTERFACE_H
 #define VEYON_SERVER_INTERFACE_H
 
+class QIODevice;
+class FeatureMessage;
 class FeatureWorkerManager;
 
 class VeyonServerInterface
@@ -32,6 +34,9 @@ class VeyonServerInterface
 public:
 	virtual FeatureWorkerManager& featureWorkerManager() = 0;
 
+	// sends message to the client connected through given IO device - may be called from any thread
+	virtual void sendFeatureMessage( QIODevice* ioDevice, const FeatureMessage& message ) = 0;
+
 };
 
 #endif
@@ -28,29 +28,142 @@
 #ifndef VEYON_VNC_CONNECTION_H
 #define VEYON_VNC_CONNECTION_H
 
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QHostAddress>
 #include <QMutex>
 #include <QQueue>
 #include <QReadWriteLock>
-#include <QThread>
+#include <QRegion>
 #include <QTimer>
-#include <QWaitCondition>
 #include <QImage>
 
 #include "rfb/rfbproto.h"
 
+#include "FeatureMessage.h"
+#include "LockFreeQueue.h"
 #include "RfbVeyonAuth.h"
 #include "SocketDevice.h"
 
-class MessageEvent	// clazy:exclude=copyable-polymorphic
+/** \brief Value type for events to be sent to the server by the connection thread */
+class VncClientEvent
 {
 public:
-	virtual ~MessageEvent() {}
-	virtual void fire( rfbClient *c ) = 0;
+	enum Type
+	{
+		InvalidEvent,
+		PointerEvent,
+		KeyEvent,
+		ClientCutTextEvent,
+		RawMessageEvent
+	} ;
+
+	VncClientEvent() :
+		m_type( InvalidEvent ),
+		m_x( 0 ),
+		m_y( 0 ),
+		m_buttonMask( 0 ),
+		m_key( 0 ),
+		m_pressed( false ),
+		m_data()
+	{
+	}
+
+	static VncClientEvent pointerEvent( int x, int y, int buttonMask )
+	{
+		VncClientEvent event;
+		event.m_type = PointerEvent;
+		event.m_x = x;
+		event.m_y = y;
+		event.m_buttonMask = buttonMask;
+		return event;
+	}
+
+	static VncClientEvent keyEvent( unsigned int key, bool pressed )
+	{
+		VncClientEvent event;
+		event.m_type = KeyEvent;
+		event.m_key = key;
+		event.m_pressed = pressed;
+		return event;
+	}
+
+	static VncClientEvent clientCutTextEvent( const QString& text )
+	{
+		VncClientEvent event;
+		event.m_type = ClientCutTextEvent;
+		event.m_data = text.toUtf8();
+		return event;
+	}
+
+	/** \brief Creates an event for a complete, already serialized RFB client message */
+	static VncClientEvent rawMessageEvent( const QByteArray& message )
+	{
+		VncClientEvent event;
+		event.m_type = RawMessageEvent;
+		event.m_data = message;
+		return event;
+	}
+
+	Type type() const
+	{
+		return m_type;
+	}
+
+	int x() const
+	{
+		return m_x;
+	}
+
+	int y() const
+	{
+		return m_y;
+	}
+
+	int buttonMask() const
+	{
+		return m_buttonMask;
+	}
+
+	unsigned int key() const
+	{
+		return m_key;
+	}
+
+	bool pressed() const
+	{
+		return m_pressed;
+	}
+
+	const QByteArray& data() const
+	{
+		return m_data;
+	}
+
+	/** \brief Returns whether this event can be dropped if followed by given event */
+	bool isSupersededBy( const VncClientEvent& other ) const
+	{
+		return m_type == PointerEvent && other.m_type == PointerEvent && m_buttonMask == other.m_buttonMask;
+	}
+
+private:
+	Type m_type;
+	int m_x;
+	int m_y;
+	int m_buttonMask;
+	unsigned int m_key;
+	bool m_pressed;
+	QByteArray m_data;
 
 } ;
 
+class QSocketNotifier;
+class QThread;
+class VncConnectionPool;
+
+// clazy:excludeall=ctor-missing-parent-argument
 
-class VEYON_CORE_EXPORT VeyonVncConnection : public QThread
+class VEYON_CORE_EXPORT VeyonVncConnection : public QObject
 {
 	Q_OBJECT
 public:
@@ -75,20 +188,53 @@ public:
 	} ;
 	typedef States State;
 
-	explicit VeyonVncConnection( QObject *parent = nullptr );
+	struct Statistics
+	{
+		Statistics() :
+			bytesPerSecond( 0 ),
+			updatesPerSecond( 0 ),
+			roundTripTime( -1 ),
+			inputLatency( -1 ),
+			updateInterval( 0 )
+		{
+		}
+
+		qint64 bytesPerSecond;	/**< framebuffer data received per second (uncompressed size) */
+		qreal updatesPerSecond;
+		int roundTripTime;		/**< lowest latency between update request and completed update in ms, -1 if unknown */
+		int inputLatency;		/**< average time between sending input events and next screen change in ms, -1 if unknown */
+		int updateInterval;		/**< currently used update interval in ms */
+	} ;
+
+	VeyonVncConnection();
 	~VeyonVncConnection() override;
 
 	QImage image() const;
+	void start();
 	void stop( bool deleteAfterFinished = false );
 	void reset( const QString &host );
 	void setHost( const QString &host );
 	void setPort( int port );
 
+	/** \brief Receive framebuffer updates from given multicast group once available instead of via TCP - packets have to be authenticated with given key */
+	void setMulticastGroup( const QHostAddress& groupAddress, int port, const QByteArray& key );
+
+	/** \brief Let connection run in a thread of given pool instead of an own thread - has to be set before start() */
+	void setConnectionPool( VncConnectionPool* connectionPool )
+	{
+		m_connectionPool = connectionPool;
+	}
+
 	State state() const
 	{
 		return m_state;
 	}
 
+	bool isRunning() const
+	{
+		return m_thread != nullptr && m_stopRequested.load() == 0;
+	}
+
 	bool isConnected() const
 	{
 		return state() == Connected && isRunning();
@@ -109,6 +255,12 @@ public:
 		return m_veyonAuthType;
 	}
 
+	// format negotiated with server during authentication
+	FeatureMessage::Format featureMessageFormat() const
+	{
+		return static_cast<FeatureMessage::Format>( m_featureMessageFormat.load() );
+	}
+
 	void setQuality( QualityLevels qualityLevel )
 	{
 		m_quality = qualityLevel;
@@ -119,7 +271,8 @@ public:
 		return m_quality;
 	}
 
-	void enqueueEvent( MessageEvent *e );
+	/** \brief Queues event to be sent by the connection thread - must always be called from the same thread */
+	void enqueueEvent( const VncClientEvent& event );
 
 	const rfbClient *getRfbClient() const
 	{
@@ -142,24 +295,19 @@ public:
 		return m_frameBufferValid;
 	}
 
-	void setScaledSize( QSize s )
-	{
-		if( m_scaledSize != s )
-		{
-			m_scaledSize = s;
-			m_scaledScreenNeedsUpdate = true;
-		}
-	}
+	void setScaledSize( QSize s );
 
-	QImage scaledScreen()
-	{
-		rescaleScreen();
-		return m_scaledScreen;
-	}
+	/** \brief Returns framebuffer scaled to size set via setScaledSize() - scaling is done in connection thread */
+	QImage scaledScreen() const;
 
 	void setFramebufferUpdateInterval( int interval );
 
-	void rescaleScreen();
+	/** \brief Let update interval adapt between given bounds depending on screen activity and link speed */
+	void setAdaptiveFramebufferUpdateInterval( int minimumInterval, int maximumInterval );
+
+	void setFramebufferUpdatesPaused( bool paused );
+
+	Statistics statistics() const;
 
 	// authentication
 	static void handleSecTypeVeyon( rfbClient *client );
@@ -194,26 +342,56 @@ public slots:
 	void clientCut( const QString &text );
 
 
-protected:
-	void run() override;
+private slots:
+	void establishConnection();
+	void finishConnectionSetup( int state );
+	void readFromServer();
+	void handleConnection();
+	void sendEvents();
+	void sendThumbnailRequest();
+	void rescaleScreen();
+	void shutdown();
+	void handleMulticastFailure();
 
 
 private:
 	enum {
 		InitialFrameBufferTimeout = 15000,	/**< A server has to send an initial framebuffer within given timeout in ms */
-		ThreadTerminationTimeout = 10000,
-		MessageWaitTimeout = 500,
+		ConnectionRetryInterval = 1000,
+		UpdateRequestRetryInterval = 250,	/**< Re-request updates in this interval if no update interval is set */
+		UpdateIntervalIncreasePercentage = 150,	/**< Back off by this factor if there were no updates since last request */
+		UpdateIntervalDecreasePercentage = 67,	/**< Speed up by this factor if screen shows activity */
+		StatisticsInterval = 1000,
+		FullRescaleThreshold = 50,	/**< Rescale whole screen if given percentage of framebuffer has been updated */
+		MaximumDamagedRects = 32,	/**< Rescale bounding rect of all updated rects if exceeding given number of rects */
+		EventQueueSize = 1024,
 	};
 
-	void establishConnection();
-	void handleConnection();
+	State connectToServer( rfbClient* client );
 	void closeConnection();
+	void reconnect();
+	void startMulticastRelay();
+	void stopMulticastRelay();
+	void startUpdateTimer();
+	void requestFramebufferUpdate( bool incremental );
+	void finishFramebufferUpdateRequest();
+	void adaptFramebufferUpdateInterval( int updateLatency );
+	void resetStatistics();
+	void updateStatistics();
 
 	void setState( State state );
 
-	void finishFrameBufferUpdate();
+	void sendEvent( const VncClientEvent& event );
+	void startInputLatencyMeasurement();
 
-	void sendEvents();
+	/** \brief In low latency mode (used for remote control) framebuffer update requests are pipelined */
+	bool isLowLatencyMode() const
+	{
+		return m_quality == RemoteControlQuality;
+	}
+
+	void finishFrameBufferUpdate();
+	void updateScaledScreen();
 
 	// hooks for LibVNCClient
 	static int8_t hookInitFrameBuffer( rfbClient *cl );
@@ -229,20 +407,59 @@ private:
 	bool m_serviceReachable;
 	bool m_frameBufferInitialized;
 	bool m_frameBufferValid;
+	bool m_thumbnailsSupported;
 	rfbClient *m_cl;
 	RfbVeyonAuth::Type m_veyonAuthType;
+	QAtomicInt m_featureMessageFormat;
 	QualityLevels m_quality;
 	QString m_host;
 	int m_port;
-	QTimer m_terminateTimer;
-	QWaitCondition m_updateIntervalSleeper;
-	int m_framebufferUpdateInterval;
+	VncConnectionPool* m_connectionPool;
+	QThread* m_thread;
+	QSocketNotifier* m_socketNotifier;
+	QHostAddress m_multicastGroupAddress;
+	int m_multicastPort;
+	QByteArray m_multicastKey;
+	bool m_multicastFailed;
+	QThread* m_multicastRelayThread;
+	QTimer m_updateTimer;
+	QElapsedTimer m_connectionTime;
+	QAtomicInt m_stopRequested;
+	QAtomicInt m_eventsPending;
+	bool m_deleteAfterStop;
+	bool m_connectInProgress;
+	QAtomicInt m_framebufferUpdateInterval;
+	QAtomicInt m_minimumFramebufferUpdateInterval;
+	QAtomicInt m_maximumFramebufferUpdateInterval;
+	QAtomicInt m_framebufferUpdatesPaused;
+	QElapsedTimer m_updateRequestTime;
+	bool m_updateRequestPending;
+	bool m_updateRequestIncremental;
+	bool m_updateRequestPipelined;
+	bool m_framebufferChanged;
+	QElapsedTimer m_inputTime;
+	bool m_inputPending;
+
+	// statistics
+	mutable QMutex m_statisticsMutex;
+	Statistics m_statistics;
+	QElapsedTimer m_statisticsTime;
+	qint64 m_receivedBytes;
+	int m_receivedUpdates;
+	int m_minimumUpdateLatency;
+	qint64 m_inputLatencySum;
+	int m_inputLatencyCount;
+
 	QMutex m_mutex;
 	mutable QReadWriteLock m_imgLock;
-	QQueue<MessageEvent *> m_eventQueue;
+	LockFreeQueue<VncClientEvent> m_eventQueue;
+	QQueue<VncClientEvent> m_eventOverflowQueue;
+	QAtomicInt m_eventQueueOverflow;
 
 	QImage m_image;
-	bool m_scaledScreenNeedsUpdate;
+	QRegion m_damagedRegion;
+	QImage m_scaledFramebuffer;
+	mutable QMutex m_scaledScreenMutex;
 	QImage m_scaledScreen;
 	QSize m_scaledSize;
 
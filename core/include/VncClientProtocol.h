@@ -25,13 +25,13 @@
 #ifndef VNC_CLIENT_PROTOCOL_H
 #define VNC_CLIENT_PROTOCOL_H
 
-#include <QRect>
+#include <QRegion>
 
 #include "rfb/rfbproto.h"
 
 #include "VeyonCore.h"
 
-class QBuffer;
+class QIODevice;
 class QTcpSocket;
 
 class VEYON_CORE_EXPORT VncClientProtocol
@@ -76,6 +76,17 @@ public:
 	bool setPixelFormat( rfbPixelFormat pixelFormat );
 	bool setEncodings( const QVector<uint32_t>& encodings );
 
+	// let the server scale down the framebuffer by given divisor - the server
+	// announces the resulting framebuffer size with an rfbResizeFrameBuffer message
+	bool setScale( int scale );
+
+	// parse subsequent updates according to a pixel format (in network byte order) which
+	// has been sent to the server by someone else, e.g. a proxied client
+	void setExpectedPixelFormat( const rfbPixelFormat& pixelFormat )
+	{
+		m_pixelFormat = pixelFormat;
+	}
+
 	void requestFramebufferUpdate( bool incremental );
 
 	bool receiveMessage();
@@ -87,7 +98,23 @@ public:
 
 	uint8_t lastMessageType() const
 	{
-		return static_cast<uint8_t>( m_lastMessage.constData()[0] );
+		return m_lastMessageType;
+	}
+
+	// write received messages to given device as soon as they have been parsed far enough
+	// instead of buffering them - lastMessage() is empty for framebuffer updates then
+	void setForwardingDevice( QIODevice* device );
+
+	QIODevice* forwardingDevice() const
+	{
+		return m_forwardingDevice;
+	}
+
+	// returns whether parts of a framebuffer update have been forwarded already so
+	// no other data must be written to the forwarding device until it is complete
+	bool isForwardingFramebufferUpdate() const
+	{
+		return m_forwardingDevice && m_updateState != UpdateIdle;
 	}
 
 	const QRect& lastUpdatedRect() const
@@ -95,7 +122,52 @@ public:
 		return m_lastUpdatedRect;
 	}
 
+	const QRegion& lastUpdatedRegion() const
+	{
+		return m_lastUpdatedRegion;
+	}
+
+	// returns whether the last framebuffer update and all following ones can be decoded
+	// without the zlib stream state built up by previous Tight encoded updates
+	bool isLastUpdateSelfContained() const
+	{
+		return m_lastUpdateSelfContained;
+	}
+
+	bool usesTightZlibStreams() const
+	{
+		return m_tightZlibStreams != 0;
+	}
+
+	void resetTightZlibStreams();
+
 private:
+	enum {
+		ForwardingBufferSize = 64*1024,
+		HextileTileSize = 16,
+		TightZlibStreamMask = 0x03,
+		TightZlibStreamResetMask = 0x0f,
+		TightMinimumDataSizeToCompress = 12,
+		TightMaximumCompactLengthSize = 3
+	};
+
+	// position of the parser within a framebuffer update message
+	typedef enum UpdateParserStates {
+		UpdateIdle,
+		UpdateRectHeader,
+		UpdateRectFinished,
+		UpdateRREHeader,
+		UpdateHextileTile,
+		UpdateHextileSubrectCount,
+		UpdateZlibHeader,
+		UpdateZRLEHeader,
+		UpdateTightControl,
+		UpdateTightFilter,
+		UpdateTightPalette,
+		UpdateTightBasicData,
+		UpdateTightCompactData
+	} UpdateParserState;
+
 	bool readProtocol();
 	bool receiveSecurityTypes();
 	bool receiveSecurityChallenge();
@@ -111,14 +183,34 @@ private:
 
 	bool readMessage( qint64 size );
 
-	bool handleRect( QBuffer& buffer, rfbFramebufferUpdateRectHeader rectHeader );
-	bool handleRectEncodingRRE( QBuffer& buffer, uint bytesPerPixel );
-	bool handleRectEncodingCoRRE( QBuffer& buffer, uint bytesPerPixel );
-	bool handleRectEncodingHextile( QBuffer& buffer,
-									const rfbFramebufferUpdateRectHeader rectHeader,
-									uint bytesPerPixel );
-	bool handleRectEncodingZlib( QBuffer& buffer );
-	bool handleRectEncodingZRLE( QBuffer& buffer );
+	bool receiveFramebufferUpdateData();
+	bool readUpdateData( void* data, qint64 size );
+	bool skipUpdateData();
+	void forwardUpdateData();
+	void abortUpdate( const char* error );
+
+	bool receiveRectHeader();
+	void finishRect();
+	void finishFramebufferUpdateMessage();
+
+	bool receiveRREHeader();
+	bool receiveHextileTile();
+	bool receiveHextileSubrectCount();
+	void nextHextileTile();
+	bool receiveZlibHeader();
+	bool receiveZRLEHeader();
+	bool receiveTightControl();
+	bool receiveTightFilter();
+	bool receiveTightPalette();
+	void receiveTightBasicData();
+	bool receiveTightCompactData();
+
+	uint bytesPerPixel() const
+	{
+		return m_pixelFormat.bitsPerPixel / 8u;
+	}
+
+	uint tightPixelSize() const;
 
 	static bool isPseudoEncoding( rfbFramebufferUpdateRectHeader header );
 
@@ -134,8 +226,34 @@ private:
 	quint16 m_framebufferWidth;
 	quint16 m_framebufferHeight;
 
+	QIODevice* m_forwardingDevice;
+
 	QByteArray m_lastMessage;
+	uint8_t m_lastMessageType;
 	QRect m_lastUpdatedRect;
+	QRegion m_lastUpdatedRegion;
+	bool m_lastUpdateSelfContained;
+
+	// bit masks of Tight zlib streams (one bit per stream)
+	uint8_t m_tightZlibStreams;
+	uint8_t m_tightZlibStreamResets;
+
+	// state of framebuffer update message currently being received - all data is
+	// read exactly once and appended to m_updateMessage (or passed to m_forwardingDevice)
+	UpdateParserState m_updateState;
+	QByteArray m_updateMessage;
+	qint64 m_updateDataToSkip;
+	int m_updateRectCount;
+	int m_updateRectIndex;
+	rfbFramebufferUpdateRectHeader m_updateRectHeader;
+	QRegion m_updatedRegion;
+	uint m_hextileX;
+	uint m_hextileY;
+	uint8_t m_hextileSubencoding;
+	uint8_t m_tightControl;
+	uint m_tightBitsPerPixel;
+	uint8_t m_updateTightZlibStreams;
+	bool m_updateSelfContained;
 
 } ;
 
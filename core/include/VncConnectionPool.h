@@ -0,0 +1,79 @@
+/*
+ * VncConnectionPool.h - declaration of VncConnectionPool class
+ *
+ * Copyright (c) 2018 Tobias Junghans <tobydox@veyon.io>
+ *
+ * This file is part of Veyon - http://veyon.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef VNC_CONNECTION_POOL_H
+#define VNC_CONNECTION_POOL_H
+
+#include <QMutex>
+#include <QThreadPool>
+#include <QVector>
+
+#include "VeyonCore.h"
+
+class QThread;
+
+// clazy:excludeall=ctor-missing-parent-argument
+
+/** \brief Provides a fixed number of event loop threads shared by many VeyonVncConnection instances
+ *
+ * Instead of running each VNC connection in its own thread, connections are attached to the least
+ * loaded thread of this pool. Blocking connection setups (rfbInitClient()) are run in a separate
+ * thread pool so they do not stall established connections sharing the same event loop thread.
+ */
+class VEYON_CORE_EXPORT VncConnectionPool
+{
+public:
+	enum {
+		DefaultThreadCount = 4,
+		MaximumThreadCount = 64,
+		ConnectThreadsPerThread = 4,
+		ThreadTerminationTimeout = 10000,
+	};
+
+	explicit VncConnectionPool( int threadCount );
+	~VncConnectionPool();
+
+	int threadCount() const
+	{
+		return m_threads.size();
+	}
+
+	QThread* acquireThread();
+	void acquireThread( QThread* thread );
+	void releaseThread( QThread* thread );
+
+	QThreadPool& connectThreadPool()
+	{
+		return m_connectThreadPool;
+	}
+
+private:
+	QMutex m_mutex;
+	QVector<QThread *> m_threads;
+	QVector<int> m_threadLoads;
+	QThreadPool m_connectThreadPool;
+
+} ;
+
+#endif
@@ -0,0 +1,120 @@
+/*
+ * VncMulticastProtocol.h - header file for the VncMulticastProtocol class
+ *
+ * Copyright (c) 2018 Tobias Junghans <tobydox@veyon.io>
+ *
+ * This file is part of Veyon - http://veyon.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef VNC_MULTICAST_PROTOCOL_H
+#define VNC_MULTICAST_PROTOCOL_H
+
+#include <QByteArray>
+#include <QVector>
+
+#include "VeyonCore.h"
+
+/** \brief Packet format for distributing RFB server messages via UDP multicast
+ *
+ * Each message gets a consecutive sequence number and is split into fragments fitting into a single
+ * datagram. For each group of FecGroupSize fragments a parity packet (XOR of all fragments) is sent
+ * so receivers can recover one lost fragment per group without a round trip. Further losses are
+ * repaired by retransmissions which receivers request through NACK packets sent to the unicast
+ * address of the sender. Heartbeat packets announce the next sequence number so receivers also
+ * notice losses at the end of a burst.
+ *
+ * Every packet ends with an HMAC keyed with a secret shared by sender and receivers (the demo access
+ * token) so nobody else on the network segment is able to inject packets. The session ID is chosen
+ * randomly by the sender and only serves to tell restarted senders apart.
+ */
+class VEYON_CORE_EXPORT VncMulticastProtocol
+{
+public:
+	typedef quint32 Sequence;
+	typedef QVector<quint16> IndexList;
+
+	enum PacketType {
+		DataPacket,
+		ParityPacket,
+		HeartbeatPacket,
+		NackPacket,
+		PacketTypeCount
+	} ;
+
+	enum PacketFlag {
+		NoFlags = 0x00,
+		KeyFrame = 0x01
+	} ;
+
+	enum {
+		Magic = 0x56594d43,		// "VYMC"
+		HeaderSize = 24,
+		MacSize = 16,				// truncated HMAC-SHA256
+		MaximumDatagramSize = 1400,	// stay below common MTUs so datagrams never get fragmented by IP
+		FragmentSize = MaximumDatagramSize - HeaderSize - MacSize,
+		MaximumFragmentCount = 0xffff,
+		FecGroupSize = 8,
+		MaximumNackIndices = FragmentSize / 2
+	};
+
+	struct Header {
+		quint32 session;
+		Sequence sequence;
+		quint16 index;	// fragment index for data packets, group index for parity packets
+		quint16 count;	// number of fragments of the message
+		quint8 type;
+		quint8 flags;
+		quint32 messageSize;
+	} ;
+
+	static Header header( quint32 session, PacketType type, Sequence sequence = 0 );
+
+	static QByteArray packet( const QByteArray& key, const Header& header, const QByteArray& payload = QByteArray() );
+
+	// verifies authentication code of datagram before parsing anything
+	static bool parsePacket( const QByteArray& key, const QByteArray& datagram, Header& header, QByteArray& payload );
+
+	static QByteArray nackPacket( const QByteArray& key, quint32 session, Sequence sequence,
+								  const IndexList& missingFragments );
+	static IndexList nackIndices( const QByteArray& payload );
+
+	static int fragmentCount( quint32 messageSize )
+	{
+		return qMax<int>( 1, static_cast<int>( ( messageSize + FragmentSize - 1 ) / FragmentSize ) );
+	}
+
+	static int fecGroupCount( int fragmentCount )
+	{
+		return ( fragmentCount + FecGroupSize - 1 ) / FecGroupSize;
+	}
+
+	static int fragmentSize( quint32 messageSize, int index );
+
+	static QByteArray fragment( const QByteArray& message, int index );
+	static QByteArray parity( const QByteArray& message, int group );
+
+	// XORs given fragment zero-padded to FragmentSize into given parity
+	static void xorFragment( QByteArray& parity, const QByteArray& fragment );
+
+private:
+	static QByteArray authenticationCode( const QByteArray& key, const char* data, int size );
+
+} ;
+
+#endif
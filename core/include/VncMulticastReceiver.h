@@ -0,0 +1,137 @@
+/*
+ * VncMulticastReceiver.h - header file for the VncMulticastReceiver class
+ *
+ * Copyright (c) 2018 Tobias Junghans <tobydox@veyon.io>
+ *
+ * This file is part of Veyon - http://veyon.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef VNC_MULTICAST_RECEIVER_H
+#define VNC_MULTICAST_RECEIVER_H
+
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QMap>
+#include <QQueue>
+#include <QTimer>
+
+#include "VncMulticastProtocol.h"
+
+class QUdpSocket;
+
+/** \brief Receives messages sent by a multicast sender and reassembles them in order
+ *
+ * Only packets authenticated with the given key are processed. Delivery starts with the first key frame
+ * received completely. Lost fragments are recovered using
+ * parity packets or requested again from the sender. If a message can't be repaired in time, all
+ * state is reset and delivery starts over with the next key frame. synchronizationLost() is emitted
+ * if messages have been delivered before as the receiver of these messages has to start over as well.
+ */
+class VncMulticastReceiver : public QObject
+{
+	Q_OBJECT
+public:
+	typedef VncMulticastProtocol::Sequence Sequence;
+
+	VncMulticastReceiver( const QHostAddress& groupAddress, int port, const QByteArray& key, QObject* parent = nullptr );
+	~VncMulticastReceiver() override;
+
+	bool isJoined() const
+	{
+		return m_joined;
+	}
+
+	bool takeMessage( QByteArray& message );
+
+signals:
+	void messagesAvailable();
+	void synchronizationLost();
+
+private slots:
+	void readDatagrams();
+	void repairMessages();
+
+private:
+	enum {
+		ReceiveBufferSize = 4*1024*1024,
+		RepairInterval = 20,		// in milliseconds
+		NackRetryInterval = 100,	// in milliseconds
+		MaximumNackCount = 5,
+		MaximumPendingMessages = 1024,
+		SenderTimeout = 3000		// in milliseconds
+	};
+
+	struct PendingMessage {
+		PendingMessage() :
+			fragments(),
+			parities(),
+			receivedFragments( 0 ),
+			messageSize( 0 ),
+			lastReceived(),
+			lastNack(),
+			nackCount( 0 )
+		{
+			lastReceived.start();
+		}
+
+		bool isComplete() const
+		{
+			return fragments.isEmpty() == false && receivedFragments >= fragments.size();
+		}
+
+		QVector<QByteArray> fragments;
+		QVector<QByteArray> parities;
+		int receivedFragments;
+		quint32 messageSize;
+		QElapsedTimer lastReceived;
+		QElapsedTimer lastNack;
+		int nackCount;
+	} ;
+
+	void processPacket( const VncMulticastProtocol::Header& header, const QByteArray& payload );
+	bool acceptsSequence( const VncMulticastProtocol::Header& header ) const;
+	void addFragment( PendingMessage& message, const VncMulticastProtocol::Header& header, const QByteArray& payload );
+	void recoverFragment( PendingMessage& message, int group );
+	void announceSequence( Sequence endSequence );
+	void deliverMessages();
+	void sendNack( Sequence sequence, PendingMessage& message );
+	void reset();
+
+	QUdpSocket* m_socket;
+	QTimer m_repairTimer;
+	const QByteArray m_key;
+	bool m_joined;
+
+	QHostAddress m_senderAddress;
+	quint16 m_senderPort;
+	QElapsedTimer m_lastPacketTime;
+
+	// session and sequence of the next message to deliver - invalid until a key frame has been seen
+	bool m_started;
+	bool m_delivered;
+	quint32 m_sessionId;
+	Sequence m_nextSequence;
+	Sequence m_endSequence;
+
+	QMap<Sequence, PendingMessage> m_pendingMessages;
+	QQueue<QByteArray> m_messages;
+
+} ;
+
+#endif
@@ -0,0 +1,104 @@
+/*
+ * VncMulticastRelay.h - header file for the VncMulticastRelay class
+ *
+ * Copyright (c) 2018 Tobias Junghans <tobydox@veyon.io>
+ *
+ * This file is part of Veyon - http://veyon.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef VNC_MULTICAST_RELAY_H
+#define VNC_MULTICAST_RELAY_H
+
+#include <QHostAddress>
+#include <QMap>
+
+#include "VncClientProtocol.h"
+
+class QTcpSocket;
+class VncMulticastReceiver;
+
+// clazy:excludeall=ctor-missing-parent-argument
+
+/** \brief Relays an established RFB connection and replaces its framebuffer updates by multicast ones
+ *
+ * The relay takes over the socket of the server connection and provides a local socket to the RFB client
+ * instead. All messages are forwarded as is until the multicast receiver delivers the first key frame.
+ * From then on framebuffer updates are taken from the multicast group only while update requests and
+ * updates received via the server connection are discarded. As each side only sees complete messages,
+ * switching sources never breaks the RFB stream. If multicast updates get lost in multicast mode,
+ * failed() is emitted and the connection has to be set up again without multicast.
+ */
+class VncMulticastRelay : public QObject
+{
+	Q_OBJECT
+public:
+	VncMulticastRelay( qintptr serverSocketDescriptor, const rfbPixelFormat& pixelFormat,
+					   const QHostAddress& groupAddress, int port, const QByteArray& key );
+	~VncMulticastRelay() override;
+
+	// descriptor of the local socket to be used by the RFB client instead of the server socket - the
+	// caller takes ownership of it - returns -1 if the relay could not be set up
+	qintptr clientSocketDescriptor() const
+	{
+		return m_clientSocketDescriptor;
+	}
+
+signals:
+	void failed();
+
+public slots:
+	void start();
+
+private slots:
+	void readFromServer();
+	void readFromClient();
+	void forwardMulticastMessages();
+	void handleSynchronizationLoss();
+
+private:
+	enum {
+		LoopbackConnectTimeout = 1000
+	};
+
+	enum Modes {
+		TcpMode,
+		MulticastMode,
+		PassthroughMode
+	} ;
+	typedef Modes Mode;
+
+	bool receiveClientMessage();
+	bool forwardClientMessage( qint64 size );
+
+	const QHostAddress m_groupAddress;
+	const int m_port;
+	const QByteArray m_key;
+
+	qintptr m_clientSocketDescriptor;
+	QTcpSocket* m_serverSocket;
+	QTcpSocket* m_clientSocket;
+	VncClientProtocol m_serverProtocol;
+	const QMap<int, int> m_rfbClientToServerMessageSizes;
+	VncMulticastReceiver* m_receiver;
+
+	Mode m_mode;
+
+} ;
+
+#endif
@@ -38,6 +38,7 @@ public:
 		AuthChallenge,
 		AuthPassword,
 		AuthToken,
+		AuthPending,
 		AuthFinishedSuccess,
 		AuthFinishedFail,
 	} AuthState;
@@ -90,6 +90,7 @@ private:
 	bool receiveAuthenticationMessage();
 
 	bool processAuthentication( VariantArrayMessage& message );
+	bool processAuthenticationResult();
 	bool processAccessControl();
 
 	bool processFramebufferInit();
@@ -26,7 +26,9 @@
 #define VNC_VIEW_H
 
 #include <QEvent>
+#include <QImage>
 #include <QPointer>
+#include <QRegion>
 #include <QWidget>
 
 #include "KeyboardShortcutTrapper.h"
@@ -100,10 +102,15 @@ private slots:
 	void updateCursorPos( int x, int y );
 	void updateCursorShape( const QPixmap& cursorShape, int xh, int yh );
 	void updateImage( int x, int y, int w, int h );
+	void finishFramebufferUpdate();
 	void updateFramebufferSize( int w, int h );
 	void updateConnectionState();
 
 private:
+	enum {
+		MaximumDamagedRects = 32	/**< Rescale bounding rect of all updated rects if exceeding given number of rects */
+	};
+
 	bool eventFilter( QObject * _obj, QEvent * _event ) override;
 	bool event( QEvent * _ev ) override;
 	void focusInEvent( QFocusEvent * ) override;
@@ -120,6 +127,7 @@ private:
 	float scaleFactor() const;
 	QPoint mapToFramebuffer( QPoint pos );
 	QRect mapFromFramebuffer( QRect rect );
+	QRegion rescaleFramebuffer( const QRegion& region );
 
 	void updateLocalCursor();
 	void pressKey( unsigned int key );
@@ -132,6 +140,8 @@ private:
 	int m_cursorX;
 	int m_cursorY;
 	QSize m_framebufferSize;
+	QRegion m_damagedRegion;
+	QImage m_scaledFramebuffer;
 	int m_cursorHotX;
 	int m_cursorHotY;
 	bool m_viewOnly;
@@ -38,12 +38,20 @@ ComputerControlInterface::ComputerControlInterface( const Computer& computer,
 	m_computer( computer ),
 	m_state( Disconnected ),
 	m_user(),
+	m_undeliveredFeature(),
 	m_scaledScreenSize(),
 	m_vncConnection( nullptr ),
 	m_coreConnection( nullptr ),
 	m_builtinFeatures( nullptr ),
-	m_screenUpdated( false )
+	m_screenUpdated( false ),
+	m_screenVisible( true ),
+	m_activeFeaturesQueryCount( 0 ),
+	m_activeFeaturesReplyCount( 0 ),
+	m_serverPollingTimer( this )
 {
+	m_serverPollingTimer.setInterval( ServerPollingInterval );
+
+	connect( &m_serverPollingTimer, &QTimer::timeout, this, &ComputerControlInterface::pollServerState );
 }
 
 
@@ -76,19 +84,18 @@ void ComputerControlInterface::start( QSize scaledScreenSize, BuiltinFeatures* b
 		m_vncConnection->setHost( m_computer.hostAddress() );
 		m_vncConnection->setQuality( VeyonVncConnection::ThumbnailQuality );
 		m_vncConnection->setScaledSize( m_scaledScreenSize );
-		m_vncConnection->setFramebufferUpdateInterval( VeyonCore::config().computerMonitoringUpdateInterval() );
+		m_vncConnection->setConnectionPool( &VeyonCore::vncConnectionPool() );
+
+		updateFramebufferUpdateInterval();
 
 		m_coreConnection = new VeyonCoreConnection( m_vncConnection );
 
 		m_vncConnection->start();
 
 		connect( m_vncConnection, &VeyonVncConnection::framebufferUpdateComplete, this, &ComputerControlInterface::setScreenUpdateFlag );
-		connect( m_vncConnection, &VeyonVncConnection::framebufferUpdateComplete ,this, &ComputerControlInterface::updateUser );
-		connect( m_vncConnection, &VeyonVncConnection::framebufferUpdateComplete, this, &ComputerControlInterface::updateActiveFeatures );
 
+		// user and active features are pushed by the server after subscribing to them once connected
 		connect( m_vncConnection, &VeyonVncConnection::stateChanged, this, &ComputerControlInterface::updateState );
-		connect( m_vncConnection, &VeyonVncConnection::stateChanged, this, &ComputerControlInterface::updateUser );
-		connect( m_vncConnection, &VeyonVncConnection::stateChanged, this, &ComputerControlInterface::updateActiveFeatures );
 
 		connect( m_coreConnection, &VeyonCoreConnection::featureMessageReceived,
 				 this, &ComputerControlInterface::handleFeatureMessage );
@@ -116,6 +123,8 @@ void ComputerControlInterface::stop()
 		m_vncConnection = nullptr;
 	}
 
+	m_serverPollingTimer.stop();
+
 	m_state = Disconnected;
 }
 
@@ -135,6 +144,18 @@ void ComputerControlInterface::setScaledScreenSize( QSize scaledScreenSize )
 
 
 
+void ComputerControlInterface::setScreenVisible( bool visible )
+{
+	if( visible != m_screenVisible )
+	{
+		m_screenVisible = visible;
+
+		updateFramebufferUpdateInterval();
+	}
+}
+
+
+
 QImage ComputerControlInterface::scaledScreen() const
 {
 	if( m_vncConnection && m_vncConnection->isConnected() )
@@ -159,6 +180,18 @@ QImage ComputerControlInterface::screen() const
 
 
 
+VeyonVncConnection::Statistics ComputerControlInterface::connectionStatistics() const
+{
+	if( m_vncConnection && m_vncConnection->isConnected() )
+	{
+		return m_vncConnection->statistics();
+	}
+
+	return VeyonVncConnection::Statistics();
+}
+
+
+
 void ComputerControlInterface::setUser( const QString& user )
 {
 	if( user != m_user )
@@ -192,6 +225,29 @@ void ComputerControlInterface::setDesignatedModeFeature( Feature::Uid designated
 
 
 
+void ComputerControlInterface::setFeatureMessageDelivered( Feature::Uid featureUid, bool delivered )
+{
+	auto undeliveredFeature = m_undeliveredFeature;
+
+	if( delivered == false )
+	{
+		undeliveredFeature = featureUid;
+	}
+	else if( featureUid == m_undeliveredFeature )
+	{
+		undeliveredFeature = Feature::Uid();
+	}
+
+	if( undeliveredFeature != m_undeliveredFeature )
+	{
+		m_undeliveredFeature = undeliveredFeature;
+
+		emit undeliveredFeatureChanged();
+	}
+}
+
+
+
 void ComputerControlInterface::sendFeatureMessage( const FeatureMessage& featureMessage )
 {
 	if( m_coreConnection && m_coreConnection->isConnected() )
@@ -202,8 +258,68 @@ void ComputerControlInterface::sendFeatureMessage( const FeatureMessage& feature
 
 
 
+FeatureMessage::Format ComputerControlInterface::featureMessageFormat() const
+{
+	if( m_coreConnection )
+	{
+		return m_coreConnection->featureMessageFormat();
+	}
+
+	return FeatureMessage::LegacyFormat;
+}
+
+
+
+bool ComputerControlInterface::sendSerializedFeatureMessage( const QByteArray& message )
+{
+	if( m_coreConnection && m_coreConnection->isConnected() )
+	{
+		m_coreConnection->sendSerializedFeatureMessage( message );
+		return true;
+	}
+
+	return false;
+}
+
+
+
+quint32 ComputerControlInterface::requestAcknowledgement()
+{
+	if( m_vncConnection && m_coreConnection && m_builtinFeatures && state() == Connected )
+	{
+		m_builtinFeatures->featureControl().queryActiveFeatures( { weakPointer() } );
+
+		return ++m_activeFeaturesQueryCount;
+	}
+
+	return 0;
+}
+
+
+
+void ComputerControlInterface::acknowledgeActiveFeaturesQuery()
+{
+	if( m_activeFeaturesReplyCount != m_activeFeaturesQueryCount )
+	{
+		++m_activeFeaturesReplyCount;
+
+		emit featureMessagesAcknowledged( m_activeFeaturesReplyCount );
+	}
+}
+
+
+
+void ComputerControlInterface::setServerNotificationsAvailable()
+{
+	m_serverPollingTimer.stop();
+}
+
+
+
 void ComputerControlInterface::updateState()
 {
+	const auto previousState = m_state;
+
 	if( m_vncConnection )
 	{
 		switch( m_vncConnection->state() )
@@ -222,7 +338,30 @@ void ComputerControlInterface::updateState()
 		m_state = Disconnected;
 	}
 
+	if( m_state != Connected )
+	{
+		// replies to outstanding queries will never be received
+		m_activeFeaturesReplyCount = m_activeFeaturesQueryCount;
+	}
+
 	setScreenUpdateFlag();
+
+	if( m_state != previousState )
+	{
+		if( m_state == Connected )
+		{
+			subscribeServerNotifications();
+		}
+		else
+		{
+			m_serverPollingTimer.stop();
+
+			setUser( QString() );
+			setActiveFeatures( {} );
+		}
+
+		emit stateChanged();
+	}
 }
 
 
@@ -246,11 +385,7 @@ void ComputerControlInterface::updateUser()
 
 void ComputerControlInterface::updateActiveFeatures()
 {
-	if( m_vncConnection && m_coreConnection && state() == Connected )
-	{
-		m_builtinFeatures->featureControl().queryActiveFeatures( { weakPointer() } );
-	}
-	else
+	if( requestAcknowledgement() == 0 )
 	{
 		setActiveFeatures( {} );
 	}
@@ -258,7 +393,58 @@ void ComputerControlInterface::updateActiveFeatures()
 
 
 
+void ComputerControlInterface::pollServerState()
+{
+	updateUser();
+	updateActiveFeatures();
+}
+
+
+
 void ComputerControlInterface::handleFeatureMessage( const FeatureMessage& message )
 {
 	emit featureMessageReceived( message, weakPointer() );
 }
+
+
+
+void ComputerControlInterface::subscribeServerNotifications()
+{
+	if( m_builtinFeatures == nullptr )
+	{
+		return;
+	}
+
+	m_builtinFeatures->featureControl().subscribeActiveFeatures( { weakPointer() } );
+	m_builtinFeatures->userSessionControl().subscribeUserSessionInfo( { weakPointer() } );
+
+	// stopped as soon as the first notification has been received
+	m_serverPollingTimer.start();
+}
+
+
+
+void ComputerControlInterface::updateFramebufferUpdateInterval()
+{
+	if( m_vncConnection == nullptr )
+	{
+		return;
+	}
+
+	if( m_screenVisible )
+	{
+		m_vncConnection->setAdaptiveFramebufferUpdateInterval( VeyonCore::config().computerMonitoringUpdateInterval(),
+															   VeyonCore::config().computerMonitoringMaximumUpdateInterval() );
+		m_vncConnection->setFramebufferUpdatesPaused( false );
+	}
+	else if( VeyonCore::config().computerMonitoringHiddenUpdateInterval() > 0 )
+	{
+		// only keep connection alive
+		m_vncConnection->setFramebufferUpdateInterval( VeyonCore::config().computerMonitoringHiddenUpdateInterval() );
+		m_vncConnection->setFramebufferUpdatesPaused( false );
+	}
+	else
+	{
+		m_vncConnection->setFramebufferUpdatesPaused( true );
+	}
+}
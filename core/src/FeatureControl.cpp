@@ -25,6 +25,7 @@
 #include "FeatureControl.h"
 #include "FeatureWorkerManager.h"
 #include "VeyonCore.h"
+#include "VeyonCoreConnection.h"
 #include "VeyonRfbExt.h"
 #include "VeyonServerInterface.h"
 
@@ -35,8 +36,21 @@ FeatureControl::FeatureControl( QObject* parent ) :
 									  Feature::Uid( "a0a96fba-425d-414a-aaf4-352b76d7c4f3" ),
 									  Feature::Uid(),
 									  tr( "Feature control" ), QString(), QString() ) ),
-	m_features( { m_featureControlFeature } )
+	m_features( { m_featureControlFeature } ),
+	m_queryActiveFeaturesMessages(),
+	m_activeFeatures(),
+	m_activeFeaturesSubscriptions( this )
 {
+	const FeatureMessage queryActiveFeaturesMessage( m_featureControlFeature.uid(), QueryActiveFeatures );
+
+	m_queryActiveFeaturesMessages.reserve( FeatureMessage::FormatCount );
+
+	for( int format = 0; format < FeatureMessage::FormatCount; ++format )
+	{
+		m_queryActiveFeaturesMessages.append(
+					VeyonCoreConnection::serializeFeatureMessage( queryActiveFeaturesMessage,
+																  static_cast<FeatureMessage::Format>( format ) ) );
+	}
 }
 
 
@@ -49,8 +63,27 @@ FeatureControl::~FeatureControl()
 
 bool FeatureControl::queryActiveFeatures( const ComputerControlInterfaceList& computerControlInterfaces )
 {
-	return sendFeatureMessage( FeatureMessage( m_featureControlFeature.uid(), QueryActiveFeatures ),
-							   computerControlInterfaces );
+	for( auto controlInterface : computerControlInterfaces )
+	{
+		controlInterface->sendSerializedFeatureMessage(
+					m_queryActiveFeaturesMessages[controlInterface->featureMessageFormat()] );
+	}
+
+	return true;
+}
+
+
+
+bool FeatureControl::subscribeActiveFeatures( const ComputerControlInterfaceList& computerControlInterfaces )
+{
+	const FeatureMessage message( m_featureControlFeature.uid(), SubscribeActiveFeatures );
+
+	for( auto controlInterface : computerControlInterfaces )
+	{
+		controlInterface->sendFeatureMessage( message );
+	}
+
+	return true;
 }
 
 
@@ -64,6 +97,19 @@ bool FeatureControl::handleFeatureMessage( VeyonMasterInterface& master, const F
 	{
 		computerControlInterface->setActiveFeatures( message.argument( ActiveFeatureList ).toStringList() );
 
+		switch( message.command() )
+		{
+		case QueryActiveFeatures:
+			computerControlInterface->acknowledgeActiveFeaturesQuery();
+			break;
+		case ActiveFeaturesChanged:
+			computerControlInterface->setServerNotificationsAvailable();
+			break;
+		default:
+			// older servers reply to subscriptions once only
+			break;
+		}
+
 		return true;
 	}
 
@@ -76,15 +122,35 @@ bool FeatureControl::handleFeatureMessage( VeyonServerInterface& server, const F
 {
 	if( m_featureControlFeature.uid() == message.featureUid() )
 	{
-		FeatureMessage reply( message.featureUid(), message.command() );
+		auto replyCommand = message.command();
+
+		if( message.command() == SubscribeActiveFeatures )
+		{
+			connect( &server.featureWorkerManager(), &FeatureWorkerManager::runningWorkersChanged,
+					 this, &FeatureControl::notifyActiveFeaturesSubscribers, Qt::UniqueConnection );
+
+			m_activeFeaturesSubscriptions.subscribe( server, message.ioDevice() );
+
+			replyCommand = ActiveFeaturesChanged;
+		}
+
+		FeatureMessage reply( message.featureUid(), replyCommand );
 		reply.addArgument( ActiveFeatureList, server.featureWorkerManager().runningWorkers() );
 
-		char rfbMessageType = rfbVeyonFeatureMessage;
-		message.ioDevice()->write( &rfbMessageType, sizeof(rfbMessageType) );
-		reply.send( message.ioDevice() );
+		server.sendFeatureMessage( message.ioDevice(), reply );
 
 		return true;
 	}
 
 	return false;
 }
+
+
+
+void FeatureControl::notifyActiveFeaturesSubscribers( const FeatureUidList& activeFeatures )
+{
+	FeatureMessage message( m_featureControlFeature.uid(), ActiveFeaturesChanged );
+	message.addArgument( ActiveFeatureList, activeFeatures );
+
+	m_activeFeaturesSubscriptions.notify( message );
+}
@@ -22,8 +22,15 @@
  *
  */
 
+#include <QBuffer>
+#include <QDataStream>
+#include <QtEndian>
+
 #include "FeatureMessage.h"
 #include "VariantArrayMessage.h"
+#include "VariantStream.h"
+
+static const char* featureMessageFormatProperty = "featureMessageFormat";
 
 
 bool FeatureMessage::send()
@@ -35,20 +42,56 @@ bool FeatureMessage::send()
 
 bool FeatureMessage::send( QIODevice* ioDevice ) const
 {
-	if( ioDevice )
+	return send( ioDevice, format( ioDevice ) );
+}
+
+
+
+bool FeatureMessage::send( QIODevice* ioDevice, Format format ) const
+{
+	if( ioDevice == nullptr )
+	{
+		qCritical( "FeatureMessage::send(): no IO device!" );
+		return false;
+	}
+
+	if( format == LegacyFormat )
 	{
 		VariantArrayMessage message( ioDevice );
 
+		QVariantMap arguments;
+		for( auto it = m_arguments.constBegin(), end = m_arguments.constEnd(); it != end; ++it )
+		{
+			arguments[QString::number( it.key() )] = it.value();
+		}
+
 		message.write( m_featureUid );
 		message.write( m_command );
-		message.write( m_arguments );
+		message.write( arguments );
 
 		return message.send();
 	}
 
-	qCritical( "FeatureMessage::send(): no IO device!" );
+	QByteArray payload;
 
-	return false;
+	QDataStream stream( &payload, QIODevice::WriteOnly );
+	stream.setVersion( QDataStream::Qt_5_5 );
+
+	stream << static_cast<quint8>( CompactFormat );
+	stream.writeRawData( m_featureUid.toRfc4122().constData(), 16 );
+	stream << m_command;
+	stream << static_cast<quint16>( m_arguments.size() );
+
+	for( auto it = m_arguments.constBegin(), end = m_arguments.constEnd(); it != end; ++it )
+	{
+		stream << static_cast<quint16>( it.key() ) << it.value();
+	}
+
+	const auto messageSize = qToBigEndian<MessageSize>( static_cast<MessageSize>( payload.size() ) );
+	ioDevice->write( reinterpret_cast<const char *>( &messageSize ), sizeof(messageSize) );
+	ioDevice->write( payload );
+
+	return true;
 }
 
 
@@ -63,29 +106,129 @@ bool FeatureMessage::isReadyForReceive()
 
 bool FeatureMessage::receive()
 {
-	if( m_ioDevice )
+	if( m_ioDevice == nullptr )
 	{
-		VariantArrayMessage message( m_ioDevice );
+		qCritical( "FeatureMessage::receive(): no IO device!" );
+		return false;
+	}
+
+	MessageSize messageSize;
+
+	if( m_ioDevice->read( reinterpret_cast<char *>( &messageSize ), sizeof(messageSize) ) != sizeof(messageSize) ) // Flawfinder: ignore
+	{
+		qWarning( "FeatureMessage::receive(): could not read message size!" );
+		return false;
+	}
+
+	messageSize = qFromBigEndian(messageSize);
+	if( messageSize > MaxMessageSize )
+	{
+		qCritical() << Q_FUNC_INFO << "invalid message size" << messageSize;
+		return false;
+	}
+
+	auto data = m_ioDevice->read( messageSize ); // Flawfinder: ignore
+	if( data.size() != static_cast<qint64>( messageSize ) )
+	{
+		qWarning( "FeatureMessage::receive(): could not read message data!" );
+		return false;
+	}
+
+	QBuffer buffer( &data );
+	buffer.open( QBuffer::ReadOnly ); // Flawfinder: ignore
 
-		if( message.receive() )
+	// peers may use different formats for each direction so always determine format per message
+	if( data.isEmpty() == false && data[0] == CompactFormat )
+	{
+		if( receiveCompactFormat( &buffer ) )
 		{
-			m_featureUid = message.read().toUuid(); // Flawfinder: ignore
+			return true;
+		}
+	}
+	else if( receiveLegacyFormat( &buffer ) )
+	{
+		return true;
+	}
+
+	qWarning( "FeatureMessage::receive(): could not receive message!" );
+
+	return false;
+}
+
+
+
+void FeatureMessage::setFormat( QIODevice* ioDevice, Format format )
+{
+	ioDevice->setProperty( featureMessageFormatProperty, format );
+}
+
+
+
+FeatureMessage::Format FeatureMessage::format( const QIODevice* ioDevice )
+{
+	// devices without negotiated format (e.g. worker connections) always use legacy format
+	if( ioDevice )
+	{
+		return static_cast<Format>( ioDevice->property( featureMessageFormatProperty ).toInt() );
+	}
+
+	return LegacyFormat;
+}
+
+
+
+bool FeatureMessage::receiveLegacyFormat( QIODevice* ioDevice )
+{
+	VariantStream stream( ioDevice );
+
+	m_featureUid = stream.read().toUuid(); // Flawfinder: ignore
 #if QT_VERSION < 0x050600
 #warning Building legacy compat code for unsupported version of Qt
-			m_command = static_cast<Command>( message.read().toInt() ); // Flawfinder: ignore
+	m_command = static_cast<Command>( stream.read().toInt() ); // Flawfinder: ignore
 #else
-			m_command = message.read().value<Command>(); // Flawfinder: ignore
+	m_command = stream.read().value<Command>(); // Flawfinder: ignore
 #endif
-			m_arguments = message.read().toMap(); // Flawfinder: ignore
-			return true;
-		}
 
-		qWarning( "FeatureMessage::receive(): could not receive message!" );
+	const auto arguments = stream.read().toMap(); // Flawfinder: ignore
+
+	m_arguments.clear();
+	for( auto it = arguments.constBegin(), end = arguments.constEnd(); it != end; ++it )
+	{
+		m_arguments[it.key().toInt()] = it.value();
+	}
+
+	return true;
+}
+
+
+
+bool FeatureMessage::receiveCompactFormat( QIODevice* ioDevice )
+{
+	QDataStream stream( ioDevice );
+	stream.setVersion( QDataStream::Qt_5_5 );
+
+	quint8 format = 0;
+	char featureUid[16]; // Flawfinder: ignore
+	quint16 argumentCount = 0;
+
+	stream >> format;
+	if( stream.readRawData( featureUid, sizeof(featureUid) ) != sizeof(featureUid) ) // Flawfinder: ignore
+	{
+		return false;
 	}
-	else
+
+	stream >> m_command >> argumentCount;
+
+	m_featureUid = QUuid::fromRfc4122( QByteArray::fromRawData( featureUid, sizeof(featureUid) ) );
+
+	m_arguments.clear();
+	for( int i = 0; i < argumentCount && stream.status() == QDataStream::Ok; ++i )
 	{
-		qCritical( "FeatureMessage::receive(): no IO device!" );
+		quint16 key = 0;
+		QVariant value;
+		stream >> key >> value;
+		m_arguments[key] = value;
 	}
 
-	return false;
+	return stream.status() == QDataStream::Ok;
 }
@@ -0,0 +1,226 @@
+/*
+ * FeatureMessageBroadcast.cpp - implementation of FeatureMessageBroadcast class
+ *
+ * Copyright (c) 2018 Tobias Junghans <tobydox@veyon.io>
+ *
+ * This file is part of Veyon - http://veyon.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include "FeatureMessage.h"
+#include "FeatureMessageBroadcast.h"
+#include "VeyonCoreConnection.h"
+
+
+FeatureMessageBroadcast::FeatureMessageBroadcast( const FeatureMessage& message, QObject* parent ) :
+	QObject( parent ),
+	m_message( message ),
+	m_serializedMessages( FeatureMessage::FormatCount ),
+	m_deliveryStates(),
+	m_connections(),
+	m_computerControlInterfaces(),
+	m_timeoutTimer( this ),
+	m_sending( false ),
+	m_finished( false )
+{
+	m_timeoutTimer.setSingleShot( true );
+
+	connect( &m_timeoutTimer, &QTimer::timeout, this, &FeatureMessageBroadcast::abortPendingDeliveries );
+}
+
+
+
+FeatureMessageBroadcast::~FeatureMessageBroadcast()
+{
+	for( const auto& connection : qAsConst( m_connections ) )
+	{
+		disconnect( connection );
+	}
+}
+
+
+
+FeatureMessageBroadcast* FeatureMessageBroadcast::send( const FeatureMessage& message,
+														const ComputerControlInterfaceList& computerControlInterfaces )
+{
+	auto broadcast = new FeatureMessageBroadcast( message );
+
+	connect( broadcast, &FeatureMessageBroadcast::finished, broadcast, &QObject::deleteLater );
+
+	broadcast->sendTo( computerControlInterfaces );
+
+	return broadcast;
+}
+
+
+
+void FeatureMessageBroadcast::sendTo( const ComputerControlInterfaceList& computerControlInterfaces )
+{
+	m_sending = true;
+
+	for( const auto& controlInterface : computerControlInterfaces )
+	{
+		const auto host = controlInterface->computer().hostAddress();
+
+		m_computerControlInterfaces[host] = controlInterface.data();
+
+		if( controlInterface->sendSerializedFeatureMessage(
+					serializedMessage( controlInterface->featureMessageFormat() ) ) == false )
+		{
+			setDeliveryState( host, DeliveryFailed );
+			continue;
+		}
+
+		const auto acknowledgement = controlInterface->requestAcknowledgement();
+		if( acknowledgement == 0 )
+		{
+			setDeliveryState( host, DeliveryFailed );
+			continue;
+		}
+
+		m_deliveryStates[host] = DeliveryPending;
+
+		auto computerControlInterface = controlInterface.data();
+
+		m_connections.insertMulti( host, connect( computerControlInterface, &ComputerControlInterface::featureMessagesAcknowledged,
+												  this, [=]( quint32 acknowledged ) {
+			if( acknowledged >= acknowledgement )
+			{
+				setDeliveryState( host, DeliveryAcknowledged );
+			}
+		} ) );
+
+		m_connections.insertMulti( host, connect( computerControlInterface, &ComputerControlInterface::stateChanged,
+												  this, [=]() {
+			if( computerControlInterface->state() != ComputerControlInterface::Connected )
+			{
+				setDeliveryState( host, DeliveryFailed );
+			}
+		} ) );
+	}
+
+	m_sending = false;
+
+	if( isFinished() )
+	{
+		// let caller connect to finished() signal first
+		QTimer::singleShot( 0, this, &FeatureMessageBroadcast::finish );
+	}
+	else
+	{
+		m_timeoutTimer.start( AcknowledgementTimeout );
+	}
+}
+
+
+
+int FeatureMessageBroadcast::count( DeliveryState state ) const
+{
+	int stateCount = 0;
+
+	for( auto deliveryState : m_deliveryStates )
+	{
+		if( deliveryState == state )
+		{
+			++stateCount;
+		}
+	}
+
+	return stateCount;
+}
+
+
+
+void FeatureMessageBroadcast::setDeliveryState( const QString& host, DeliveryState state )
+{
+	const auto it = m_deliveryStates.constFind( host );
+	if( it != m_deliveryStates.constEnd() && it.value() != DeliveryPending )
+	{
+		return;
+	}
+
+	m_deliveryStates[host] = state;
+
+	for( const auto& connection : m_connections.values( host ) )
+	{
+		disconnect( connection );
+	}
+
+	m_connections.remove( host );
+
+	const auto computerControlInterface = m_computerControlInterfaces.value( host );
+	if( computerControlInterface )
+	{
+		computerControlInterface->setFeatureMessageDelivered( m_message.featureUid(), state == DeliveryAcknowledged );
+	}
+
+	emit deliveryStateChanged( host, state );
+
+	if( m_sending == false && isFinished() )
+	{
+		finish();
+	}
+}
+
+
+
+void FeatureMessageBroadcast::finish()
+{
+	if( m_finished )
+	{
+		return;
+	}
+
+	m_finished = true;
+	m_timeoutTimer.stop();
+
+	const auto failedDeliveries = count( DeliveryFailed );
+	if( failedDeliveries > 0 )
+	{
+		qWarning() << "FeatureMessageBroadcast: message for feature" << m_message.featureUid()
+				   << "not acknowledged by" << failedDeliveries << "of" << m_deliveryStates.size() << "computers";
+	}
+
+	emit finished();
+}
+
+
+
+const QByteArray& FeatureMessageBroadcast::serializedMessage( FeatureMessage::Format format )
+{
+	auto& serializedMessage = m_serializedMessages[format];
+
+	if( serializedMessage.isEmpty() )
+	{
+		serializedMessage = VeyonCoreConnection::serializeFeatureMessage( m_message, format );
+	}
+
+	return serializedMessage;
+}
+
+
+
+void FeatureMessageBroadcast::abortPendingDeliveries()
+{
+	const auto hosts = m_deliveryStates.keys( DeliveryPending );
+
+	for( const auto& host : hosts )
+	{
+		setDeliveryState( host, DeliveryFailed );
+	}
+}
@@ -0,0 +1,100 @@
+/*
+ * FeatureSubscriptions.cpp - implementation of FeatureSubscriptions class
+ *
+ * Copyright (c) 2018 Tobias Junghans <tobydox@veyon.io>
+ *
+ * This file is part of Veyon - http://veyon.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include <QIODevice>
+
+#include "FeatureSubscriptions.h"
+#include "VeyonServerInterface.h"
+
+
+FeatureSubscriptions::FeatureSubscriptions( QObject* parent ) :
+	QObject( parent ),
+	m_mutex(),
+	m_server( nullptr ),
+	m_subscribers()
+{
+}
+
+
+
+FeatureSubscriptions::~FeatureSubscriptions()
+{
+}
+
+
+
+void FeatureSubscriptions::subscribe( VeyonServerInterface& server, QIODevice* ioDevice )
+{
+	QMutexLocker locker( &m_mutex );
+
+	m_server = &server;
+
+	if( m_subscribers.contains( ioDevice ) == false )
+	{
+		m_subscribers.append( ioDevice );
+
+		// emitted within the thread of the connection while the IO device is being deleted
+		connect( ioDevice, &QObject::destroyed, this, &FeatureSubscriptions::unsubscribe, Qt::DirectConnection );
+	}
+}
+
+
+
+bool FeatureSubscriptions::isEmpty()
+{
+	QMutexLocker locker( &m_mutex );
+
+	return m_subscribers.isEmpty();
+}
+
+
+
+void FeatureSubscriptions::notify( const FeatureMessage& message )
+{
+	m_mutex.lock();
+	const auto server = m_server;
+	const auto subscribers = m_subscribers;
+	m_mutex.unlock();
+
+	// do not hold lock while sending as the server verifies each connection still exists
+	for( auto ioDevice : subscribers )
+	{
+		server->sendFeatureMessage( ioDevice, message );
+	}
+}
+
+
+
+void FeatureSubscriptions::unsubscribe( QObject* ioDevice )
+{
+	m_mutex.lock();
+	const bool subscribersGone = m_subscribers.removeAll( static_cast<QIODevice *>( ioDevice ) ) > 0 &&
+			m_subscribers.isEmpty();
+	m_mutex.unlock();
+
+	if( subscribersGone )
+	{
+		emit this->subscribersGone();
+	}
+}
@@ -41,8 +41,13 @@ FeatureWorkerManager::FeatureWorkerManager( VeyonServerInterface& server, Featur
 	QObject( parent ),
 	m_server( server ),
 	m_featureManager( featureManager ),
-	m_tcpServer( this )
+	m_tcpServer( this ),
+	m_workers(),
+	m_standbyWorkerEnabled( VeyonCore::config().isFeatureWorkerStandbyEnabled() ),
+	m_standbyWorker()
 {
+	qRegisterMetaType<FeatureWorkerManager::WorkerProcessMode>();
+
 	connect( &m_tcpServer, &QTcpServer::newConnection,
 			 this, &FeatureWorkerManager::acceptConnection );
 
@@ -51,11 +56,10 @@ FeatureWorkerManager::FeatureWorkerManager( VeyonServerInterface& server, Featur
 	{
 		qCritical( "FeatureWorkerManager: can't listen on localhost!" );
 	}
-
-	auto pendingMessagesTimer = new QTimer( this );
-	connect( pendingMessagesTimer, &QTimer::timeout, this, &FeatureWorkerManager::sendPendingMessages );
-
-	pendingMessagesTimer->start( 100 );
+	else
+	{
+		startStandbyWorker();
+	}
 }
 
 
@@ -66,6 +70,8 @@ FeatureWorkerManager::~FeatureWorkerManager()
 
 	m_tcpServer.close();
 
+	stopStandbyWorker();
+
 	// properly shutdown all worker processes
 	while( m_workers.isEmpty() == false )
 	{
@@ -77,12 +83,15 @@ FeatureWorkerManager::~FeatureWorkerManager()
 
 
 
-void FeatureWorkerManager::startWorker( const Feature& feature, WorkerProcessMode workerProcessMode )
+void FeatureWorkerManager::startWorker( const Feature& feature, FeatureWorkerManager::WorkerProcessMode workerProcessMode )
 {
+	// feature messages are handled in the main thread so this only applies to other callers which
+	// must not block as the main thread may be waiting for them (e.g. when stopping the server)
 	if( thread() != QThread::currentThread() )
 	{
-		QMetaObject::invokeMethod( this, "startWorker", Qt::BlockingQueuedConnection,
-								   Q_ARG( Feature, feature ) );
+		QMetaObject::invokeMethod( this, "startWorker", Qt::QueuedConnection,
+								   Q_ARG( Feature, feature ),
+								   Q_ARG( FeatureWorkerManager::WorkerProcessMode, workerProcessMode ) );
 		return;
 	}
 
@@ -90,7 +99,17 @@ void FeatureWorkerManager::startWorker( const Feature& feature, WorkerProcessMod
 
 	Worker worker;
 
-	if( workerProcessMode == ManagedSystemProcess )
+	if( workerProcessMode == ManagedSystemProcess && m_standbyWorker.socket )
+	{
+		qDebug() << "Assigning standby worker to feature" << feature.displayName() << feature.uid();
+
+		worker = m_standbyWorker;
+		m_standbyWorker = Worker();
+
+		// let worker initialize feature before receiving any other messages
+		FeatureMessage( feature.uid(), FeatureMessage::InitCommand ).send( worker.socket );
+	}
+	else if( workerProcessMode == ManagedSystemProcess )
 	{
 		worker.process = new QProcess;
 		worker.process->setProcessChannelMode( QProcess::ForwardedChannels );
@@ -112,6 +131,14 @@ void FeatureWorkerManager::startWorker( const Feature& feature, WorkerProcessMod
 	m_workersMutex.lock();
 	m_workers[feature.uid()] = worker;
 	m_workersMutex.unlock();
+
+	if( workerProcessMode == ManagedSystemProcess )
+	{
+		// replace assigned or crashed standby worker in the background
+		startStandbyWorker();
+	}
+
+	emit runningWorkersChanged( runningWorkers() );
 }
 
 
@@ -120,14 +147,16 @@ void FeatureWorkerManager::stopWorker( const Feature &feature )
 {
 	if( thread() != QThread::currentThread() )
 	{
-		QMetaObject::invokeMethod( this, "stopWorker", Qt::BlockingQueuedConnection,
+		QMetaObject::invokeMethod( this, "stopWorker", Qt::QueuedConnection,
 								   Q_ARG( Feature, feature ) );
 		return;
 	}
 
 	m_workersMutex.lock();
 
-	if( m_workers.contains( feature.uid() ) )
+	const bool workerRunning = m_workers.contains( feature.uid() );
+
+	if( workerRunning )
 	{
 		qDebug() << "Stopping worker for feature" << feature.displayName() << feature.uid();
 
@@ -155,6 +184,11 @@ void FeatureWorkerManager::stopWorker( const Feature &feature )
 	}
 
 	m_workersMutex.unlock();
+
+	if( workerRunning )
+	{
+		emit runningWorkersChanged( runningWorkers() );
+	}
 }
 
 
@@ -169,6 +203,16 @@ void FeatureWorkerManager::sendMessage( const FeatureMessage& message )
 	}
 
 	m_workersMutex.unlock();
+
+	// worker sockets may only be accessed within our thread
+	if( thread() == QThread::currentThread() )
+	{
+		sendPendingMessages();
+	}
+	else
+	{
+		QMetaObject::invokeMethod( this, "sendPendingMessages", Qt::QueuedConnection );
+	}
 }
 
 
@@ -217,31 +261,52 @@ void FeatureWorkerManager::acceptConnection()
 void FeatureWorkerManager::processConnection( QTcpSocket* socket )
 {
 	FeatureMessage message( socket );
-	message.receive();
-
-	m_workersMutex.lock();
 
-	// set socket information
-	if( m_workers.contains( message.featureUid() ) )
+	// readyRead() is not emitted again for data already received so process all complete messages
+	while( message.isReadyForReceive() && message.receive() )
 	{
-		if( m_workers[message.featureUid()].socket.isNull() )
+		if( message.featureUid().isNull() && message.command() == FeatureMessage::InitCommand )
 		{
-			m_workers[message.featureUid()].socket = socket;
+			if( m_standbyWorker.process && m_standbyWorker.socket.isNull() )
+			{
+				qDebug( "FeatureWorkerManager: standby worker ready" );
+				m_standbyWorker.socket = socket;
+			}
+			continue;
 		}
 
-		m_workersMutex.unlock();
+		m_workersMutex.lock();
 
-		if( message.command() >= 0 )
+		// set socket information
+		if( m_workers.contains( message.featureUid() ) )
 		{
-			m_featureManager.handleFeatureMessage( m_server, message );
+			bool workerConnected = false;
+
+			if( m_workers[message.featureUid()].socket.isNull() )
+			{
+				m_workers[message.featureUid()].socket = socket;
+				workerConnected = true;
+			}
+
+			m_workersMutex.unlock();
+
+			if( workerConnected )
+			{
+				// deliver messages sent before the worker connected
+				sendPendingMessages();
+			}
+
+			if( message.command() >= 0 )
+			{
+				m_featureManager.handleFeatureMessage( m_server, message );
+			}
 		}
+		else
+		{
+			m_workersMutex.unlock();
 
-	}
-	else
-	{
-		m_workersMutex.unlock();
-
-		qCritical() << "FeatureWorkerManager: got data from non-existing worker!" << message.featureUid();
+			qCritical() << "FeatureWorkerManager: got data from non-existing worker!" << message.featureUid();
+		}
 	}
 }
 
@@ -251,12 +316,15 @@ void FeatureWorkerManager::closeConnection( QTcpSocket* socket )
 {
 	m_workersMutex.lock();
 
+	bool workersRemoved = false;
+
 	for( auto it = m_workers.begin(); it != m_workers.end(); )
 	{
 		if( it.value().socket == socket )
 		{
 			qDebug() << "FeatureWorkerManager::closeConnection(): removing worker after socket has been closed";
 			it = m_workers.erase( it );
+			workersRemoved = true;
 		}
 		else
 		{
@@ -266,11 +334,61 @@ void FeatureWorkerManager::closeConnection( QTcpSocket* socket )
 
 	m_workersMutex.unlock();
 
+	if( socket == m_standbyWorker.socket )
+	{
+		qWarning( "FeatureWorkerManager::closeConnection(): standby worker quit unexpectedly" );
+		m_standbyWorker = Worker();
+	}
+
+	if( workersRemoved )
+	{
+		emit runningWorkersChanged( runningWorkers() );
+	}
+
 	socket->deleteLater();
 }
 
 
 
+void FeatureWorkerManager::startStandbyWorker()
+{
+	// do not start another standby worker while previous one has not even connected yet
+	if( m_standbyWorkerEnabled == false || m_standbyWorker.process )
+	{
+		return;
+	}
+
+	m_standbyWorker.process = new QProcess;
+	m_standbyWorker.process->setProcessChannelMode( QProcess::ForwardedChannels );
+
+	connect( m_standbyWorker.process, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+			 m_standbyWorker.process, &QProcess::deleteLater );
+
+	qDebug( "Starting standby worker (managed system process)" );
+	m_standbyWorker.process->start( VeyonCore::filesystem().workerFilePath(), { standbyWorkerArgument() } );
+}
+
+
+
+void FeatureWorkerManager::stopStandbyWorker()
+{
+	if( m_standbyWorker.socket )
+	{
+		// worker quits as soon as its connection has been closed
+		m_standbyWorker.socket->disconnect( this );
+		m_standbyWorker.socket->close();
+		m_standbyWorker.socket->deleteLater();
+	}
+	else if( m_standbyWorker.process )
+	{
+		m_standbyWorker.process->terminate();
+	}
+
+	m_standbyWorker = Worker();
+}
+
+
+
 void FeatureWorkerManager::sendPendingMessages()
 {
 	m_workersMutex.lock();
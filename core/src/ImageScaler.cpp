@@ -0,0 +1,239 @@
+/*
+ * ImageScaler.cpp - implementation of ImageScaler class
+ *
+ * Copyright (c) 2018 Tobias Junghans <tobydox@veyon.io>
+ *
+ * This file is part of Veyon - http://veyon.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include <QVector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "ImageScaler.h"
+
+
+// first source pixel covered by given destination pixel
+static inline int spanStart( int position, int sourceLength, int destinationLength )
+{
+	return static_cast<int>( static_cast<qint64>( position ) * sourceLength / destinationLength );
+}
+
+
+
+// source pixel following the last source pixel covered by given destination pixel
+static inline int spanEnd( int position, int sourceLength, int destinationLength )
+{
+	// cover at least one source pixel when upscaling
+	return qMax( spanStart( position, sourceLength, destinationLength ) + 1,
+				 spanStart( position + 1, sourceLength, destinationLength ) );
+}
+
+
+
+QRect ImageScaler::mapToDestination( const QRect& sourceRect, QSize sourceSize, QSize destinationSize )
+{
+	if( sourceSize.isEmpty() || destinationSize.isEmpty() || sourceRect.isEmpty() )
+	{
+		return QRect();
+	}
+
+	// be conservative and include neighbouring pixels as spans are rounded
+	const int left = spanStart( sourceRect.left(), destinationSize.width(), sourceSize.width() ) - 1;
+	const int top = spanStart( sourceRect.top(), destinationSize.height(), sourceSize.height() ) - 1;
+	const int right = spanStart( sourceRect.right() + 1, destinationSize.width(), sourceSize.width() ) + 1;
+	const int bottom = spanStart( sourceRect.bottom() + 1, destinationSize.height(), sourceSize.height() ) + 1;
+
+	return QRect( QPoint( left, top ), QPoint( right, bottom ) ).intersected( QRect( QPoint( 0, 0 ), destinationSize ) );
+}
+
+
+
+bool ImageScaler::scale( const QImage& source, QImage& destination, const QRect& destinationRect )
+{
+	if( source.depth() != 32 || destination.depth() != 32 )
+	{
+		qWarning( "ImageScaler::scale(): unsupported image format" );
+		return false;
+	}
+
+	const auto rect = destinationRect.intersected( destination.rect() );
+	if( rect.isEmpty() )
+	{
+		return true;
+	}
+
+	const int sourceWidth = source.width();
+	const int sourceHeight = source.height();
+	const int destinationWidth = destination.width();
+	const int destinationHeight = destination.height();
+
+	if( source.size() == destination.size() )
+	{
+		// nothing to scale so just copy pixels
+		for( int y = rect.top(); y <= rect.bottom(); ++y )
+		{
+			memcpy( reinterpret_cast<QRgb *>( destination.scanLine( y ) ) + rect.left(), // Flawfinder: ignore
+					reinterpret_cast<const QRgb *>( source.constScanLine( y ) ) + rect.left(),
+					rect.width() * sizeof( QRgb ) );
+		}
+
+		return true;
+	}
+
+	QVector<int> columnStarts( rect.width() );
+	QVector<int> columnEnds( rect.width() );
+
+	for( int i = 0; i < rect.width(); ++i )
+	{
+		columnStarts[i] = spanStart( rect.left() + i, sourceWidth, destinationWidth );
+		columnEnds[i] = spanEnd( rect.left() + i, sourceWidth, destinationWidth );
+	}
+
+	// one sum per color channel and destination pixel
+	QVector<quint32> sums( rect.width() * 4 );
+
+	for( int y = rect.top(); y <= rect.bottom(); ++y )
+	{
+		const int rowStart = spanStart( y, sourceHeight, destinationHeight );
+		const int rowEnd = spanEnd( y, sourceHeight, destinationHeight );
+
+		sums.fill( 0 );
+
+		for( int sourceY = rowStart; sourceY < rowEnd; ++sourceY )
+		{
+			sumRow( reinterpret_cast<const QRgb *>( source.constScanLine( sourceY ) ),
+					columnStarts.constData(), columnEnds.constData(), rect.width(), sums.data() );
+		}
+
+		storeAverages( sums.constData(), columnStarts.constData(), columnEnds.constData(),
+					   rowEnd - rowStart, rect.width(),
+					   reinterpret_cast<QRgb *>( destination.scanLine( y ) ) + rect.left() );
+	}
+
+	return true;
+}
+
+
+
+#ifdef __SSE2__
+
+void ImageScaler::sumRow( const QRgb* sourceLine, const int* columnStarts, const int* columnEnds,
+						  int width, quint32* sums )
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	for( int i = 0; i < width; ++i )
+	{
+		const int end = columnEnds[i];
+		int x = columnStarts[i];
+
+		auto sumPointer = reinterpret_cast<__m128i *>( sums + i * 4 );
+		__m128i sum = _mm_loadu_si128( sumPointer );
+
+		if( end - x <= MaximumVectorizedSpan )
+		{
+			// sum up two pixels at once in 16 bit lanes
+			__m128i pixelSum = zero;
+			for( ; x + 1 < end; x += 2 )
+			{
+				const __m128i pixels = _mm_loadl_epi64( reinterpret_cast<const __m128i *>( sourceLine + x ) );
+				pixelSum = _mm_add_epi16( pixelSum, _mm_unpacklo_epi8( pixels, zero ) );
+			}
+
+			// add sums of second pixel to first pixel
+			pixelSum = _mm_add_epi16( pixelSum, _mm_srli_si128( pixelSum, 8 ) );
+
+			if( x < end )
+			{
+				const __m128i pixel = _mm_cvtsi32_si128( static_cast<int>( sourceLine[x] ) );
+				pixelSum = _mm_add_epi16( pixelSum, _mm_unpacklo_epi8( pixel, zero ) );
+			}
+
+			sum = _mm_add_epi32( sum, _mm_unpacklo_epi16( pixelSum, zero ) );
+		}
+		else
+		{
+			for( ; x < end; ++x )
+			{
+				const __m128i pixel = _mm_cvtsi32_si128( static_cast<int>( sourceLine[x] ) );
+				sum = _mm_add_epi32( sum, _mm_unpacklo_epi16( _mm_unpacklo_epi8( pixel, zero ), zero ) );
+			}
+		}
+
+		_mm_storeu_si128( sumPointer, sum );
+	}
+}
+
+
+
+void ImageScaler::storeAverages( const quint32* sums, const int* columnStarts, const int* columnEnds,
+								 int rowCount, int width, QRgb* destinationLine )
+{
+	for( int i = 0; i < width; ++i )
+	{
+		const __m128i sum = _mm_loadu_si128( reinterpret_cast<const __m128i *>( sums + i * 4 ) );
+		const __m128 factor = _mm_set1_ps( 1.0f / ( ( columnEnds[i] - columnStarts[i] ) * rowCount ) );
+
+		__m128i average = _mm_cvtps_epi32( _mm_mul_ps( _mm_cvtepi32_ps( sum ), factor ) );
+		average = _mm_packs_epi32( average, average );
+		average = _mm_packus_epi16( average, average );
+
+		destinationLine[i] = static_cast<QRgb>( _mm_cvtsi128_si32( average ) ) | 0xff000000;
+	}
+}
+
+#else
+
+void ImageScaler::sumRow( const QRgb* sourceLine, const int* columnStarts, const int* columnEnds,
+						  int width, quint32* sums )
+{
+	for( int i = 0; i < width; ++i )
+	{
+		auto sum = sums + i * 4;
+
+		for( int x = columnStarts[i]; x < columnEnds[i]; ++x )
+		{
+			const auto pixel = sourceLine[x];
+			sum[0] += qBlue( pixel );
+			sum[1] += qGreen( pixel );
+			sum[2] += qRed( pixel );
+		}
+	}
+}
+
+
+
+void ImageScaler::storeAverages( const quint32* sums, const int* columnStarts, const int* columnEnds,
+								 int rowCount, int width, QRgb* destinationLine )
+{
+	for( int i = 0; i < width; ++i )
+	{
+		const auto sum = sums + i * 4;
+		const quint32 count = static_cast<quint32>( ( columnEnds[i] - columnStarts[i] ) * rowCount );
+
+		destinationLine[i] = qRgb( ( sum[2] + count / 2 ) / count,
+								   ( sum[1] + count / 2 ) / count,
+								   ( sum[0] + count / 2 ) / count );
+	}
+}
+
+#endif
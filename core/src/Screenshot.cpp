@@ -27,12 +27,14 @@
 #include <QApplication>
 #include <QMessageBox>
 #include <QPainter>
+#include <QTimer>
 
 #include "Screenshot.h"
 #include "VeyonConfiguration.h"
 #include "Computer.h"
 #include "ComputerControlInterface.h"
 #include "Filesystem.h"
+#include "VeyonVncConnection.h"
 
 Screenshot::Screenshot( const QString &fileName, QObject* parent ) :
 	QObject( parent ),
@@ -61,7 +63,7 @@ void Screenshot::take( ComputerControlInterface::Pointer computerControlInterfac
 	}
 
 	// construct text
-	QString txt = u + "@" + computerControlInterface->computer().hostAddress() + " " +
+	const QString caption = u + "@" + computerControlInterface->computer().hostAddress() + " " +
 			QDate( QDate::currentDate() ).toString( Qt::ISODate ) +
 			" " + QTime( QTime::currentTime() ).
 							toString( Qt::ISODate );
@@ -89,15 +91,78 @@ void Screenshot::take( ComputerControlInterface::Pointer computerControlInterfac
 	m_fileName = dir + QDir::separator() +
 					u.section( '(', 1, 1 ).section( ')', 0, 0 ) + m_fileName;
 
+	// monitoring connections may only receive downscaled framebuffers (thumbnails) from the
+	// server so open a dedicated connection in order to take screenshot in full resolution
+	auto vncConnection = new VeyonVncConnection;
+	vncConnection->setHost( computerControlInterface->computer().hostAddress() );
+	vncConnection->setQuality( VeyonVncConnection::ScreenshotQuality );
+
+	// do not block the UI while waiting for the connection but finish within the main thread once
+	// the first update has been received, the connection failed or the timeout has expired
+	auto timeoutTimer = new QTimer;
+	timeoutTimer->setSingleShot( true );
+
+	const auto fileName = m_fileName;
+
+	const auto finish = [=]() {
+		vncConnection->disconnect( timeoutTimer );
+		timeoutTimer->stop();
+		timeoutTimer->deleteLater();
+
+		auto image = vncConnection->hasValidFrameBuffer() ? vncConnection->image().copy() : QImage();
+
+		vncConnection->stop( true );
+
+		if( image.isNull() )
+		{
+			// fall back to framebuffer of monitoring connection
+			image = computerControlInterface->screen();
+		}
+
+		save( image, caption, fileName );
+	};
+
+	// signals of the connection are queued so ignore any of them still pending once finished
+	connect( timeoutTimer, &QTimer::timeout, finish );
+	connect( vncConnection, &VeyonVncConnection::framebufferUpdateComplete, timeoutTimer, [=]() {
+		if( timeoutTimer->isActive() )
+		{
+			finish();
+		}
+	} );
+	connect( vncConnection, &VeyonVncConnection::stateChanged, timeoutTimer, [=]() {
+		if( timeoutTimer->isActive() == false )
+		{
+			return;
+		}
+
+		switch( vncConnection->state() )
+		{
+		case VeyonVncConnection::HostOffline:
+		case VeyonVncConnection::ServiceUnreachable:
+		case VeyonVncConnection::AuthenticationFailed:
+			finish();
+			break;
+		default:
+			break;
+		}
+	} );
+
+	timeoutTimer->start( GrabScreenTimeout );
+	vncConnection->start();
+}
+
+
+
+void Screenshot::save( QImage image, const QString& caption, const QString& fileName )
+{
 	const int FONT_SIZE = 14;
 	const int RECT_MARGIN = 10;
 	const int RECT_INNER_MARGIN = 5;
 
-	m_image = QImage( computerControlInterface->screen() );
-
 	QPixmap icon( QStringLiteral( ":/resources/icon16.png" ) );
 
-	QPainter p( &m_image );
+	QPainter p( &image );
 	QFont fnt = p.font();
 	fnt.setPointSize( FONT_SIZE );
 	fnt.setBold( true );
@@ -106,9 +171,9 @@ void Screenshot::take( ComputerControlInterface::Pointer computerControlInterfac
 	QFontMetrics fm( p.font() );
 
 	const int rx = RECT_MARGIN;
-	const int ry = m_image.height() - RECT_MARGIN - 2 * RECT_INNER_MARGIN - FONT_SIZE;
+	const int ry = image.height() - RECT_MARGIN - 2 * RECT_INNER_MARGIN - FONT_SIZE;
 	const int rw = RECT_MARGIN + 4 * RECT_INNER_MARGIN +
-					fm.size( Qt::TextSingleLine, txt ).width() + icon.width();
+					fm.size( Qt::TextSingleLine, caption ).width() + icon.width();
 	const int rh = 2 * RECT_INNER_MARGIN + FONT_SIZE;
 	const int ix = rx + RECT_INNER_MARGIN + 1;
 	const int iy = ry + RECT_INNER_MARGIN - 2;
@@ -117,14 +182,14 @@ void Screenshot::take( ComputerControlInterface::Pointer computerControlInterfac
 
 	p.fillRect( rx, ry, rw, rh, QColor( 255, 255, 255, 160 ) );
 	p.drawPixmap( ix, iy, icon );
-	p.drawText( tx, ty, txt );
+	p.drawText( tx, ty, caption );
+	p.end();
 
-	m_image.save( m_fileName, "PNG", 50 );
+	image.save( fileName, "PNG", 50 );
 }
 
 
 
-
 QString Screenshot::user() const
 {
 	return QFileInfo( fileName() ).fileName().section( '_', 0, 0 );
@@ -32,6 +32,7 @@
 #include "VeyonConfiguration.h"
 #include "VeyonMasterInterface.h"
 #include "VeyonRfbExt.h"
+#include "VeyonServerInterface.h"
 #include "PlatformUserFunctions.h"
 
 
@@ -49,17 +50,33 @@ UserSessionControl::UserSessionControl( QObject* parent ) :
 						 QStringLiteral( ":/resources/system-suspend-hibernate.png" ) ),
 	m_features( { m_userSessionInfoFeature, m_userLogoutFeature } ),
 	m_userInfoQueryThread( new QThread ),
-	m_userInfoQueryTimer( new QTimer )
+	m_userInfoQueryTimer( new QTimer ),
+	m_userSessionInfoSubscriptions( this )
 {
 	// initialize user info query timer and thread
+	m_userInfoQueryTimer->setInterval( UserInformationUpdateInterval );
 	m_userInfoQueryTimer->moveToThread( m_userInfoQueryThread );
+	connect( m_userInfoQueryTimer, &QTimer::timeout, m_userInfoQueryTimer, [=]() { updateUserInformation(); } );
 	connect( m_userInfoQueryThread, &QThread::finished, m_userInfoQueryThread, &QObject::deleteLater );
+
+	// stop polling within thread of timer once nobody is interested anymore
+	connect( &m_userSessionInfoSubscriptions, &FeatureSubscriptions::subscribersGone, m_userInfoQueryTimer, [=]() {
+		// somebody might have subscribed again in the meantime
+		if( m_userSessionInfoSubscriptions.isEmpty() )
+		{
+			m_userInfoQueryTimer->stop();
+		}
+	} );
 }
 
 
 
 UserSessionControl::~UserSessionControl()
 {
+	// stop periodic updates which would access us
+	disconnect( m_userInfoQueryTimer, &QTimer::timeout, nullptr, nullptr );
+	disconnect( &m_userSessionInfoSubscriptions, &FeatureSubscriptions::subscribersGone, nullptr, nullptr );
+
 	m_userInfoQueryThread->quit();
 	m_userInfoQueryTimer->deleteLater();
 }
@@ -74,6 +91,20 @@ bool UserSessionControl::getUserSessionInfo( const ComputerControlInterfaceList&
 
 
 
+bool UserSessionControl::subscribeUserSessionInfo( const ComputerControlInterfaceList& computerControlInterfaces )
+{
+	const FeatureMessage message( m_userSessionInfoFeature.uid(), SubscribeInfo );
+
+	for( auto controlInterface : computerControlInterfaces )
+	{
+		controlInterface->sendFeatureMessage( message );
+	}
+
+	return true;
+}
+
+
+
 bool UserSessionControl::startFeature( VeyonMasterInterface& master, const Feature& feature,
 									   const ComputerControlInterfaceList& computerControlInterfaces )
 {
@@ -104,6 +135,11 @@ bool UserSessionControl::handleFeatureMessage( VeyonMasterInterface& master, con
 	{
 		computerControlInterface->setUser( message.argument( UserName ).toString() );
 
+		if( message.command() == InfoChanged )
+		{
+			computerControlInterface->setServerNotificationsAvailable();
+		}
+
 		return true;
 	}
 
@@ -114,27 +150,29 @@ bool UserSessionControl::handleFeatureMessage( VeyonMasterInterface& master, con
 
 bool UserSessionControl::handleFeatureMessage( VeyonServerInterface& server, const FeatureMessage& message )
 {
-	Q_UNUSED(server);
-
 	if( m_userSessionInfoFeature.uid() == message.featureUid() )
 	{
-		FeatureMessage reply( message.featureUid(), message.command() );
+		auto replyCommand = message.command();
 
-		m_userDataLock.lockForRead();
-		if( m_userName.isEmpty() )
+		if( message.command() == SubscribeInfo )
 		{
-			queryUserInformation();
-			reply.addArgument( UserName, QString() );
+			m_userSessionInfoSubscriptions.subscribe( server, message.ioDevice() );
+			startUserInformationUpdates();
+
+			replyCommand = InfoChanged;
 		}
-		else
+
+		FeatureMessage reply( message.featureUid(), replyCommand );
+
+		const auto userInfo = userInformation();
+		if( userInfo.isEmpty() )
 		{
-			reply.addArgument( UserName, QString( QStringLiteral( "%1 (%2)" ) ).arg( m_userName, m_userFullName ) );
+			queryUserInformation();
 		}
-		m_userDataLock.unlock();
 
-		char rfbMessageType = rfbVeyonFeatureMessage;
-		message.ioDevice()->write( &rfbMessageType, sizeof(rfbMessageType) );
-		reply.send( message.ioDevice() );
+		reply.addArgument( UserName, userInfo );
+
+		server.sendFeatureMessage( message.ioDevice(), reply );
 
 		return true;
 	}
@@ -157,14 +195,62 @@ void UserSessionControl::queryUserInformation()
 
 	// asynchronously query information about logged on user (which might block
 	// due to domain controller queries and timeouts etc.)
-	m_userInfoQueryTimer->singleShot( 0, m_userInfoQueryTimer, [=]() {
-		const auto userName = VeyonCore::platform().userFunctions().currentUser();
-		const auto userFullName = VeyonCore::platform().userFunctions().fullName( userName );
-		m_userDataLock.lockForWrite();
-		m_userName = userName;
-		m_userFullName = userFullName;
-		m_userDataLock.unlock();
-	} );
+	m_userInfoQueryTimer->singleShot( 0, m_userInfoQueryTimer, [=]() { updateUserInformation(); } );
+}
+
+
+
+void UserSessionControl::startUserInformationUpdates()
+{
+	if( m_userInfoQueryThread->isRunning() == false )
+	{
+		m_userInfoQueryThread->start();
+	}
+
+	// detect logons and logouts as long as there are subscribers to be notified
+	QMetaObject::invokeMethod( m_userInfoQueryTimer, "start", Qt::QueuedConnection );
+}
+
+
+
+void UserSessionControl::updateUserInformation()
+{
+	const auto userName = VeyonCore::platform().userFunctions().currentUser();
+
+	m_userDataLock.lockForRead();
+	const bool userChanged = userName != m_userName;
+	m_userDataLock.unlock();
+
+	if( userChanged == false )
+	{
+		return;
+	}
+
+	const auto userFullName = VeyonCore::platform().userFunctions().fullName( userName );
+
+	m_userDataLock.lockForWrite();
+	m_userName = userName;
+	m_userFullName = userFullName;
+	m_userDataLock.unlock();
+
+	FeatureMessage message( m_userSessionInfoFeature.uid(), InfoChanged );
+	message.addArgument( UserName, userInformation() );
+
+	m_userSessionInfoSubscriptions.notify( message );
+}
+
+
+
+QString UserSessionControl::userInformation()
+{
+	QReadLocker locker( &m_userDataLock );
+
+	if( m_userName.isEmpty() )
+	{
+		return QString();
+	}
+
+	return QStringLiteral( "%1 (%2)" ).arg( m_userName, m_userFullName );
 }
 
 
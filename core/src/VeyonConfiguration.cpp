@@ -30,6 +30,7 @@
 #include "VeyonRfbExt.h"
 #include "Logger.h"
 #include "NetworkObjectDirectory.h"
+#include "VncConnectionPool.h"
 
 
 VeyonConfiguration::VeyonConfiguration() :
@@ -75,11 +76,17 @@ VeyonConfiguration VeyonConfiguration::defaultConfiguration()
 	c.setFeatureWorkerManagerPort( PortOffsetFeatureManagerPort );
 	c.setDemoServerPort( PortOffsetDemoServer );
 	c.setFirewallExceptionEnabled( true );
+	c.setFramebufferUpdateSharingEnabled( false );
+	c.setConnectionThreadCount( VncConnectionPool::DefaultThreadCount );
 	c.setSoftwareSASEnabled( true );
+	c.setFeatureWorkerStandbyEnabled( true );
 
 	c.setUserConfigurationDirectory( QDir::toNativeSeparators( QStringLiteral( "%APPDATA%/Config" ) ) );
 	c.setScreenshotDirectory( QDir::toNativeSeparators( QStringLiteral( "%$APPDATA%/Screenshots" ) ) );
 	c.setComputerMonitoringUpdateInterval( 1000 );
+	c.setComputerMonitoringMaximumUpdateInterval( 5000 );
+	c.setComputerMonitoringHiddenUpdateInterval( 10000 );
+	c.setComputerMonitoringThreadCount( VncConnectionPool::DefaultThreadCount );
 	c.setComputerMonitoringBackgroundColor( Qt::white );
 
 	c.setAuthenticationMethod( VeyonCore::LogonAuthentication );
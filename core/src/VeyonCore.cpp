@@ -46,6 +46,7 @@
 #include "PluginManager.h"
 #include "UserGroupsBackendManager.h"
 #include "VeyonConfiguration.h"
+#include "VncConnectionPool.h"
 
 
 VeyonCore* VeyonCore::s_instance = nullptr;
@@ -64,6 +65,8 @@ VeyonCore::VeyonCore( QCoreApplication* application, const QString& appComponent
 	m_userGroupsBackendManager( nullptr ),
 	m_networkObjectDirectoryManager( nullptr ),
 	m_localComputerControlInterface( nullptr ),
+	m_vncConnectionPoolMutex(),
+	m_vncConnectionPool( nullptr ),
 	m_applicationName( QStringLiteral( "Veyon" ) ),
 	m_authenticationKeyName()
 {
@@ -96,6 +99,9 @@ VeyonCore::VeyonCore( QCoreApplication* application, const QString& appComponent
 
 VeyonCore::~VeyonCore()
 {
+	delete m_vncConnectionPool;
+	m_vncConnectionPool = nullptr;
+
 	delete m_userGroupsBackendManager;
 	m_userGroupsBackendManager = nullptr;
 
@@ -134,6 +140,23 @@ VeyonCore* VeyonCore::instance()
 
 
 
+VncConnectionPool& VeyonCore::vncConnectionPool()
+{
+	auto core = instance();
+
+	QMutexLocker locker( &core->m_vncConnectionPoolMutex );
+
+	// create pool on first use so programs not monitoring any computers do not spawn any threads
+	if( core->m_vncConnectionPool == nullptr )
+	{
+		core->m_vncConnectionPool = new VncConnectionPool( config().computerMonitoringThreadCount() );
+	}
+
+	return *core->m_vncConnectionPool;
+}
+
+
+
 QString VeyonCore::version()
 {
 	return QStringLiteral( VEYON_VERSION );
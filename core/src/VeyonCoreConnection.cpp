@@ -22,6 +22,8 @@
  *
  */
 
+#include <QBuffer>
+
 #include "FeatureMessage.h"
 #include "VeyonCoreConnection.h"
 #include "SocketDevice.h"
@@ -31,37 +33,6 @@ extern "C"
 	#include <rfb/rfbclient.h>
 }
 
-// clazy:excludeall=copyable-polymorphic
-
-class FeatureMessageEvent : public MessageEvent
-{
-public:
-	FeatureMessageEvent( const FeatureMessage& featureMessage ) :
-		m_featureMessage( featureMessage )
-	{
-	}
-
-	void fire( rfbClient* client ) override
-	{
-		qDebug() << "FeatureMessageEvent::fire(): sending message" << m_featureMessage.featureUid()
-				 << "command" << m_featureMessage.command()
-				 << "arguments" << m_featureMessage.arguments();
-
-		SocketDevice socketDevice( VeyonVncConnection::libvncClientDispatcher, client );
-		char messageType = rfbVeyonFeatureMessage;
-		socketDevice.write( &messageType, sizeof(messageType) );
-
-		m_featureMessage.send( &socketDevice );
-	}
-
-
-private:
-	FeatureMessage m_featureMessage;
-
-} ;
-
-
-
 static rfbClientProtocolExtension * __veyonProtocolExt = nullptr;
 static void* VeyonCoreConnectionTag = reinterpret_cast<void *>( PortOffsetVncServer ); // an unique ID
 
@@ -99,14 +70,42 @@ VeyonCoreConnection::~VeyonCoreConnection()
 
 
 void VeyonCoreConnection::sendFeatureMessage( const FeatureMessage& featureMessage )
+{
+	qDebug() << "VeyonCoreConnection::sendFeatureMessage(): sending message" << featureMessage.featureUid()
+			 << "command" << featureMessage.command()
+			 << "arguments" << featureMessage.arguments();
+
+	sendSerializedFeatureMessage( serializeFeatureMessage( featureMessage, featureMessageFormat() ) );
+}
+
+
+
+void VeyonCoreConnection::sendSerializedFeatureMessage( const QByteArray& message )
 {
 	if( m_vncConn == nullptr )
 	{
-		qCritical( "VeyonCoreConnection::sendFeatureMessage(): cannot call enqueueEvent - m_vncConn is NULL" );
+		qCritical( "VeyonCoreConnection::sendSerializedFeatureMessage(): cannot call enqueueEvent - m_vncConn is NULL" );
 		return;
 	}
 
-	m_vncConn->enqueueEvent( new FeatureMessageEvent( featureMessage ) );
+	// data is shared implicitly so the connection thread only has to write it
+	m_vncConn->enqueueEvent( VncClientEvent::rawMessageEvent( message ) );
+}
+
+
+
+QByteArray VeyonCoreConnection::serializeFeatureMessage( const FeatureMessage& featureMessage,
+														FeatureMessage::Format format )
+{
+	QBuffer buffer;
+	buffer.open( QBuffer::WriteOnly );
+
+	const char messageType = rfbVeyonFeatureMessage;
+	buffer.write( &messageType, sizeof(messageType) );
+
+	featureMessage.send( &buffer, format );
+
+	return buffer.data();
 }
 
 
@@ -121,6 +120,12 @@ void VeyonCoreConnection::initNewClient( rfbClient *cl )
 
 rfbBool VeyonCoreConnection::handleVeyonMessage( rfbClient* client, rfbServerToClientMsg* msg )
 {
+	// other Veyon messages are handled by VeyonVncConnection
+	if( msg->type != rfbVeyonFeatureMessage )
+	{
+		return false;
+	}
+
 	auto coreConnection = reinterpret_cast<VeyonCoreConnection *>( rfbClientGetClientData( client, VeyonCoreConnectionTag ) );
 	if( coreConnection )
 	{
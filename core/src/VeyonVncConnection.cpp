@@ -30,86 +30,29 @@
 #include <QHostAddress>
 #include <QMutexLocker>
 #include <QPixmap>
+#include <QSocketNotifier>
+#include <QThread>
 #include <QTime>
+#include <QtConcurrent>
 
 #include "AuthenticationCredentials.h"
 #include "CryptoCore.h"
+#include "ImageScaler.h"
 #include "PlatformNetworkFunctions.h"
 #include "PlatformUserFunctions.h"
 #include "VeyonConfiguration.h"
 #include "VeyonVncConnection.h"
 #include "SocketDevice.h"
 #include "VariantArrayMessage.h"
+#include "VncConnectionPool.h"
+#include "VncMulticastRelay.h"
 
 extern "C"
 {
 	#include <rfb/rfbclient.h>
 }
 
-// clazy:excludeall=copyable-polymorphic
-
-class KeyClientEvent : public MessageEvent
-{
-public:
-	KeyClientEvent( unsigned int key, bool pressed ) :
-		m_key( key ),
-		m_pressed( pressed )
-	{
-	}
-
-	void fire( rfbClient *cl ) override
-	{
-		SendKeyEvent( cl, m_key, m_pressed );
-	}
-
-private:
-	unsigned int m_key;
-	bool m_pressed;
-} ;
-
-
-
-class PointerClientEvent : public MessageEvent
-{
-public:
-	PointerClientEvent( int x, int y, int buttonMask ) :
-		m_x( x ),
-		m_y( y ),
-		m_buttonMask( buttonMask )
-	{
-	}
-
-	void fire( rfbClient *cl ) override
-	{
-		SendPointerEvent( cl, m_x, m_y, m_buttonMask );
-	}
-
-private:
-	int m_x;
-	int m_y;
-	int m_buttonMask;
-} ;
-
-
-
-class ClientCutEvent : public MessageEvent
-{
-public:
-	ClientCutEvent( const QString& text ) :
-		m_text( text.toUtf8() )
-	{
-	}
-
-	void fire( rfbClient *cl ) override
-	{
-		SendClientCutText( cl, m_text.data(), m_text.size() ); // clazy:exclude=detaching-member
-	}
-
-private:
-	QByteArray m_text;
-} ;
-
-
+static rfbClientProtocolExtension* __veyonThumbnailExt = nullptr;
 
 
 
@@ -129,6 +72,8 @@ rfbBool VeyonVncConnection::hookInitFrameBuffer( rfbClient *cl )
 	t->m_image = QImage( cl->frameBuffer, cl->width, cl->height, QImage::Format_RGB32, framebufferCleanup, cl->frameBuffer );
 	t->m_imgLock.unlock();
 
+	t->m_damagedRegion = t->m_image.rect();
+
 	// set up pixel format according to QImage
 	cl->format.bitsPerPixel = 32;
 	cl->format.redShift = 16;
@@ -150,20 +95,27 @@ rfbBool VeyonVncConnection::hookInitFrameBuffer( rfbClient *cl )
 			cl->appData.encodingsString = "raw";
 			break;
 		case RemoteControlQuality:
-			cl->appData.encodingsString = "copyrect hextile raw";
+			// fast compression and high JPEG quality for photo-like areas only
+			cl->appData.encodingsString = "tight copyrect hextile raw";
+			cl->appData.compressLevel = 1;
+			cl->appData.qualityLevel = 8;
+			cl->appData.enableJPEG = true;
 			//cl->appData.useRemoteCursor = true;
 			break;
 		case ThumbnailQuality:
-			cl->appData.encodingsString = "zrle ultra "
+			cl->appData.encodingsString = "tight zrle ultra "
 							"copyrect hextile zlib "
 							"corre rre raw";
 			cl->appData.compressLevel = 9;
-			cl->appData.qualityLevel = 5;
+			cl->appData.qualityLevel = 4;
 			cl->appData.enableJPEG = true;
 			break;
 		default:
-			cl->appData.encodingsString = "zrle ultra copyrect "
+			cl->appData.encodingsString = "tight zrle ultra copyrect "
 							"hextile zlib corre rre raw";
+			cl->appData.compressLevel = 6;
+			cl->appData.qualityLevel = 7;
+			cl->appData.enableJPEG = true;
 			break;
 	}
 
@@ -181,6 +133,20 @@ void VeyonVncConnection::hookUpdateFB( rfbClient *cl, int x, int y, int w, int h
 
 	if( t )
 	{
+		t->m_receivedBytes += static_cast<qint64>( w ) * h * cl->format.bitsPerPixel / 8;
+		t->m_damagedRegion += QRect( x, y, w, h );
+		t->m_framebufferChanged = true;
+
+		// request next update while still receiving the current one so the server can send
+		// further changes right after this update instead of waiting for our next request
+		if( t->isLowLatencyMode() && t->m_updateRequestPending && t->m_updateRequestPipelined == false &&
+				t->m_frameBufferValid && t->m_state == Connected )
+		{
+			t->finishFramebufferUpdateRequest();
+			t->requestFramebufferUpdate( true );
+			t->m_updateRequestPipelined = true;
+		}
+
 		emit t->imageUpdated( x, y, w, h );
 	}
 }
@@ -250,6 +216,32 @@ void VeyonVncConnection::hookCutText( rfbClient *cl, const char *text,
 
 
 
+rfbBool VeyonVncConnection::hookHandleVeyonMessage( rfbClient* cl, rfbServerToClientMsg* msg )
+{
+	if( msg->type != rfbVeyonThumbnailMessage )
+	{
+		return false;
+	}
+
+	// read remaining part of message - server sends it with zero size for announcing thumbnail support
+	rfbVeyonThumbnailMsg thumbnailMessage;
+	if( ReadFromRFBServer( cl, reinterpret_cast<char *>( &thumbnailMessage ) + 1, sz_rfbVeyonThumbnailMsg - 1 ) == false )
+	{
+		return false;
+	}
+
+	VeyonVncConnection* t = (VeyonVncConnection *) rfbClientGetClientData( cl, nullptr );
+	if( t )
+	{
+		t->m_thumbnailsSupported = true;
+		t->sendThumbnailRequest();
+	}
+
+	return true;
+}
+
+
+
 void VeyonVncConnection::hookOutputHandler( const char* format, ... )
 {
 	va_list args;
@@ -273,19 +265,57 @@ void VeyonVncConnection::framebufferCleanup( void *framebuffer )
 
 
 
-VeyonVncConnection::VeyonVncConnection( QObject *parent ) :
-	QThread( parent ),
+VeyonVncConnection::VeyonVncConnection() :
+	QObject( nullptr ),
 	m_serviceReachable( false ),
 	m_frameBufferInitialized( false ),
 	m_frameBufferValid( false ),
+	m_thumbnailsSupported( false ),
 	m_cl( nullptr ),
 	m_veyonAuthType( RfbVeyonAuth::Logon ),
+	m_featureMessageFormat( FeatureMessage::LegacyFormat ),
 	m_quality( DefaultQuality ),
 	m_port( -1 ),
-	m_terminateTimer( this ),
+	m_connectionPool( nullptr ),
+	m_thread( nullptr ),
+	m_socketNotifier( nullptr ),
+	m_multicastGroupAddress(),
+	m_multicastPort( 0 ),
+	m_multicastKey(),
+	m_multicastFailed( false ),
+	m_multicastRelayThread( nullptr ),
+	m_updateTimer( this ),
+	m_connectionTime(),
+	m_stopRequested( 0 ),
+	m_eventsPending( 0 ),
+	m_deleteAfterStop( false ),
+	m_connectInProgress( false ),
 	m_framebufferUpdateInterval( 0 ),
+	m_minimumFramebufferUpdateInterval( 0 ),
+	m_maximumFramebufferUpdateInterval( 0 ),
+	m_framebufferUpdatesPaused( 0 ),
+	m_updateRequestTime(),
+	m_updateRequestPending( false ),
+	m_updateRequestIncremental( false ),
+	m_updateRequestPipelined( false ),
+	m_framebufferChanged( false ),
+	m_inputTime(),
+	m_inputPending( false ),
+	m_statisticsMutex(),
+	m_statistics(),
+	m_statisticsTime(),
+	m_receivedBytes( 0 ),
+	m_receivedUpdates( 0 ),
+	m_minimumUpdateLatency( -1 ),
+	m_inputLatencySum( 0 ),
+	m_inputLatencyCount( 0 ),
+	m_eventQueue( EventQueueSize ),
+	m_eventOverflowQueue(),
+	m_eventQueueOverflow( 0 ),
 	m_image(),
-	m_scaledScreenNeedsUpdate( false ),
+	m_damagedRegion(),
+	m_scaledFramebuffer(),
+	m_scaledScreenMutex(),
 	m_scaledScreen(),
 	m_scaledSize(),
 	m_state( Disconnected )
@@ -293,10 +323,21 @@ VeyonVncConnection::VeyonVncConnection( QObject *parent ) :
 	rfbClientLog = hookOutputHandler;
 	rfbClientErr = hookOutputHandler;
 
-	m_terminateTimer.setSingleShot( true );
-	m_terminateTimer.setInterval( ThreadTerminationTimeout );
+	if( __veyonThumbnailExt == nullptr )
+	{
+		static int thumbnailEncodings[] = { rfbEncodingVeyonThumbnail, 0 };
+
+		__veyonThumbnailExt = new rfbClientProtocolExtension;
+		__veyonThumbnailExt->encodings = thumbnailEncodings;
+		__veyonThumbnailExt->handleEncoding = nullptr;
+		__veyonThumbnailExt->handleMessage = hookHandleVeyonMessage;
+
+		rfbClientRegisterExtension( __veyonThumbnailExt );
+	}
+
+	m_updateTimer.setSingleShot( true );
 
-	connect( &m_terminateTimer, &QTimer::timeout, this, &VeyonVncConnection::terminate );
+	connect( &m_updateTimer, &QTimer::timeout, this, &VeyonVncConnection::handleConnection );
 
 	if( VeyonCore::config().authenticationMethod() == VeyonCore::KeyFileAuthentication )
 	{
@@ -308,74 +349,81 @@ VeyonVncConnection::VeyonVncConnection( QObject *parent ) :
 
 VeyonVncConnection::~VeyonVncConnection()
 {
-	stop();
-
-	if( isRunning() )
+	if( m_connectInProgress )
 	{
-		qWarning( "Waiting for VNC connection thread to finish." );
-		wait( ThreadTerminationTimeout );
+		// client is still in use by connect thread so we must not free it
+		qCritical( "VeyonVncConnection: destroyed while connecting - use stop( true ) instead!" );
+	}
+	else
+	{
+		closeConnection();
 	}
+}
 
-	if( isRunning() )
+
+
+void VeyonVncConnection::start()
+{
+	if( m_thread )
 	{
-		qWarning( "Terminating hanging VNC connection thread!" );
+		qWarning( "VeyonVncConnection::start(): connection already started" );
+		return;
+	}
 
-		terminate();
-		wait();
+	if( m_connectionPool )
+	{
+		m_thread = m_connectionPool->acquireThread();
+	}
+	else
+	{
+		m_thread = new QThread;
+		m_thread->setObjectName( QStringLiteral( "VeyonVncConnection" ) );
+		connect( m_thread, &QThread::finished, m_thread, &QObject::deleteLater );
+		m_thread->start();
 	}
-}
 
+	moveToThread( m_thread );
+
+	QMetaObject::invokeMethod( this, "establishConnection", Qt::QueuedConnection );
+}
 
 
 
 void VeyonVncConnection::stop( bool deleteAfterFinished )
 {
-	if( isRunning() )
+	if( m_thread == nullptr )
 	{
 		if( deleteAfterFinished )
 		{
-			connect( this, &VeyonVncConnection::finished,
-					 this, &VeyonVncConnection::deleteLater );
+			deleteLater();
 		}
+		return;
+	}
 
-		m_scaledScreen = QImage();
-
-		requestInterruption();
-
-		m_updateIntervalSleeper.wakeAll();
+	m_scaledScreenMutex.lock();
+	m_scaledScreen = QImage();
+	m_scaledScreenMutex.unlock();
 
-		// thread termination causes deadlock when calling any QThread functions such as isRunning()
-		// or the destructor if the thread itself is stuck in a blocking (e.g. network) function
-		// therefore do not terminate the thread on windows but let it run in background as long
-		// as the blocking function is running
-#ifndef Q_OS_WIN32
-		// terminate thread in background after timeout
-		m_terminateTimer.start();
-#endif
+	m_deleteAfterStop = deleteAfterFinished;
 
-		// stop timer if thread terminates properly before timeout
-		connect( this, &VeyonVncConnection::finished,
-				 &m_terminateTimer, &QTimer::stop );
-	}
-	else if( deleteAfterFinished )
+	if( m_stopRequested.testAndSetOrdered( 0, 1 ) )
 	{
-		deleteLater();
+		QMetaObject::invokeMethod( this, "shutdown", Qt::QueuedConnection );
 	}
 }
 
 
 
-
 void VeyonVncConnection::reset( const QString &host )
 {
-	if( m_state != Connected && isRunning() )
+	setHost( host );
+
+	if( isRunning() )
 	{
-		setHost( host );
+		QMetaObject::invokeMethod( this, "establishConnection", Qt::QueuedConnection );
 	}
 	else
 	{
-		stop();
-		setHost( host );
 		start();
 	}
 }
@@ -426,6 +474,17 @@ void VeyonVncConnection::setPort( int port )
 
 
 
+void VeyonVncConnection::setMulticastGroup( const QHostAddress& groupAddress, int port, const QByteArray& key )
+{
+	QMutexLocker locker( &m_mutex );
+	m_multicastGroupAddress = groupAddress;
+	m_multicastPort = port;
+	m_multicastKey = key;
+	m_multicastFailed = false;
+}
+
+
+
 QImage VeyonVncConnection::image() const
 {
 	QReadLocker locker( &m_imgLock );
@@ -436,301 +495,871 @@ QImage VeyonVncConnection::image() const
 
 void VeyonVncConnection::setFramebufferUpdateInterval( int interval )
 {
-	m_framebufferUpdateInterval = interval;
+	setAdaptiveFramebufferUpdateInterval( interval, interval );
 }
 
 
 
-
-void VeyonVncConnection::rescaleScreen()
+void VeyonVncConnection::setAdaptiveFramebufferUpdateInterval( int minimumInterval, int maximumInterval )
 {
-	if( m_image.size().isValid() == false ||
-			m_scaledSize.isNull() ||
-			m_frameBufferValid == false ||
-			m_scaledScreenNeedsUpdate == false )
-	{
-		return;
-	}
+	maximumInterval = qMax( minimumInterval, maximumInterval );
 
-	QReadLocker locker( &m_imgLock );
-	m_scaledScreen = m_image.scaled( m_scaledSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+	const bool minimumChanged = m_minimumFramebufferUpdateInterval.fetchAndStoreOrdered( minimumInterval ) != minimumInterval;
+	const bool maximumChanged = m_maximumFramebufferUpdateInterval.fetchAndStoreOrdered( maximumInterval ) != maximumInterval;
 
-	m_scaledScreenNeedsUpdate = false;
-}
+	if( minimumChanged || maximumChanged )
+	{
+		// start with highest update rate and back off later if appropriate
+		m_framebufferUpdateInterval.store( minimumInterval );
 
+		if( isRunning() )
+		{
+			// apply new interval immediately
+			QMetaObject::invokeMethod( this, "handleConnection", Qt::QueuedConnection );
+		}
+	}
+}
 
 
 
-void VeyonVncConnection::run()
+void VeyonVncConnection::setFramebufferUpdatesPaused( bool paused )
 {
-	while( isInterruptionRequested() == false )
+	if( m_framebufferUpdatesPaused.fetchAndStoreOrdered( paused ? 1 : 0 ) != ( paused ? 1 : 0 ) && isRunning() )
 	{
-		establishConnection();
-		handleConnection();
-		closeConnection();
+		// resume immediately
+		QMetaObject::invokeMethod( this, "handleConnection", Qt::QueuedConnection );
 	}
-
-	setState( Disconnected );
 }
 
 
 
-void VeyonVncConnection::establishConnection()
+
+VeyonVncConnection::Statistics VeyonVncConnection::statistics() const
 {
-	QMutex sleeperMutex;
+	QMutexLocker locker( &m_statisticsMutex );
 
-	setState( Connecting );
+	return m_statistics;
+}
 
-	m_frameBufferValid = false;
-	m_frameBufferInitialized = false;
 
-	while( isInterruptionRequested() == false && m_state != Connected ) // try to connect as long as the server allows
-	{
-		m_cl = rfbGetClient( 8, 3, 4 );
-		m_cl->MallocFrameBuffer = hookInitFrameBuffer;
-		m_cl->canHandleNewFBSize = true;
-		m_cl->GotFrameBufferUpdate = hookUpdateFB;
-		m_cl->FinishedFrameBufferUpdate = hookFinishFrameBufferUpdate;
-		m_cl->HandleCursorPos = hookHandleCursorPos;
-		m_cl->GotCursorShape = hookCursorShape;
-		m_cl->GotXCutText = hookCutText;
-		rfbClientSetClientData( m_cl, nullptr, this );
 
-		m_mutex.lock();
+void VeyonVncConnection::setScaledSize( QSize s )
+{
+	QMutexLocker locker( &m_mutex );
+
+	if( m_scaledSize != s )
+	{
+		m_scaledSize = s;
 
-		if( m_port < 0 ) // use default port?
+		if( m_thread )
 		{
-			m_cl->serverPort = VeyonCore::config().primaryServicePort();
+			QMetaObject::invokeMethod( this, "rescaleScreen", Qt::QueuedConnection );
 		}
-		else
+
+		// let server send thumbnails in new size
+		if( m_thumbnailsSupported )
 		{
-			m_cl->serverPort = m_port;
+			QMetaObject::invokeMethod( this, "sendThumbnailRequest", Qt::QueuedConnection );
 		}
+	}
+}
 
-		free( m_cl->serverHost );
-		m_cl->serverHost = strdup( m_host.toUtf8().constData() );
 
-		m_mutex.unlock();
 
-		emit newClient( m_cl );
+QImage VeyonVncConnection::scaledScreen() const
+{
+	QMutexLocker locker( &m_scaledScreenMutex );
 
-		m_serviceReachable = false;
+	return m_scaledScreen;
+}
 
-		if( rfbInitClient( m_cl, nullptr, nullptr ) )
-		{
-			setState( Connected );
-		}
-		else
-		{
-			// rfbInitClient() calls rfbClientCleanup() when failed
-			m_cl = nullptr;
 
-			// guess reason why connection failed
-			if( m_serviceReachable == false )
-			{
-				if( VeyonCore::platform().networkFunctions().ping( m_host ) == false )
-				{
-					setState( HostOffline );
-				}
-				else
-				{
-					setState( ServiceUnreachable );
-				}
-			}
-			else if( m_frameBufferInitialized == false )
-			{
-				setState( AuthenticationFailed );
-			}
-			else
-			{
-				// failed for an unknown reason
-				setState( ConnectionFailed );
-			}
 
-			// do not sleep when already requested to stop
-			if( isInterruptionRequested() )
-			{
-				break;
-			}
+void VeyonVncConnection::rescaleScreen()
+{
+	m_damagedRegion = m_image.rect();
 
-			// wait a bit until next connect
-			sleeperMutex.lock();
-			if( m_framebufferUpdateInterval > 0 )
-			{
-				m_updateIntervalSleeper.wait( &sleeperMutex,
-												m_framebufferUpdateInterval );
-			}
-			else
-			{
-				// default: retry every second
-				m_updateIntervalSleeper.wait( &sleeperMutex, 1000 );
-			}
-			sleeperMutex.unlock();
-		}
-	}
+	updateScaledScreen();
 }
 
 
 
-void VeyonVncConnection::handleConnection()
+
+void VeyonVncConnection::establishConnection()
 {
-	QMutex sleeperMutex;
+	if( m_connectInProgress || m_stopRequested.load() )
+	{
+		return;
+	}
 
-	QElapsedTimer updateTimer;
-	QElapsedTimer connectionTime;
+	closeConnection();
 
-	connectionTime.start();
+	setState( Connecting );
 
-	// Main VNC event loop
-	while( isInterruptionRequested() == false )
-	{
-		updateTimer.start();
+	m_frameBufferValid = false;
+	m_frameBufferInitialized = false;
+	m_serviceReachable = false;
+	m_thumbnailsSupported = false;
+
+	m_cl = rfbGetClient( 8, 3, 4 );
+	m_cl->MallocFrameBuffer = hookInitFrameBuffer;
+	m_cl->canHandleNewFBSize = true;
+	m_cl->GotFrameBufferUpdate = hookUpdateFB;
+	m_cl->FinishedFrameBufferUpdate = hookFinishFrameBufferUpdate;
+	m_cl->HandleCursorPos = hookHandleCursorPos;
+	m_cl->GotCursorShape = hookCursorShape;
+	m_cl->GotXCutText = hookCutText;
+	rfbClientSetClientData( m_cl, nullptr, this );
 
-		const int i = WaitForMessage( m_cl, MessageWaitTimeout );
-		if( isInterruptionRequested() || i < 0 )
-		{
-			break;
-		}
-		else if( i )
-		{
-			// handle all available messages
-			bool handledOkay = true;
-			do {
-				handledOkay &= HandleRFBServerMessage( m_cl );
-			} while( handledOkay && WaitForMessage( m_cl, 0 ) );
+	m_mutex.lock();
 
-			if( handledOkay == false )
-			{
-				break;
-			}
-		}
+	if( m_port < 0 ) // use default port?
+	{
+		m_cl->serverPort = VeyonCore::config().primaryServicePort();
+	}
+	else
+	{
+		m_cl->serverPort = m_port;
+	}
 
-		if( m_frameBufferValid == false )
-		{
-			// initial framebuffer timeout exceeded?
-			if( connectionTime.hasExpired( InitialFrameBufferTimeout ) )
-			{
-				// no so disconnect and try again
-				qDebug( "VeyonVncConnection: InitialFrameBufferTimeout exceeded - disconnecting" );
-				break;
-			}
-			else
-			{
-				// not yet so again request initial full framebuffer update
-				SendFramebufferUpdateRequest( m_cl, 0, 0, framebufferSize().width(), framebufferSize().height(), false );
-			}
-		}
-		else
-		{
-			SendFramebufferUpdateRequest( m_cl, 0, 0, framebufferSize().width(), framebufferSize().height(), true );
-		}
+	free( m_cl->serverHost );
+	m_cl->serverHost = strdup( m_host.toUtf8().constData() );
 
-		sendEvents();
+	m_mutex.unlock();
 
-		auto remainingUpdateInterval = m_framebufferUpdateInterval - updateTimer.elapsed();
+	emit newClient( m_cl );
 
-		if( remainingUpdateInterval > 0 && isInterruptionRequested() == false )
-		{
-			sleeperMutex.lock();
-			m_updateIntervalSleeper.wait( &sleeperMutex, remainingUpdateInterval );
-			sleeperMutex.unlock();
-		}
-	}
+	m_connectInProgress = true;
 
-	sendEvents();
+	if( m_connectionPool )
+	{
+		// rfbInitClient() blocks until connection is established or failed so run it
+		// outside the event loop thread which is shared with other connections
+		auto client = m_cl;
+		QtConcurrent::run( &m_connectionPool->connectThreadPool(), [this, client]() {
+			QMetaObject::invokeMethod( this, "finishConnectionSetup", Qt::QueuedConnection,
+									   Q_ARG( int, connectToServer( client ) ) );
+		} );
+	}
+	else
+	{
+		finishConnectionSetup( connectToServer( m_cl ) );
+	}
 }
 
 
 
-void VeyonVncConnection::closeConnection()
+VeyonVncConnection::State VeyonVncConnection::connectToServer( rfbClient* client )
 {
-	if( m_cl )
+	if( rfbInitClient( client, nullptr, nullptr ) )
 	{
-		rfbClientCleanup( m_cl );
-		m_cl = nullptr;
+		return Connected;
 	}
 
-	setState( Disconnected );
-}
-
+	// guess reason why connection failed
+	if( m_serviceReachable == false )
+	{
+		m_mutex.lock();
+		const auto host = m_host;
+		m_mutex.unlock();
 
+		if( VeyonCore::platform().networkFunctions().ping( host ) == false )
+		{
+			return HostOffline;
+		}
 
-void VeyonVncConnection::setState( State state )
-{
-	if( state != m_state )
+		return ServiceUnreachable;
+	}
+	else if( m_frameBufferInitialized == false )
 	{
-		m_state = state;
-
-		emit stateChanged();
+		return AuthenticationFailed;
 	}
+
+	// failed for an unknown reason
+	return ConnectionFailed;
 }
 
 
 
-void VeyonVncConnection::finishFrameBufferUpdate()
+void VeyonVncConnection::finishConnectionSetup( int state )
 {
-	if( m_frameBufferValid == false )
+	m_connectInProgress = false;
+
+	if( state != Connected )
 	{
-		m_frameBufferValid = true;
+		// rfbInitClient() calls rfbClientCleanup() when failed
+		m_cl = nullptr;
+	}
 
-		emit framebufferSizeChanged( m_image.width(), m_image.height() );
+	if( m_stopRequested.load() )
+	{
+		shutdown();
+		return;
 	}
 
-	emit framebufferUpdateComplete();
+	setState( static_cast<State>( state ) );
 
-	m_scaledScreenNeedsUpdate = true;
-}
+	if( state == Connected )
+	{
+		m_connectionTime.start();
+		m_updateRequestPending = false;
+		m_updateRequestPipelined = false;
+		m_inputPending = false;
 
+		resetStatistics();
 
+		// replaces m_cl->sock so has to be done before watching it
+		startMulticastRelay();
 
-void VeyonVncConnection::sendEvents()
-{
-	m_mutex.lock();
+		m_socketNotifier = new QSocketNotifier( m_cl->sock, QSocketNotifier::Read, this );
+		connect( m_socketNotifier, &QSocketNotifier::activated, this, &VeyonVncConnection::readFromServer );
 
-	while( m_eventQueue.isEmpty() == false )
+		// request initial framebuffer
+		handleConnection();
+	}
+	else
 	{
-		auto event = m_eventQueue.dequeue();
-
-		// unlock the queue mutex during the runtime of ClientEvent::fire()
-		m_mutex.unlock();
-
-		event->fire( m_cl );
-		delete event;
-
-		// and lock it again
-		m_mutex.lock();
+		// wait a bit until next connect
+		const int updateInterval = m_framebufferUpdateInterval.load();
+		QTimer::singleShot( updateInterval > 0 ? updateInterval : ConnectionRetryInterval,
+							this, &VeyonVncConnection::establishConnection );
 	}
-
-	m_mutex.unlock();
 }
 
 
 
-void VeyonVncConnection::enqueueEvent( MessageEvent *e )
+void VeyonVncConnection::readFromServer()
 {
-	QMutexLocker lock( &m_mutex );
-	if( m_state != Connected )
+	if( m_cl == nullptr || m_state != Connected )
 	{
 		return;
 	}
 
-	m_eventQueue.enqueue( e );
-}
+	// handle all available messages - libvncclient still reads each message in a blocking manner
+	// but only gets invoked once data is available
+	bool handledOkay = true;
+	do {
+		handledOkay &= HandleRFBServerMessage( m_cl );
+	} while( handledOkay && m_stopRequested.load() == 0 &&
+			 ( m_cl->buffered > 0 || WaitForMessage( m_cl, 0 ) > 0 ) );
 
+	if( handledOkay == false )
+	{
+		reconnect();
+	}
+}
 
 
 
-void VeyonVncConnection::mouseEvent( int x, int y, int buttonMask )
+void VeyonVncConnection::handleConnection()
 {
-	enqueueEvent( new PointerClientEvent( x, y, buttonMask ) );
-}
+	if( m_cl == nullptr || m_state != Connected )
+	{
+		return;
+	}
+
+	if( m_framebufferUpdatesPaused.load() && m_frameBufferValid )
+	{
+		// do not request any further updates until resumed
+		m_updateTimer.stop();
+		m_updateRequestPending = false;
+		sendEvents();
+		return;
+	}
+
+	if( m_frameBufferValid == false )
+	{
+		// initial framebuffer timeout exceeded?
+		if( m_connectionTime.hasExpired( InitialFrameBufferTimeout ) )
+		{
+			// no so disconnect and try again
+			qDebug( "VeyonVncConnection: InitialFrameBufferTimeout exceeded - disconnecting" );
+			reconnect();
+			return;
+		}
+
+		// not yet so again request initial full framebuffer update
+		requestFramebufferUpdate( false );
+	}
+	else
+	{
+		// update timer expired without any update received since last request?
+		if( m_updateRequestPending && m_updateTimer.isActive() == false )
+		{
+			adaptFramebufferUpdateInterval( -1 );
+		}
+
+		requestFramebufferUpdate( true );
+	}
+
+	updateStatistics();
+
+	sendEvents();
+
+	startUpdateTimer();
+}
+
+
+
+void VeyonVncConnection::closeConnection()
+{
+	m_updateTimer.stop();
+
+	delete m_socketNotifier;
+	m_socketNotifier = nullptr;
+
+	stopMulticastRelay();
+
+	if( m_cl )
+	{
+		rfbClientCleanup( m_cl );
+		m_cl = nullptr;
+	}
+
+	setState( Disconnected );
+}
+
+
+
+void VeyonVncConnection::reconnect()
+{
+	closeConnection();
+
+	QMetaObject::invokeMethod( this, "establishConnection", Qt::QueuedConnection );
+}
+
+
+
+void VeyonVncConnection::startMulticastRelay()
+{
+	m_mutex.lock();
+	const auto groupAddress = m_multicastGroupAddress;
+	const auto port = m_multicastPort;
+	const auto key = m_multicastKey;
+	const auto multicastFailed = m_multicastFailed;
+	m_mutex.unlock();
+
+	// the relay has to start at a message boundary which is not the case if
+	// libvncclient has buffered parts of the next message already
+	if( groupAddress.isNull() || multicastFailed || m_cl->buffered > 0 )
+	{
+		return;
+	}
+
+	// let relay parse updates sent in the pixel format set up by libvncclient
+	auto pixelFormat = m_cl->format;
+	pixelFormat.redMax = qToBigEndian( pixelFormat.redMax );
+	pixelFormat.greenMax = qToBigEndian( pixelFormat.greenMax );
+	pixelFormat.blueMax = qToBigEndian( pixelFormat.blueMax );
+
+	auto relay = new VncMulticastRelay( m_cl->sock, pixelFormat, groupAddress, port, key );
+
+	if( relay->clientSocketDescriptor() < 0 )
+	{
+		delete relay;
+		return;
+	}
+
+	// server connection is owned by relay now
+	m_cl->sock = static_cast<int>( relay->clientSocketDescriptor() );
+
+	m_multicastRelayThread = new QThread;
+	m_multicastRelayThread->setObjectName( QStringLiteral( "VncMulticastRelay" ) );
+
+	relay->moveToThread( m_multicastRelayThread );
+
+	connect( m_multicastRelayThread, &QThread::finished, relay, &QObject::deleteLater );
+	connect( relay, &VncMulticastRelay::failed, this, &VeyonVncConnection::handleMulticastFailure );
+
+	m_multicastRelayThread->start();
+
+	QMetaObject::invokeMethod( relay, "start", Qt::QueuedConnection );
+}
+
+
+
+void VeyonVncConnection::stopMulticastRelay()
+{
+	if( m_multicastRelayThread )
+	{
+		// relay gets deleted when thread finishes
+		m_multicastRelayThread->quit();
+		m_multicastRelayThread->wait();
+
+		delete m_multicastRelayThread;
+		m_multicastRelayThread = nullptr;
+	}
+}
+
+
+
+void VeyonVncConnection::handleMulticastFailure()
+{
+	if( m_multicastRelayThread == nullptr )
+	{
+		return;
+	}
+
+	qWarning( "VeyonVncConnection: multicast updates failed - reconnecting without multicast" );
+
+	m_mutex.lock();
+	m_multicastFailed = true;
+	m_mutex.unlock();
+
+	reconnect();
+}
+
+
+
+void VeyonVncConnection::startUpdateTimer()
+{
+	const int updateInterval = m_framebufferUpdateInterval.load();
+
+	if( updateInterval > 0 )
+	{
+		m_updateTimer.start( updateInterval );
+	}
+	else
+	{
+		m_updateTimer.start( UpdateRequestRetryInterval );
+	}
+}
+
+
+
+void VeyonVncConnection::sendThumbnailRequest()
+{
+	if( m_cl == nullptr || m_thumbnailsSupported == false || m_quality != ThumbnailQuality )
+	{
+		return;
+	}
+
+	m_mutex.lock();
+	const auto thumbnailSize = m_scaledSize;
+	m_mutex.unlock();
+
+	if( thumbnailSize.isEmpty() )
+	{
+		return;
+	}
+
+	rfbVeyonThumbnailMsg thumbnailMessage;
+	thumbnailMessage.type = rfbVeyonThumbnailMessage;
+	thumbnailMessage.pad = 0;
+	thumbnailMessage.width = qToBigEndian<uint16_t>( thumbnailSize.width() );
+	thumbnailMessage.height = qToBigEndian<uint16_t>( thumbnailSize.height() );
+
+	WriteToRFBServer( m_cl, reinterpret_cast<char *>( &thumbnailMessage ), sz_rfbVeyonThumbnailMsg );
+}
+
+
+
+void VeyonVncConnection::shutdown()
+{
+	// connection setup still running in connect thread pool - finishConnectionSetup() calls us again
+	if( m_connectInProgress )
+	{
+		return;
+	}
+
+	sendEvents();
+
+	closeConnection();
+
+	if( m_connectionPool )
+	{
+		m_connectionPool->releaseThread( m_thread );
+	}
+	else
+	{
+		m_thread->quit();
+	}
+
+	if( m_deleteAfterStop )
+	{
+		deleteLater();
+	}
+}
+
+
+
+void VeyonVncConnection::setState( State state )
+{
+	if( state != m_state )
+	{
+		m_state = state;
+
+		emit stateChanged();
+	}
+}
+
+
+
+void VeyonVncConnection::finishFrameBufferUpdate()
+{
+	if( m_frameBufferValid == false )
+	{
+		m_frameBufferValid = true;
+
+		emit framebufferSizeChanged( m_image.width(), m_image.height() );
+	}
+
+	updateScaledScreen();
+
+	emit framebufferUpdateComplete();
+
+	++m_receivedUpdates;
+
+	if( m_framebufferChanged && m_inputPending )
+	{
+		// screen changed after input has been sent - not necessarily caused by it but usually it is
+		m_inputLatencySum += m_inputTime.elapsed();
+		++m_inputLatencyCount;
+		m_inputPending = false;
+	}
+
+	m_framebufferChanged = false;
+
+	if( m_updateRequestPipelined )
+	{
+		// next request already has been sent while receiving this update
+		m_updateRequestPipelined = false;
+	}
+	else if( m_updateRequestPending )
+	{
+		finishFramebufferUpdateRequest();
+	}
+
+	updateStatistics();
+
+	// no update interval set so immediately request next update instead of waiting for update timer
+	if( m_framebufferUpdateInterval.load() <= 0 && m_framebufferUpdatesPaused.load() == 0 &&
+			m_state == Connected && m_updateRequestPending == false )
+	{
+		requestFramebufferUpdate( true );
+		startUpdateTimer();
+	}
+}
+
+
+
+void VeyonVncConnection::updateScaledScreen()
+{
+	m_mutex.lock();
+	const auto scaledSize = m_scaledSize;
+	m_mutex.unlock();
+
+	if( scaledSize.isEmpty() )
+	{
+		// no scaled screen required (e.g. remote control) so do not track changes
+		m_damagedRegion = QRegion();
+		return;
+	}
+
+	if( m_frameBufferValid == false || m_image.isNull() )
+	{
+		return;
+	}
+
+	QRegion scaledRegion;
+
+	if( m_scaledFramebuffer.size() != scaledSize )
+	{
+		m_scaledFramebuffer = QImage( scaledSize, QImage::Format_RGB32 );
+		scaledRegion = m_scaledFramebuffer.rect();
+	}
+	else if( m_damagedRegion.isEmpty() == false )
+	{
+		qint64 damagedArea = 0;
+		for( const auto& rect : regionRects( m_damagedRegion ) )
+		{
+			damagedArea += rect.width() * rect.height();
+		}
+
+		if( damagedArea * 100 >= static_cast<qint64>( m_image.width() ) * m_image.height() * FullRescaleThreshold )
+		{
+			scaledRegion = m_scaledFramebuffer.rect();
+		}
+		else if( m_damagedRegion.rectCount() > MaximumDamagedRects )
+		{
+			scaledRegion = ImageScaler::mapToDestination( m_damagedRegion.boundingRect(), m_image.size(), scaledSize );
+		}
+		else
+		{
+			for( const auto& rect : regionRects( m_damagedRegion ) )
+			{
+				scaledRegion += ImageScaler::mapToDestination( rect, m_image.size(), scaledSize );
+			}
+		}
+	}
+
+	m_damagedRegion = QRegion();
+
+	if( scaledRegion.isEmpty() )
+	{
+		return;
+	}
+
+	// framebuffer is only modified in this thread so no need to lock it while reading
+	for( const auto& rect : regionRects( scaledRegion ) )
+	{
+		ImageScaler::scale( m_image, m_scaledFramebuffer, rect );
+	}
+
+	QMutexLocker locker( &m_scaledScreenMutex );
+	m_scaledScreen = m_scaledFramebuffer;
+}
+
+
+
+void VeyonVncConnection::requestFramebufferUpdate( bool incremental )
+{
+	SendFramebufferUpdateRequest( m_cl, 0, 0, framebufferSize().width(), framebufferSize().height(), incremental );
+
+	m_updateRequestPending = true;
+	m_updateRequestIncremental = incremental;
+	m_updateRequestTime.restart();
+}
+
+
+
+void VeyonVncConnection::finishFramebufferUpdateRequest()
+{
+	m_updateRequestPending = false;
+
+	// the server answers incremental requests not before the screen changes so their latency
+	// includes an arbitrary idle time and must not be taken as round trip time
+	if( m_updateRequestIncremental == false )
+	{
+		const int updateLatency = static_cast<int>( m_updateRequestTime.elapsed() );
+		if( m_minimumUpdateLatency < 0 || updateLatency < m_minimumUpdateLatency )
+		{
+			m_minimumUpdateLatency = updateLatency;
+		}
+	}
+
+	adaptFramebufferUpdateInterval( qMax( 0, m_minimumUpdateLatency ) );
+}
+
+
+
+void VeyonVncConnection::adaptFramebufferUpdateInterval( int updateLatency )
+{
+	const int minimumInterval = m_minimumFramebufferUpdateInterval.load();
+	const int maximumInterval = m_maximumFramebufferUpdateInterval.load();
+
+	if( minimumInterval >= maximumInterval )
+	{
+		// fixed interval
+		return;
+	}
+
+	int interval = m_framebufferUpdateInterval.load();
+
+	if( updateLatency < 0 )
+	{
+		// screen did not change - a pending incremental request still makes the server send the
+		// next change immediately so we can safely poll less often
+		interval = interval * UpdateIntervalIncreasePercentage / 100;
+	}
+	else if( updateLatency > interval / 2 )
+	{
+		// slow or congested link - keep it idle for at least half of the time
+		interval = updateLatency * 2;
+	}
+	else
+	{
+		interval = interval * UpdateIntervalDecreasePercentage / 100;
+	}
+
+	m_framebufferUpdateInterval.store( qBound( minimumInterval, interval, maximumInterval ) );
+}
+
+
+
+void VeyonVncConnection::resetStatistics()
+{
+	m_receivedBytes = 0;
+	m_receivedUpdates = 0;
+	m_minimumUpdateLatency = -1;
+	m_inputLatencySum = 0;
+	m_inputLatencyCount = 0;
+	m_statisticsTime.start();
+
+	QMutexLocker locker( &m_statisticsMutex );
+	m_statistics = Statistics();
+	m_statistics.updateInterval = m_framebufferUpdateInterval.load();
+}
+
+
+
+void VeyonVncConnection::updateStatistics()
+{
+	const auto elapsed = m_statisticsTime.elapsed();
+
+	if( elapsed < StatisticsInterval )
+	{
+		return;
+	}
+
+	m_statisticsMutex.lock();
+
+	m_statistics.bytesPerSecond = m_receivedBytes * 1000 / elapsed;
+	m_statistics.updatesPerSecond = m_receivedUpdates * 1000.0 / elapsed;
+	if( m_minimumUpdateLatency >= 0 )
+	{
+		m_statistics.roundTripTime = m_minimumUpdateLatency;
+	}
+	if( m_inputLatencyCount > 0 )
+	{
+		m_statistics.inputLatency = static_cast<int>( m_inputLatencySum / m_inputLatencyCount );
+	}
+	m_statistics.updateInterval = m_framebufferUpdateInterval.load();
+
+	m_statisticsMutex.unlock();
+
+	if( isLowLatencyMode() && m_inputLatencyCount > 0 )
+	{
+		qDebug() << "VeyonVncConnection: average input latency" << m_inputLatencySum / m_inputLatencyCount << "ms"
+				 << "round trip time" << m_minimumUpdateLatency << "ms";
+	}
+
+	m_receivedBytes = 0;
+	m_receivedUpdates = 0;
+	m_inputLatencySum = 0;
+	m_inputLatencyCount = 0;
+	m_statisticsTime.restart();
+}
+
+
+
+void VeyonVncConnection::sendEvents()
+{
+	m_eventsPending.store( 0 );
+
+	VncClientEvent event;
+	QQueue<VncClientEvent> overflowEvents;
+
+	do
+	{
+		while( m_eventQueue.dequeue( event ) )
+		{
+			// only send latest of consecutive pointer movements
+			const auto nextEvent = m_eventQueue.peek();
+			if( nextEvent && event.isSupersededBy( *nextEvent ) )
+			{
+				continue;
+			}
+
+			sendEvent( event );
+		}
+
+		// all events in overflow queue have been queued after the ones in the lock-free queue
+		if( m_eventQueueOverflow.load() )
+		{
+			m_mutex.lock();
+			overflowEvents.swap( m_eventOverflowQueue );
+			m_eventQueueOverflow.store( 0 );
+			m_mutex.unlock();
+
+			while( overflowEvents.isEmpty() == false )
+			{
+				sendEvent( overflowEvents.dequeue() );
+			}
+		}
+	} while( m_eventQueue.isEmpty() == false );
+
+	// make sure the server can send resulting changes immediately
+	if( isLowLatencyMode() && m_inputPending && m_updateRequestPending == false &&
+			m_frameBufferValid && m_cl && m_state == Connected )
+	{
+		requestFramebufferUpdate( true );
+	}
+}
+
+
+
+void VeyonVncConnection::sendEvent( const VncClientEvent& event )
+{
+	if( m_cl == nullptr || m_state != Connected )
+	{
+		return;
+	}
+
+	// libvncclient functions do not take const data
+	auto data = event.data();
+
+	switch( event.type() )
+	{
+	case VncClientEvent::PointerEvent:
+		SendPointerEvent( m_cl, event.x(), event.y(), event.buttonMask() );
+		startInputLatencyMeasurement();
+		break;
+	case VncClientEvent::KeyEvent:
+		SendKeyEvent( m_cl, event.key(), event.pressed() );
+		startInputLatencyMeasurement();
+		break;
+	case VncClientEvent::ClientCutTextEvent:
+		SendClientCutText( m_cl, data.data(), data.size() );
+		break;
+	case VncClientEvent::RawMessageEvent:
+		WriteToRFBServer( m_cl, data.data(), data.size() );
+		break;
+	default:
+		break;
+	}
+}
+
+
+
+void VeyonVncConnection::startInputLatencyMeasurement()
+{
+	if( m_inputPending == false )
+	{
+		m_inputPending = true;
+		m_inputTime.restart();
+	}
+}
+
+
+
+void VeyonVncConnection::enqueueEvent( const VncClientEvent& event )
+{
+	if( m_state != Connected )
+	{
+		return;
+	}
+
+	// connection thread does not keep up with sending events? then queue events in overflow
+	// queue until it has been processed in order to preserve event order
+	if( m_eventQueueOverflow.load() || m_eventQueue.enqueue( event ) == false )
+	{
+		QMutexLocker locker( &m_mutex );
+		m_eventOverflowQueue.enqueue( event );
+		m_eventQueueOverflow.store( 1 );
+	}
+
+	// wake up connection thread so the event is sent immediately rather than with next update
+	if( m_eventsPending.testAndSetOrdered( 0, 1 ) )
+	{
+		QMetaObject::invokeMethod( this, "sendEvents", Qt::QueuedConnection );
+	}
+}
+
+
+
+
+void VeyonVncConnection::mouseEvent( int x, int y, int buttonMask )
+{
+	enqueueEvent( VncClientEvent::pointerEvent( x, y, buttonMask ) );
+}
 
 
 
 
 void VeyonVncConnection::keyEvent( unsigned int key, bool pressed )
 {
-	enqueueEvent( new KeyClientEvent( key, pressed ) );
+	enqueueEvent( VncClientEvent::keyEvent( key, pressed ) );
 }
 
 
@@ -738,7 +1367,7 @@ void VeyonVncConnection::keyEvent( unsigned int key, bool pressed )
 
 void VeyonVncConnection::clientCut( const QString &text )
 {
-	enqueueEvent( new ClientCutEvent( text ) );
+	enqueueEvent( VncClientEvent::clientCutTextEvent( text ) );
 }
 
 
@@ -765,6 +1394,14 @@ void VeyonVncConnection::handleSecTypeVeyon( rfbClient *client )
 #endif
 	}
 
+	// servers supporting other feature message formats append the latest supported one
+	auto featureMessageFormat = FeatureMessage::LegacyFormat;
+	if( message.atEnd() == false )
+	{
+		featureMessageFormat = static_cast<FeatureMessage::Format>(
+					qBound<int>( FeatureMessage::LegacyFormat, message.read().toInt(), FeatureMessage::LatestFormat ) );
+	}
+
 	qDebug() << "VeyonVncConnection::handleSecTypeVeyon(): received authentication types:" << authTypes;
 
 	RfbVeyonAuth::Type chosenAuthType = RfbVeyonAuth::Token;
@@ -804,8 +1441,17 @@ void VeyonVncConnection::handleSecTypeVeyon( rfbClient *client )
 		authReplyMessage.write( VeyonCore::platform().userFunctions().currentUser() );
 	}
 
+	// ignored by servers not supporting other feature message formats
+	authReplyMessage.write( featureMessageFormat );
+
 	authReplyMessage.send();
 
+	auto connection = static_cast<VeyonVncConnection *>( rfbClientGetClientData( client, nullptr ) );
+	if( connection )
+	{
+		connection->m_featureMessageFormat = featureMessageFormat;
+	}
+
 	VariantArrayMessage authAckMessage( &socketDevice );
 	authAckMessage.receive();
 
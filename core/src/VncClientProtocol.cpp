@@ -24,7 +24,6 @@
 
 #include "VeyonCore.h"
 
-#include <QBuffer>
 #include <QRegion>
 #include <QTcpSocket>
 
@@ -74,9 +73,31 @@ VncClientProtocol::VncClientProtocol( QTcpSocket* socket, const QString& vncPass
 	m_vncPassword( vncPassword.toUtf8() ),
 	m_serverInitMessage(),
 	m_framebufferWidth( 0 ),
-	m_framebufferHeight( 0 )
+	m_framebufferHeight( 0 ),
+	m_forwardingDevice( nullptr ),
+	m_lastMessage(),
+	m_lastMessageType( 0 ),
+	m_lastUpdatedRect(),
+	m_lastUpdatedRegion(),
+	m_lastUpdateSelfContained( true ),
+	m_tightZlibStreams( 0 ),
+	m_tightZlibStreamResets( 0 ),
+	m_updateState( UpdateIdle ),
+	m_updateMessage(),
+	m_updateDataToSkip( 0 ),
+	m_updateRectCount( 0 ),
+	m_updateRectIndex( 0 ),
+	m_updatedRegion(),
+	m_hextileX( 0 ),
+	m_hextileY( 0 ),
+	m_hextileSubencoding( 0 ),
+	m_tightControl( 0 ),
+	m_tightBitsPerPixel( 0 ),
+	m_updateTightZlibStreams( 0 ),
+	m_updateSelfContained( true )
 {
 	memset( &m_pixelFormat, 0, sz_rfbPixelFormat );
+	memset( &m_updateRectHeader, 0, sz_rfbFramebufferUpdateRectHeader );
 }
 
 
@@ -84,6 +105,39 @@ VncClientProtocol::VncClientProtocol( QTcpSocket* socket, const QString& vncPass
 void VncClientProtocol::start()
 {
 	m_state = Protocol;
+
+	// discard partially received update of previous connection
+	m_updateState = UpdateIdle;
+	m_updateMessage.clear();
+	m_updateDataToSkip = 0;
+
+	// new connection to server so server starts with new zlib streams
+	m_tightZlibStreams = 0;
+}
+
+
+
+void VncClientProtocol::setForwardingDevice( QIODevice* device )
+{
+	m_forwardingDevice = device;
+
+	if( m_forwardingDevice )
+	{
+		// keep allocated memory when forwarded data gets removed from buffer
+		m_updateMessage.reserve( ForwardingBufferSize );
+
+		// forward data of a partially received framebuffer update
+		forwardUpdateData();
+	}
+}
+
+
+
+void VncClientProtocol::resetTightZlibStreams()
+{
+	// make receivers reset their streams with next Tight encoded rect by setting
+	// the according flags in its compression control byte
+	m_tightZlibStreamResets = TightZlibStreamResetMask;
 }
 
 
@@ -128,6 +182,9 @@ bool VncClientProtocol::setPixelFormat( rfbPixelFormat pixelFormat )
 	spf.format.greenMax = qFromBigEndian(pixelFormat.greenMax);
 	spf.format.blueMax = qFromBigEndian(pixelFormat.blueMax);
 
+	// parse subsequent framebuffer updates according to new pixel format
+	m_pixelFormat = spf.format;
+
 	return m_socket->write( reinterpret_cast<const char *>( &spf ), sz_rfbSetPixelFormatMsg ) == sz_rfbSetPixelFormatMsg;
 }
 
@@ -164,6 +221,19 @@ bool VncClientProtocol::setEncodings( const QVector<uint32_t>& encodings )
 
 
 
+bool VncClientProtocol::setScale( int scale )
+{
+	rfbSetScaleMsg setScaleMessage;
+
+	setScaleMessage.type = rfbSetScale;
+	setScaleMessage.scale = static_cast<uint8_t>( scale );
+	setScaleMessage.pad = 0;
+
+	return m_socket->write( reinterpret_cast<const char *>( &setScaleMessage ), sz_rfbSetScaleMsg ) == sz_rfbSetScaleMsg;
+}
+
+
+
 void VncClientProtocol::requestFramebufferUpdate( bool incremental )
 {
 	rfbFramebufferUpdateRequestMsg updateRequest;
@@ -186,6 +256,12 @@ void VncClientProtocol::requestFramebufferUpdate( bool incremental )
 
 bool VncClientProtocol::receiveMessage()
 {
+	// continue receiving framebuffer update if we already started
+	if( m_updateState != UpdateIdle )
+	{
+		return receiveFramebufferUpdateMessage();
+	}
+
 	uint8_t messageType = 0;
 	if( m_socket->peek( reinterpret_cast<char *>( &messageType ), sizeof(messageType) ) != sizeof(messageType) )
 	{
@@ -405,58 +481,77 @@ bool VncClientProtocol::receiveServerInitMessage()
 
 bool VncClientProtocol::receiveFramebufferUpdateMessage()
 {
-	// peek all available data and work on a local buffer so we can continously read from it
-	QByteArray data = m_socket->peek( m_socket->bytesAvailable() );
-
-	QBuffer buffer( &data );
-	buffer.open( QBuffer::ReadOnly ); // Flawfinder: ignore
-
-	rfbFramebufferUpdateMsg message;
-	if( buffer.read( reinterpret_cast<char *>( &message ), sz_rfbFramebufferUpdateMsg ) != sz_rfbFramebufferUpdateMsg )
+	if( receiveFramebufferUpdateData() )
 	{
-		return false;
+		return true;
 	}
 
-	QRegion updatedRegion;
+	// pass on everything parsed so far
+	forwardUpdateData();
+
+	return false;
+}
 
-	int nRects = qFromBigEndian( message.nRects );
 
-	for( int i = 0; i < nRects; ++i )
+
+bool VncClientProtocol::receiveFramebufferUpdateData()
+{
+	if( m_updateState == UpdateIdle )
 	{
-		rfbFramebufferUpdateRectHeader rectHeader;
-		if( buffer.read( reinterpret_cast<char *>( &rectHeader ), sz_rfbFramebufferUpdateRectHeader ) != sz_rfbFramebufferUpdateRectHeader )
+		rfbFramebufferUpdateMsg message;
+		if( readUpdateData( &message, sz_rfbFramebufferUpdateMsg ) == false )
 		{
 			return false;
 		}
 
-		rectHeader.encoding = qFromBigEndian( rectHeader.encoding );
-		rectHeader.r.w = qFromBigEndian( rectHeader.r.w );
-		rectHeader.r.h = qFromBigEndian( rectHeader.r.h );
-		rectHeader.r.x = qFromBigEndian( rectHeader.r.x );
-		rectHeader.r.y = qFromBigEndian( rectHeader.r.y );
+		m_updateRectCount = qFromBigEndian( message.nRects );
+		m_updateRectIndex = 0;
+		m_updatedRegion = QRegion();
+		m_updateTightZlibStreams = 0;
+		m_updateSelfContained = true;
+		m_updateState = UpdateRectHeader;
+	}
+
+	// continue where we stopped last time
+	while( skipUpdateData() )
+	{
+		bool continueParsing = true;
 
-		if( rectHeader.encoding == rfbEncodingLastRect )
+		switch( m_updateState )
 		{
+		case UpdateRectHeader:
+			if( m_updateRectIndex >= m_updateRectCount )
+			{
+				finishFramebufferUpdateMessage();
+				return true;
+			}
+			continueParsing = receiveRectHeader();
 			break;
-		}
 
-		if( handleRect( buffer, rectHeader ) == false )
-		{
+		case UpdateRectFinished: finishRect(); break;
+		case UpdateRREHeader: continueParsing = receiveRREHeader(); break;
+		case UpdateHextileTile: continueParsing = receiveHextileTile(); break;
+		case UpdateHextileSubrectCount: continueParsing = receiveHextileSubrectCount(); break;
+		case UpdateZlibHeader: continueParsing = receiveZlibHeader(); break;
+		case UpdateZRLEHeader: continueParsing = receiveZRLEHeader(); break;
+		case UpdateTightControl: continueParsing = receiveTightControl(); break;
+		case UpdateTightFilter: continueParsing = receiveTightFilter(); break;
+		case UpdateTightPalette: continueParsing = receiveTightPalette(); break;
+		case UpdateTightBasicData: receiveTightBasicData(); break;
+		case UpdateTightCompactData: continueParsing = receiveTightCompactData(); break;
+
+		default:
+			abortUpdate( "invalid parser state" );
 			return false;
 		}
 
-		if( isPseudoEncoding( rectHeader ) == false &&
-			rectHeader.r.x+rectHeader.r.w <= m_framebufferWidth &&
-			rectHeader.r.y+rectHeader.r.h <= m_framebufferHeight )
+		if( continueParsing == false )
 		{
-			updatedRegion += QRect( rectHeader.r.x, rectHeader.r.y, rectHeader.r.w, rectHeader.r.h );
+			return false;
 		}
 	}
 
-	m_lastUpdatedRect = updatedRegion.boundingRect();
-
-	// save as much data as we read by processing rects
-	return readMessage( buffer.pos() );
+	return false;
 }
 
 
@@ -529,6 +624,13 @@ bool VncClientProtocol::readMessage( qint64 size )
 	if( message.size() == size )
 	{
 		m_lastMessage = message;
+		m_lastMessageType = static_cast<uint8_t>( message.constData()[0] );
+
+		if( m_forwardingDevice )
+		{
+			m_forwardingDevice->write( m_lastMessage );
+		}
+
 		return true;
 	}
 
@@ -539,224 +641,544 @@ bool VncClientProtocol::readMessage( qint64 size )
 
 
 
-bool VncClientProtocol::handleRect( QBuffer& buffer, rfbFramebufferUpdateRectHeader rectHeader )
+bool VncClientProtocol::readUpdateData( void* data, qint64 size )
+{
+	if( m_socket->bytesAvailable() < size )
+	{
+		return false;
+	}
+
+	const auto offset = m_updateMessage.size();
+	m_updateMessage.resize( offset + static_cast<int>( size ) );
+
+	if( m_socket->read( m_updateMessage.data() + offset, size ) != size ) // Flawfinder: ignore
+	{
+		m_updateMessage.resize( offset );
+		abortUpdate( "could not read data from socket" );
+		return false;
+	}
+
+	if( data )
+	{
+		memcpy( data, m_updateMessage.constData() + offset, static_cast<size_t>( size ) ); // Flawfinder: ignore
+	}
+
+	return true;
+}
+
+
+
+bool VncClientProtocol::skipUpdateData()
+{
+	// read opaque rect data as far as available
+	while( m_updateDataToSkip > 0 )
+	{
+		const auto size = qMin( m_socket->bytesAvailable(), m_updateDataToSkip );
+		if( size <= 0 )
+		{
+			return false;
+		}
+
+		if( readUpdateData( nullptr, size ) == false )
+		{
+			return false;
+		}
+
+		m_updateDataToSkip -= size;
+	}
+
+	return true;
+}
+
+
+
+void VncClientProtocol::forwardUpdateData()
 {
-	const uint width = rectHeader.r.w;
-	const uint height = rectHeader.r.h;
+	if( m_forwardingDevice && m_updateMessage.isEmpty() == false )
+	{
+		m_forwardingDevice->write( m_updateMessage.constData(), m_updateMessage.size() );
+
+		// reuse buffer for further data
+		m_updateMessage.resize( 0 );
+	}
+}
 
-	const uint bytesPerPixel = m_pixelFormat.bitsPerPixel / 8;
-	const uint bytesPerRow = ( width + 7 ) / 8;
+
+
+void VncClientProtocol::abortUpdate( const char* error )
+{
+	qCritical() << "VncClientProtocol: aborting framebuffer update:" << error;
+
+	m_updateState = UpdateIdle;
+	m_updateMessage.clear();
+	m_updateDataToSkip = 0;
+
+	m_socket->close();
+}
+
+
+
+bool VncClientProtocol::receiveRectHeader()
+{
+	auto& rectHeader = m_updateRectHeader;
+
+	if( readUpdateData( &rectHeader, sz_rfbFramebufferUpdateRectHeader ) == false )
+	{
+		return false;
+	}
+
+	rectHeader.encoding = qFromBigEndian( rectHeader.encoding );
+	rectHeader.r.w = qFromBigEndian( rectHeader.r.w );
+	rectHeader.r.h = qFromBigEndian( rectHeader.r.h );
+	rectHeader.r.x = qFromBigEndian( rectHeader.r.x );
+	rectHeader.r.y = qFromBigEndian( rectHeader.r.y );
+
+	const qint64 width = rectHeader.r.w;
+	const qint64 height = rectHeader.r.h;
+	const qint64 bytesPerRow = ( width + 7 ) / 8;
+
+	m_updateState = UpdateRectFinished;
 
 	switch( rectHeader.encoding )
 	{
 	case rfbEncodingLastRect:
-		return true;
+		// skip all remaining rects
+		m_updateRectIndex = m_updateRectCount;
+		m_updateState = UpdateRectHeader;
+		break;
 
 	case rfbEncodingXCursor:
-		return width * height == 0 ||
-				( buffer.read( sz_rfbXCursorColors ).size() == sz_rfbXCursorColors &&
-				  buffer.read( 2 * bytesPerRow * height ).size() == static_cast<qint64>( 2 * bytesPerRow * height ) );
+		if( width * height > 0 )
+		{
+			m_updateDataToSkip = sz_rfbXCursorColors + 2 * bytesPerRow * height;
+		}
+		break;
 
 	case rfbEncodingRichCursor:
-		return width * height == 0 ||
-				( buffer.read( width * height * bytesPerPixel ).size() == static_cast<qint64>( width * height * bytesPerPixel ) &&
-				  buffer.read( bytesPerRow * height ).size() == static_cast<qint64>( bytesPerRow * height ) );
+		if( width * height > 0 )
+		{
+			m_updateDataToSkip = width * height * bytesPerPixel() + bytesPerRow * height;
+		}
+		break;
 
 	case rfbEncodingSupportedMessages:
-		return buffer.read( sz_rfbSupportedMessages ).size() == sz_rfbSupportedMessages;
+		m_updateDataToSkip = sz_rfbSupportedMessages;
+		break;
 
 	case rfbEncodingSupportedEncodings:
 	case rfbEncodingServerIdentity:
 		// width = byte count
-		return buffer.read( width ).size() == static_cast<qint64>( width );
+		m_updateDataToSkip = width;
+		break;
 
 	case rfbEncodingRaw:
-		return buffer.read( width * height * bytesPerPixel ).size() == static_cast<qint64>( width * height * bytesPerPixel );
+		m_updateDataToSkip = width * height * bytesPerPixel();
+		break;
 
 	case rfbEncodingCopyRect:
-		return buffer.read( sz_rfbCopyRect ).size() == sz_rfbCopyRect;
+		m_updateDataToSkip = sz_rfbCopyRect;
+		break;
 
 	case rfbEncodingRRE:
-		return handleRectEncodingRRE( buffer, bytesPerPixel );
-
 	case rfbEncodingCoRRE:
-		return handleRectEncodingCoRRE( buffer, bytesPerPixel );
+		m_updateState = UpdateRREHeader;
+		break;
 
 	case rfbEncodingHextile:
-		return handleRectEncodingHextile( buffer, rectHeader, bytesPerPixel );
+		m_hextileX = rectHeader.r.x;
+		m_hextileY = rectHeader.r.y;
+		m_updateState = width * height > 0 ? UpdateHextileTile : UpdateRectFinished;
+		break;
 
 	case rfbEncodingUltra:
 	case rfbEncodingUltraZip:
 	case rfbEncodingZlib:
-		return handleRectEncodingZlib( buffer );
+		m_updateState = UpdateZlibHeader;
+		break;
 
 	case rfbEncodingZRLE:
 	case rfbEncodingZYWRLE:
-		return handleRectEncodingZRLE( buffer );
+		m_updateState = UpdateZRLEHeader;
+		break;
+
+	case rfbEncodingTight:
+		m_updateState = UpdateTightControl;
+		break;
 
 	case rfbEncodingPointerPos:
 	case rfbEncodingKeyboardLedState:
 	case rfbEncodingNewFBSize:
 		// no further data to read for this rect
-		return true;
+		break;
 
 	default:
 		qCritical() << Q_FUNC_INFO << "Unsupported rect encoding" << rectHeader.encoding;
-		m_socket->close();
-		break;
+		abortUpdate( "unsupported rect encoding" );
+		return false;
 	}
 
-	return false;
+	return true;
+}
+
+
+
+void VncClientProtocol::finishRect()
+{
+	const auto& rectHeader = m_updateRectHeader;
+
+	if( rectHeader.encoding == rfbEncodingNewFBSize )
+	{
+		m_framebufferWidth = rectHeader.r.w;
+		m_framebufferHeight = rectHeader.r.h;
+	}
+
+	if( isPseudoEncoding( rectHeader ) == false &&
+		rectHeader.r.x+rectHeader.r.w <= m_framebufferWidth &&
+		rectHeader.r.y+rectHeader.r.h <= m_framebufferHeight )
+	{
+		m_updatedRegion += QRect( rectHeader.r.x, rectHeader.r.y, rectHeader.r.w, rectHeader.r.h );
+	}
+
+	++m_updateRectIndex;
+	m_updateState = UpdateRectHeader;
+}
+
+
+
+void VncClientProtocol::finishFramebufferUpdateMessage()
+{
+	m_lastUpdatedRect = m_updatedRegion.boundingRect();
+	m_lastUpdatedRegion = m_updatedRegion;
+	// subsequent updates must not depend on zlib streams used before this update either
+	m_lastUpdateSelfContained = m_updateSelfContained &&
+			( m_tightZlibStreams & ~m_updateTightZlibStreams ) == 0;
+	m_lastMessageType = rfbFramebufferUpdate;
+
+	if( m_forwardingDevice )
+	{
+		forwardUpdateData();
+		m_lastMessage.clear();
+	}
+	else
+	{
+		m_lastMessage.swap( m_updateMessage );
+		m_updateMessage.clear();
+	}
+
+	m_updateState = UpdateIdle;
 }
 
 
 
-bool VncClientProtocol::handleRectEncodingRRE( QBuffer& buffer, uint bytesPerPixel )
+bool VncClientProtocol::receiveRREHeader()
 {
-	rfbRREHeader hdr;
+	rfbRREHeader header;
 
-	if( buffer.read( reinterpret_cast<char *>( &hdr ), sz_rfbRREHeader ) != sz_rfbRREHeader )
+	if( readUpdateData( &header, sz_rfbRREHeader ) == false )
 	{
 		return false;
 	}
 
-	const auto rectDataSize = qFromBigEndian( hdr.nSubrects ) * ( bytesPerPixel + sz_rfbRectangle );
-	const auto totalDataSize = static_cast<qint64>( bytesPerPixel + rectDataSize );
+	const qint64 subrectSize = m_updateRectHeader.encoding == rfbEncodingCoRRE ? 4 : sz_rfbRectangle;
 
-	return buffer.read( totalDataSize ).size() == totalDataSize;
+	// background pixel followed by subrects
+	m_updateDataToSkip = bytesPerPixel() + qFromBigEndian( header.nSubrects ) * ( bytesPerPixel() + subrectSize );
+	m_updateState = UpdateRectFinished;
+
+	return true;
 }
 
 
 
-bool VncClientProtocol::handleRectEncodingCoRRE( QBuffer& buffer, uint bytesPerPixel )
+bool VncClientProtocol::receiveHextileTile()
 {
-	rfbRREHeader hdr;
+	if( readUpdateData( &m_hextileSubencoding, 1 ) == false )
+	{
+		return false;
+	}
+
+	const auto& r = m_updateRectHeader.r;
+	const qint64 tileWidth = qMin<uint>( HextileTileSize, r.x + r.w - m_hextileX );
+	const qint64 tileHeight = qMin<uint>( HextileTileSize, r.y + r.h - m_hextileY );
+
+	if( m_hextileSubencoding & rfbHextileRaw )
+	{
+		m_updateDataToSkip = tileWidth * tileHeight * bytesPerPixel();
+		nextHextileTile();
+		return true;
+	}
+
+	m_updateDataToSkip = 0;
 
-	if( buffer.read( reinterpret_cast<char *>( &hdr ), sz_rfbRREHeader ) != sz_rfbRREHeader )
+	if( m_hextileSubencoding & rfbHextileBackgroundSpecified )
+	{
+		m_updateDataToSkip += bytesPerPixel();
+	}
+
+	if( m_hextileSubencoding & rfbHextileForegroundSpecified )
+	{
+		m_updateDataToSkip += bytesPerPixel();
+	}
+
+	if( m_hextileSubencoding & rfbHextileAnySubrects )
+	{
+		// read subrect count after background and foreground pixels
+		m_updateState = UpdateHextileSubrectCount;
+	}
+	else
+	{
+		nextHextileTile();
+	}
+
+	return true;
+}
+
+
+
+bool VncClientProtocol::receiveHextileSubrectCount()
+{
+	uint8_t subrectCount = 0;
+	if( readUpdateData( &subrectCount, 1 ) == false )
 	{
 		return false;
 	}
 
-	const auto rectDataSize = qFromBigEndian( hdr.nSubrects ) * ( bytesPerPixel + 4 );
-	const auto totalDataSize = static_cast<qint64>( bytesPerPixel + rectDataSize );
+	if( m_hextileSubencoding & rfbHextileSubrectsColoured )
+	{
+		m_updateDataToSkip = subrectCount * ( 2 + bytesPerPixel() );
+	}
+	else
+	{
+		m_updateDataToSkip = subrectCount * 2;
+	}
 
-	return buffer.read( totalDataSize ).size() == totalDataSize;
+	nextHextileTile();
 
+	return true;
 }
 
 
 
-bool VncClientProtocol::handleRectEncodingHextile( QBuffer& buffer,
-													const rfbFramebufferUpdateRectHeader rectHeader,
-													uint bytesPerPixel )
+void VncClientProtocol::nextHextileTile()
 {
-	const uint rx = rectHeader.r.x;
-	const uint ry = rectHeader.r.y;
-	const uint rw = rectHeader.r.w;
-	const uint rh = rectHeader.r.h;
+	const auto& r = m_updateRectHeader.r;
+
+	m_hextileX += HextileTileSize;
 
-	for( uint y = ry; y < ry+rh; y += 16 )
+	if( m_hextileX >= static_cast<uint>( r.x + r.w ) )
 	{
-		for( uint x = rx; x < rx+rw; x += 16 )
-		{
-			uint w = 16, h = 16;
-			if( rx+rw - x < 16 ) w = rx+rw - x;
-			if( ry+rh - y < 16 ) h = ry+rh - y;
+		m_hextileX = r.x;
+		m_hextileY += HextileTileSize;
+	}
 
-			uint8_t subEncoding = 0;
-			if( buffer.read( reinterpret_cast<char *>( &subEncoding ), 1 ) != 1 )
-			{
-				return false;
-			}
+	m_updateState = m_hextileY >= static_cast<uint>( r.y + r.h ) ? UpdateRectFinished : UpdateHextileTile;
+}
 
-			if( subEncoding & rfbHextileRaw )
-			{
-				const auto dataSize = static_cast<qint64>( w * h * bytesPerPixel );
-				if( buffer.read( dataSize ).size() != dataSize )
-				{
-					return false;
-				}
-				continue;
-			}
 
-			if( subEncoding & rfbHextileBackgroundSpecified )
-			{
-				if( buffer.read( bytesPerPixel ).size() != static_cast<qint64>( bytesPerPixel ) )
-				{
-					return false;
-				}
-			}
 
-			if( subEncoding & rfbHextileForegroundSpecified )
-			{
-				if( buffer.read( bytesPerPixel ).size() != static_cast<qint64>( bytesPerPixel ) )
-				{
-					return false;
-				}
-			}
+bool VncClientProtocol::receiveZlibHeader()
+{
+	rfbZlibHeader header;
 
-			if( !( subEncoding & rfbHextileAnySubrects ) )
-			{
-				continue;
-			}
+	if( readUpdateData( &header, sz_rfbZlibHeader ) == false )
+	{
+		return false;
+	}
 
-			uint8_t nSubrects = 0;
-			if( buffer.read( reinterpret_cast<char *>( &nSubrects ), 1 ) != 1 )
-			{
-				return false;
-			}
+	m_updateDataToSkip = qFromBigEndian( header.nBytes );
+	m_updateState = UpdateRectFinished;
 
-			int64_t subRectDataSize = 0;
+	return true;
+}
 
-			if( subEncoding & rfbHextileSubrectsColoured )
-			{
-				subRectDataSize = nSubrects * ( 2 + bytesPerPixel );
-			}
-			else
-			{
-				subRectDataSize = nSubrects * 2;
-			}
 
-			if( buffer.read( subRectDataSize ).size() != subRectDataSize )
-			{
-				return false;
-			}
-		}
+
+bool VncClientProtocol::receiveZRLEHeader()
+{
+	rfbZRLEHeader header;
+
+	if( readUpdateData( &header, sz_rfbZRLEHeader ) == false )
+	{
+		return false;
 	}
 
+	m_updateDataToSkip = qFromBigEndian( header.length );
+	m_updateState = UpdateRectFinished;
+
 	return true;
 }
 
 
 
-bool VncClientProtocol::handleRectEncodingZlib( QBuffer& buffer )
+bool VncClientProtocol::receiveTightControl()
 {
-	rfbZlibHeader hdr;
+	if( readUpdateData( &m_tightControl, 1 ) == false )
+	{
+		return false;
+	}
+
+	if( m_tightZlibStreamResets )
+	{
+		// inject pending stream resets into first Tight encoded rect
+		m_tightControl |= m_tightZlibStreamResets;
+		m_updateMessage[m_updateMessage.size()-1] = static_cast<char>( m_tightControl );
+		m_tightZlibStreamResets = 0;
+	}
+
+	// lower 4 bits tell the receiver to reset the according zlib streams
+	const uint8_t streamResets = m_tightControl & TightZlibStreamResetMask;
+	m_tightZlibStreams &= ~streamResets;
+	m_updateTightZlibStreams &= ~streamResets;
+
+	m_tightControl >>= 4;
+
+	if( m_tightControl == rfbTightFill )
+	{
+		m_updateDataToSkip = tightPixelSize();
+		m_updateState = UpdateRectFinished;
+	}
+	else if( m_tightControl == rfbTightJpeg )
+	{
+		m_updateState = UpdateTightCompactData;
+	}
+	else if( m_tightControl > rfbTightJpeg )
+	{
+		qCritical() << Q_FUNC_INFO << "Invalid Tight subencoding" << static_cast<int>( m_tightControl );
+		abortUpdate( "invalid Tight subencoding" );
+		return false;
+	}
+	else if( m_tightControl & rfbTightExplicitFilter )
+	{
+		m_updateState = UpdateTightFilter;
+	}
+	else
+	{
+		m_tightBitsPerPixel = tightPixelSize() * 8;
+		m_updateState = UpdateTightBasicData;
+	}
+
+	return true;
+}
+
+
+
+bool VncClientProtocol::receiveTightFilter()
+{
+	uint8_t filter = 0;
+	if( readUpdateData( &filter, 1 ) == false )
+	{
+		return false;
+	}
+
+	switch( filter )
+	{
+	case rfbTightFilterCopy:
+	case rfbTightFilterGradient:
+		m_tightBitsPerPixel = tightPixelSize() * 8;
+		m_updateState = UpdateTightBasicData;
+		break;
+
+	case rfbTightFilterPalette:
+		m_updateState = UpdateTightPalette;
+		break;
 
-	if( buffer.read( reinterpret_cast<char *>( &hdr ), sz_rfbZlibHeader ) != sz_rfbZlibHeader )
+	default:
+		qCritical() << Q_FUNC_INFO << "Invalid Tight filter" << static_cast<int>( filter );
+		abortUpdate( "invalid Tight filter" );
+		return false;
+	}
+
+	return true;
+}
+
+
+
+bool VncClientProtocol::receiveTightPalette()
+{
+	uint8_t maxColorIndex = 0;
+	if( readUpdateData( &maxColorIndex, 1 ) == false )
 	{
 		return false;
 	}
 
-	const auto n = qFromBigEndian( hdr.nBytes );
+	const auto colorCount = static_cast<uint>( maxColorIndex ) + 1;
 
-	return buffer.read( n ).size() == static_cast<int64_t>( n );
+	m_updateDataToSkip = colorCount * tightPixelSize();
+	m_tightBitsPerPixel = colorCount <= 2 ? 1 : 8;
+	m_updateState = UpdateTightBasicData;
+
+	return true;
 }
 
 
 
-bool VncClientProtocol::handleRectEncodingZRLE(QBuffer &buffer)
+void VncClientProtocol::receiveTightBasicData()
 {
-	rfbZRLEHeader hdr;
+	const auto dataSize = static_cast<qint64>( ( m_updateRectHeader.r.w * m_tightBitsPerPixel + 7 ) / 8 ) *
+			m_updateRectHeader.r.h;
+
+	// small amounts of data are sent uncompressed
+	if( dataSize < TightMinimumDataSizeToCompress )
+	{
+		m_updateDataToSkip = dataSize;
+		m_updateState = UpdateRectFinished;
+		return;
+	}
 
-	if( buffer.read( reinterpret_cast<char *>( &hdr ), sz_rfbZRLEHeader ) != sz_rfbZRLEHeader )
+	// data compressed with a stream which has been used by previous updates can't be decoded on its own
+	const uint8_t stream = 1 << ( m_tightControl & TightZlibStreamMask );
+	if( ( m_tightZlibStreams & stream ) && ( m_updateTightZlibStreams & stream ) == 0 )
+	{
+		m_updateSelfContained = false;
+	}
+
+	m_tightZlibStreams |= stream;
+	m_updateTightZlibStreams |= stream;
+
+	m_updateState = UpdateTightCompactData;
+}
+
+
+
+bool VncClientProtocol::receiveTightCompactData()
+{
+	// 7 bits per byte with the highest bit indicating another byte follows
+	uint8_t data[TightMaximumCompactLengthSize] = { 0, 0, 0 };
+	const auto available = m_socket->peek( reinterpret_cast<char *>( data ), TightMaximumCompactLengthSize );
+
+	qint64 size = 1;
+	while( size < TightMaximumCompactLengthSize && ( data[size-1] & 0x80 ) )
+	{
+		++size;
+	}
+
+	if( available < size || readUpdateData( nullptr, size ) == false )
 	{
 		return false;
 	}
 
-	const auto n = qFromBigEndian( hdr.length );
+	m_updateDataToSkip = ( data[0] & 0x7f ) |
+			( size > 1 ? ( data[1] & 0x7f ) << 7 : 0 ) |
+			( size > 2 ? data[2] << 14 : 0 );
+	m_updateState = UpdateRectFinished;
+
+	return true;
+}
+
+
+
+uint VncClientProtocol::tightPixelSize() const
+{
+	// Tight sends 24 bit true color pixels as 3 bytes
+	if( m_pixelFormat.bitsPerPixel == 32 && m_pixelFormat.depth == 24 &&
+			qFromBigEndian( m_pixelFormat.redMax ) == 0xff &&
+			qFromBigEndian( m_pixelFormat.greenMax ) == 0xff &&
+			qFromBigEndian( m_pixelFormat.blueMax ) == 0xff )
+	{
+		return 3;
+	}
 
-	return buffer.read( n ).size() == static_cast<int64_t>( n );
+	return m_pixelFormat.bitsPerPixel / 8u;
 }
 
 
@@ -0,0 +1,127 @@
+/*
+ * VncConnectionPool.cpp - implementation of VncConnectionPool class
+ *
+ * Copyright (c) 2018 Tobias Junghans <tobydox@veyon.io>
+ *
+ * This file is part of Veyon - http://veyon.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include <QMutexLocker>
+#include <QThread>
+
+#include "VncConnectionPool.h"
+
+
+VncConnectionPool::VncConnectionPool( int threadCount ) :
+	m_mutex(),
+	m_threads(),
+	m_threadLoads(),
+	m_connectThreadPool()
+{
+	threadCount = qBound<int>( 1, threadCount, MaximumThreadCount );
+
+	m_threads.reserve( threadCount );
+	m_threadLoads.fill( 0, threadCount );
+
+	for( int i = 0; i < threadCount; ++i )
+	{
+		auto thread = new QThread;
+		thread->setObjectName( QStringLiteral( "VncConnectionPool/%1" ).arg( i ) );
+		thread->start();
+
+		m_threads.append( thread );
+	}
+
+	m_connectThreadPool.setMaxThreadCount( threadCount * ConnectThreadsPerThread );
+
+	qDebug() << "VncConnectionPool: started" << threadCount << "threads";
+}
+
+
+
+VncConnectionPool::~VncConnectionPool()
+{
+	m_connectThreadPool.clear();
+
+	for( auto thread : m_threads )
+	{
+		thread->quit();
+	}
+
+	for( auto thread : m_threads )
+	{
+		if( thread->wait( ThreadTerminationTimeout ) == false )
+		{
+			qWarning( "VncConnectionPool: terminating hanging VNC connection thread!" );
+			thread->terminate();
+			thread->wait();
+		}
+
+		delete thread;
+	}
+
+	m_connectThreadPool.waitForDone( ThreadTerminationTimeout );
+}
+
+
+
+QThread* VncConnectionPool::acquireThread()
+{
+	QMutexLocker locker( &m_mutex );
+
+	int leastLoadedIndex = 0;
+
+	for( int i = 1; i < m_threadLoads.size(); ++i )
+	{
+		if( m_threadLoads[i] < m_threadLoads[leastLoadedIndex] )
+		{
+			leastLoadedIndex = i;
+		}
+	}
+
+	++m_threadLoads[leastLoadedIndex];
+
+	return m_threads[leastLoadedIndex];
+}
+
+
+
+void VncConnectionPool::acquireThread( QThread* thread )
+{
+	QMutexLocker locker( &m_mutex );
+
+	const auto index = m_threads.indexOf( thread );
+	if( index >= 0 )
+	{
+		++m_threadLoads[index];
+	}
+}
+
+
+
+void VncConnectionPool::releaseThread( QThread* thread )
+{
+	QMutexLocker locker( &m_mutex );
+
+	const auto index = m_threads.indexOf( thread );
+	if( index >= 0 && m_threadLoads[index] > 0 )
+	{
+		--m_threadLoads[index];
+	}
+}
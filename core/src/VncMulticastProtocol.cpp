@@ -0,0 +1,212 @@
+/*
+ * VncMulticastProtocol.cpp - implementation of the VncMulticastProtocol class
+ *
+ * Copyright (c) 2018 Tobias Junghans <tobydox@veyon.io>
+ *
+ * This file is part of Veyon - http://veyon.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include <QMessageAuthenticationCode>
+#include <QtEndian>
+
+#include "VncMulticastProtocol.h"
+
+
+VncMulticastProtocol::Header VncMulticastProtocol::header( quint32 session, PacketType type, Sequence sequence )
+{
+	Header header;
+	header.session = session;
+	header.sequence = sequence;
+	header.index = 0;
+	header.count = 0;
+	header.type = static_cast<quint8>( type );
+	header.flags = NoFlags;
+	header.messageSize = 0;
+
+	return header;
+}
+
+
+
+QByteArray VncMulticastProtocol::packet( const QByteArray& key, const Header& header, const QByteArray& payload )
+{
+	QByteArray datagram( HeaderSize + payload.size(), 0 );
+
+	auto data = reinterpret_cast<uchar *>( datagram.data() );
+
+	qToBigEndian<quint32>( Magic, data );
+	qToBigEndian<quint32>( header.session, data + 4 );
+	qToBigEndian<quint32>( header.sequence, data + 8 );
+	qToBigEndian<quint16>( header.index, data + 12 );
+	qToBigEndian<quint16>( header.count, data + 14 );
+	data[16] = header.type;
+	data[17] = header.flags;
+	// bytes 18 and 19 are reserved
+	qToBigEndian<quint32>( header.messageSize, data + 20 );
+
+	memcpy( data + HeaderSize, payload.constData(), static_cast<size_t>( payload.size() ) ); // Flawfinder: ignore
+
+	datagram.append( authenticationCode( key, datagram.constData(), datagram.size() ) );
+
+	return datagram;
+}
+
+
+
+bool VncMulticastProtocol::parsePacket( const QByteArray& key, const QByteArray& datagram,
+										Header& header, QByteArray& payload )
+{
+	if( datagram.size() < HeaderSize + MacSize )
+	{
+		return false;
+	}
+
+	const int size = datagram.size() - MacSize;
+	const auto mac = authenticationCode( key, datagram.constData(), size );
+
+	// compare in constant time so the authentication code can't be guessed byte by byte
+	char difference = 0;
+	for( int i = 0; i < MacSize; ++i )
+	{
+		difference |= mac[i] ^ datagram[size + i];
+	}
+
+	if( difference != 0 )
+	{
+		return false;
+	}
+
+	const auto data = reinterpret_cast<const uchar *>( datagram.constData() );
+
+	if( qFromBigEndian<quint32>( data ) != Magic )
+	{
+		return false;
+	}
+
+	header.session = qFromBigEndian<quint32>( data + 4 );
+	header.sequence = qFromBigEndian<quint32>( data + 8 );
+	header.index = qFromBigEndian<quint16>( data + 12 );
+	header.count = qFromBigEndian<quint16>( data + 14 );
+	header.type = data[16];
+	header.flags = data[17];
+	header.messageSize = qFromBigEndian<quint32>( data + 20 );
+
+	if( header.type >= PacketTypeCount )
+	{
+		return false;
+	}
+
+	payload = datagram.mid( HeaderSize, size - HeaderSize );
+
+	return true;
+}
+
+
+
+QByteArray VncMulticastProtocol::nackPacket( const QByteArray& key, quint32 session, Sequence sequence,
+											 const IndexList& missingFragments )
+{
+	const int count = qMin<int>( missingFragments.size(), MaximumNackIndices );
+
+	QByteArray payload( count * 2, 0 );
+	auto data = reinterpret_cast<uchar *>( payload.data() );
+
+	for( int i = 0; i < count; ++i )
+	{
+		qToBigEndian<quint16>( missingFragments[i], data + i * 2 );
+	}
+
+	// an empty list requests the whole message
+	return packet( key, header( session, NackPacket, sequence ), payload );
+}
+
+
+
+VncMulticastProtocol::IndexList VncMulticastProtocol::nackIndices( const QByteArray& payload )
+{
+	const auto data = reinterpret_cast<const uchar *>( payload.constData() );
+	const int count = payload.size() / 2;
+
+	IndexList indices;
+	indices.reserve( count );
+
+	for( int i = 0; i < count; ++i )
+	{
+		indices.append( qFromBigEndian<quint16>( data + i * 2 ) );
+	}
+
+	return indices;
+}
+
+
+
+int VncMulticastProtocol::fragmentSize( quint32 messageSize, int index )
+{
+	const qint64 offset = static_cast<qint64>( index ) * FragmentSize;
+
+	return static_cast<int>( qBound<qint64>( 0, messageSize - offset, FragmentSize ) );
+}
+
+
+
+QByteArray VncMulticastProtocol::fragment( const QByteArray& message, int index )
+{
+	return message.mid( index * FragmentSize, FragmentSize );
+}
+
+
+
+QByteArray VncMulticastProtocol::parity( const QByteArray& message, int group )
+{
+	QByteArray parity( FragmentSize, 0 );
+
+	const int firstFragment = group * FecGroupSize;
+	const int endFragment = qMin( firstFragment + FecGroupSize, fragmentCount( static_cast<quint32>( message.size() ) ) );
+
+	for( int i = firstFragment; i < endFragment; ++i )
+	{
+		xorFragment( parity, fragment( message, i ) );
+	}
+
+	return parity;
+}
+
+
+
+void VncMulticastProtocol::xorFragment( QByteArray& parity, const QByteArray& fragment )
+{
+	auto parityData = parity.data();
+	const auto fragmentData = fragment.constData();
+	const int size = qMin( parity.size(), fragment.size() );
+
+	for( int i = 0; i < size; ++i )
+	{
+		parityData[i] ^= fragmentData[i];
+	}
+}
+
+
+
+QByteArray VncMulticastProtocol::authenticationCode( const QByteArray& key, const char* data, int size )
+{
+	QMessageAuthenticationCode code( QCryptographicHash::Sha256, key );
+	code.addData( data, size );
+
+	return code.result().left( MacSize );
+}
@@ -0,0 +1,426 @@
+/*
+ * VncMulticastReceiver.cpp - implementation of the VncMulticastReceiver class
+ *
+ * Copyright (c) 2018 Tobias Junghans <tobydox@veyon.io>
+ *
+ * This file is part of Veyon - http://veyon.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include <QDebug>
+#include <QUdpSocket>
+
+#include "VncMulticastReceiver.h"
+
+
+VncMulticastReceiver::VncMulticastReceiver( const QHostAddress& groupAddress, int port, const QByteArray& key,
+											QObject* parent ) :
+	QObject( parent ),
+	m_socket( new QUdpSocket( this ) ),
+	m_repairTimer( this ),
+	m_key( key ),
+	m_joined( false ),
+	m_senderAddress(),
+	m_senderPort( 0 ),
+	m_lastPacketTime(),
+	m_started( false ),
+	m_delivered( false ),
+	m_sessionId( 0 ),
+	m_nextSequence( 0 ),
+	m_endSequence( 0 ),
+	m_pendingMessages(),
+	m_messages()
+{
+	connect( m_socket, &QUdpSocket::readyRead, this, &VncMulticastReceiver::readDatagrams );
+	connect( &m_repairTimer, &QTimer::timeout, this, &VncMulticastReceiver::repairMessages );
+
+	// multiple receivers (e.g. of different user sessions) may listen on the same host
+	if( m_socket->bind( QHostAddress::AnyIPv4, static_cast<quint16>( port ),
+						QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint ) == false ||
+			m_socket->joinMulticastGroup( groupAddress ) == false )
+	{
+		qWarning() << Q_FUNC_INFO << "could not join multicast group" << groupAddress << port
+				   << m_socket->errorString();
+		return;
+	}
+
+	// a key frame arrives as a burst of datagrams
+	m_socket->setSocketOption( QAbstractSocket::ReceiveBufferSizeSocketOption, ReceiveBufferSize );
+
+	m_joined = true;
+	m_lastPacketTime.start();
+	m_repairTimer.start( RepairInterval );
+}
+
+
+
+VncMulticastReceiver::~VncMulticastReceiver()
+{
+	m_socket->disconnect( this );
+}
+
+
+
+bool VncMulticastReceiver::takeMessage( QByteArray& message )
+{
+	if( m_messages.isEmpty() )
+	{
+		return false;
+	}
+
+	message = m_messages.dequeue();
+
+	return true;
+}
+
+
+
+void VncMulticastReceiver::readDatagrams()
+{
+	VncMulticastProtocol::Header header;
+	QByteArray payload;
+
+	while( m_socket->hasPendingDatagrams() )
+	{
+		QByteArray datagram( static_cast<int>( qMax<qint64>( 0, m_socket->pendingDatagramSize() ) ), 0 );
+		QHostAddress senderAddress;
+		quint16 senderPort = 0;
+
+		if( m_socket->readDatagram( datagram.data(), datagram.size(), &senderAddress, &senderPort ) < 0 ) // Flawfinder: ignore
+		{
+			break;
+		}
+
+		// drop everything not sent by the demo server we've been given the key of
+		if( VncMulticastProtocol::parsePacket( m_key, datagram, header, payload ) == false )
+		{
+			continue;
+		}
+
+		if( m_started && header.session != m_sessionId )
+		{
+			// sender has been restarted so start over with its next key frame
+			qWarning() << Q_FUNC_INFO << "sender session changed";
+			reset();
+		}
+
+		// NACKs are sent to the unicast address the sender sends from
+		m_senderAddress = senderAddress;
+		m_senderPort = senderPort;
+		m_lastPacketTime.restart();
+
+		processPacket( header, payload );
+	}
+
+	deliverMessages();
+}
+
+
+
+void VncMulticastReceiver::repairMessages()
+{
+	if( m_started == false )
+	{
+		return;
+	}
+
+	if( m_lastPacketTime.hasExpired( SenderTimeout ) )
+	{
+		qWarning() << Q_FUNC_INFO << "no packets received from sender within timeout";
+		reset();
+		return;
+	}
+
+	for( auto sequence = m_nextSequence; sequence != m_endSequence; ++sequence )
+	{
+		// also creates entries for messages of which no packet has been received at all
+		auto& message = m_pendingMessages[sequence];
+
+		// do not request fragments which are still being sent or reordered
+		if( message.isComplete() ||
+				message.lastReceived.hasExpired( RepairInterval ) == false ||
+				( message.lastNack.isValid() && message.lastNack.hasExpired( NackRetryInterval ) == false ) )
+		{
+			continue;
+		}
+
+		if( message.nackCount >= MaximumNackCount )
+		{
+			qWarning() << Q_FUNC_INFO << "could not repair message" << sequence;
+			reset();
+			return;
+		}
+
+		sendNack( sequence, message );
+	}
+}
+
+
+
+void VncMulticastReceiver::processPacket( const VncMulticastProtocol::Header& header, const QByteArray& payload )
+{
+	switch( header.type )
+	{
+	case VncMulticastProtocol::HeartbeatPacket:
+		announceSequence( header.sequence );
+		break;
+
+	case VncMulticastProtocol::DataPacket:
+	case VncMulticastProtocol::ParityPacket:
+		if( acceptsSequence( header ) )
+		{
+			if( m_started == false )
+			{
+				m_started = true;
+				m_sessionId = header.session;
+				m_nextSequence = header.sequence;
+				m_endSequence = header.sequence;
+			}
+
+			addFragment( m_pendingMessages[header.sequence], header, payload );
+			announceSequence( header.sequence + 1 );
+		}
+		break;
+
+	default:
+		// ignore NACKs of other receivers
+		break;
+	}
+}
+
+
+
+bool VncMulticastReceiver::acceptsSequence( const VncMulticastProtocol::Header& header ) const
+{
+	if( m_started == false )
+	{
+		// updates can only be decoded starting with a key frame
+		return header.flags & VncMulticastProtocol::KeyFrame;
+	}
+
+	// ignore retransmissions of messages which have been delivered already
+	return header.sequence - m_nextSequence < MaximumPendingMessages;
+}
+
+
+
+void VncMulticastReceiver::addFragment( PendingMessage& message, const VncMulticastProtocol::Header& header,
+										const QByteArray& payload )
+{
+	const int count = header.count;
+
+	if( count != VncMulticastProtocol::fragmentCount( header.messageSize ) )
+	{
+		return;
+	}
+
+	if( message.fragments.isEmpty() )
+	{
+		message.fragments.resize( count );
+		message.parities.resize( VncMulticastProtocol::fecGroupCount( count ) );
+		message.messageSize = header.messageSize;
+	}
+	else if( message.messageSize != header.messageSize )
+	{
+		return;
+	}
+
+	message.lastReceived.restart();
+
+	int group = 0;
+
+	if( header.type == VncMulticastProtocol::DataPacket )
+	{
+		if( header.index >= count || message.fragments[header.index].isEmpty() == false ||
+				payload.size() != VncMulticastProtocol::fragmentSize( header.messageSize, header.index ) )
+		{
+			return;
+		}
+
+		message.fragments[header.index] = payload;
+		++message.receivedFragments;
+
+		group = header.index / VncMulticastProtocol::FecGroupSize;
+	}
+	else
+	{
+		if( header.index >= message.parities.size() || payload.size() != VncMulticastProtocol::FragmentSize )
+		{
+			return;
+		}
+
+		message.parities[header.index] = payload;
+
+		group = header.index;
+	}
+
+	recoverFragment( message, group );
+}
+
+
+
+void VncMulticastReceiver::recoverFragment( PendingMessage& message, int group )
+{
+	if( message.parities[group].isEmpty() )
+	{
+		return;
+	}
+
+	const int firstFragment = group * VncMulticastProtocol::FecGroupSize;
+	const int endFragment = qMin( firstFragment + VncMulticastProtocol::FecGroupSize, message.fragments.size() );
+
+	int missingFragment = -1;
+
+	for( int i = firstFragment; i < endFragment; ++i )
+	{
+		if( message.fragments[i].isEmpty() )
+		{
+			if( missingFragment >= 0 )
+			{
+				// parity can only recover a single fragment
+				return;
+			}
+
+			missingFragment = i;
+		}
+	}
+
+	if( missingFragment < 0 )
+	{
+		return;
+	}
+
+	auto fragment = message.parities[group];
+
+	for( int i = firstFragment; i < endFragment; ++i )
+	{
+		if( i != missingFragment )
+		{
+			VncMulticastProtocol::xorFragment( fragment, message.fragments[i] );
+		}
+	}
+
+	fragment.truncate( VncMulticastProtocol::fragmentSize( message.messageSize, missingFragment ) );
+
+	message.fragments[missingFragment] = fragment;
+	++message.receivedFragments;
+}
+
+
+
+void VncMulticastReceiver::announceSequence( Sequence endSequence )
+{
+	if( m_started == false )
+	{
+		return;
+	}
+
+	// sequence numbers wrap around so compare distances
+	if( endSequence - m_endSequence < 0x80000000u )
+	{
+		m_endSequence = endSequence;
+	}
+	else if( m_nextSequence - endSequence > MaximumPendingMessages )
+	{
+		// sequence is far behind everything received so far so sender has been restarted
+		qWarning() << Q_FUNC_INFO << "sender restarted";
+		reset();
+		return;
+	}
+
+	if( m_endSequence - m_nextSequence > MaximumPendingMessages )
+	{
+		qWarning() << Q_FUNC_INFO << "lagging too far behind sender";
+		reset();
+	}
+}
+
+
+
+void VncMulticastReceiver::deliverMessages()
+{
+	bool delivered = false;
+
+	while( m_started )
+	{
+		auto it = m_pendingMessages.find( m_nextSequence );
+		if( it == m_pendingMessages.end() || it->isComplete() == false )
+		{
+			break;
+		}
+
+		QByteArray message;
+		message.reserve( static_cast<int>( it->messageSize ) );
+
+		for( const auto& fragment : qAsConst( it->fragments ) )
+		{
+			message.append( fragment );
+		}
+
+		m_messages.enqueue( message );
+		m_pendingMessages.erase( it );
+
+		++m_nextSequence;
+		delivered = true;
+	}
+
+	if( delivered )
+	{
+		m_delivered = true;
+		emit messagesAvailable();
+	}
+}
+
+
+
+void VncMulticastReceiver::sendNack( Sequence sequence, PendingMessage& message )
+{
+	VncMulticastProtocol::IndexList missingFragments;
+
+	// an empty list requests the whole message as we don't even know its size yet
+	for( int i = 0; i < message.fragments.size(); ++i )
+	{
+		if( message.fragments[i].isEmpty() )
+		{
+			missingFragments.append( static_cast<quint16>( i ) );
+		}
+	}
+
+	m_socket->writeDatagram( VncMulticastProtocol::nackPacket( m_key, m_sessionId, sequence, missingFragments ),
+							 m_senderAddress, m_senderPort );
+
+	message.lastNack.start();
+	++message.nackCount;
+}
+
+
+
+void VncMulticastReceiver::reset()
+{
+	const bool delivered = m_delivered;
+
+	m_started = false;
+	m_delivered = false;
+	m_pendingMessages.clear();
+	m_messages.clear();
+
+	if( delivered )
+	{
+		emit synchronizationLost();
+	}
+}
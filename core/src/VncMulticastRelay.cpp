@@ -0,0 +1,352 @@
+/*
+ * VncMulticastRelay.cpp - implementation of the VncMulticastRelay class
+ *
+ * Copyright (c) 2018 Tobias Junghans <tobydox@veyon.io>
+ *
+ * This file is part of Veyon - http://veyon.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QtEndian>
+
+#ifdef Q_OS_WIN
+#include <winsock2.h>
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#endif
+
+#include "VncMulticastReceiver.h"
+#include "VncMulticastRelay.h"
+
+
+// accepts a single connection from the given local port without wrapping its descriptor
+// into a QTcpSocket so it can be handed over to the RFB client
+class VncMulticastLoopbackServer : public QTcpServer
+{
+public:
+	VncMulticastLoopbackServer() :
+		QTcpServer(),
+		m_expectedPeerPort( 0 ),
+		m_socketDescriptor( -1 )
+	{
+	}
+
+	void setExpectedPeerPort( quint16 port )
+	{
+		m_expectedPeerPort = port;
+	}
+
+	qintptr socketDescriptor() const
+	{
+		return m_socketDescriptor;
+	}
+
+protected:
+	void incomingConnection( qintptr socketDescriptor ) override
+	{
+		if( m_socketDescriptor < 0 && m_expectedPeerPort > 0 && peerPort( socketDescriptor ) == m_expectedPeerPort )
+		{
+			m_socketDescriptor = socketDescriptor;
+			return;
+		}
+
+		// any other local process could have connected to the loopback port as well
+		qWarning() << Q_FUNC_INFO << "rejecting unexpected connection";
+
+		QTcpSocket socket;
+		socket.setSocketDescriptor( socketDescriptor );
+		socket.abort();
+	}
+
+private:
+	static quint16 peerPort( qintptr socketDescriptor )
+	{
+		sockaddr_in address;
+#ifdef Q_OS_WIN
+		int addressLength = sizeof(address);
+		if( getpeername( static_cast<SOCKET>( socketDescriptor ), reinterpret_cast<sockaddr *>( &address ), &addressLength ) != 0 )
+#else
+		socklen_t addressLength = sizeof(address);
+		if( getpeername( static_cast<int>( socketDescriptor ), reinterpret_cast<sockaddr *>( &address ), &addressLength ) != 0 )
+#endif
+		{
+			return 0;
+		}
+
+		if( address.sin_family != AF_INET )
+		{
+			return 0;
+		}
+
+		return qFromBigEndian( address.sin_port );
+	}
+
+	quint16 m_expectedPeerPort;
+	qintptr m_socketDescriptor;
+
+} ;
+
+
+
+VncMulticastRelay::VncMulticastRelay( qintptr serverSocketDescriptor, const rfbPixelFormat& pixelFormat,
+									  const QHostAddress& groupAddress, int port, const QByteArray& key ) :
+	QObject( nullptr ),
+	m_groupAddress( groupAddress ),
+	m_port( port ),
+	m_key( key ),
+	m_clientSocketDescriptor( -1 ),
+	m_serverSocket( new QTcpSocket( this ) ),
+	m_clientSocket( new QTcpSocket( this ) ),
+	m_serverProtocol( m_serverSocket, QString() ),
+	m_rfbClientToServerMessageSizes( {
+									 std::pair<int, int>( rfbSetPixelFormat, sz_rfbSetPixelFormatMsg ),
+									 std::pair<int, int>( rfbFramebufferUpdateRequest, sz_rfbFramebufferUpdateRequestMsg ),
+									 std::pair<int, int>( rfbKeyEvent, sz_rfbKeyEventMsg ),
+									 std::pair<int, int>( rfbPointerEvent, sz_rfbPointerEventMsg ),
+									 } ),
+	m_receiver( nullptr ),
+	m_mode( TcpMode )
+{
+	// set up a connected pair of local sockets - connecting to a listening loopback socket
+	// succeeds immediately so this does not block
+	VncMulticastLoopbackServer loopbackServer;
+
+	if( loopbackServer.listen( QHostAddress::LocalHost ) == false )
+	{
+		qWarning() << Q_FUNC_INFO << "could not listen on loopback interface:" << loopbackServer.errorString();
+		return;
+	}
+
+	m_clientSocket->connectToHost( QHostAddress::LocalHost, loopbackServer.serverPort() );
+
+	QElapsedTimer connectTimer;
+	connectTimer.start();
+
+	if( m_clientSocket->waitForConnected( LoopbackConnectTimeout ) )
+	{
+		loopbackServer.setExpectedPeerPort( m_clientSocket->localPort() );
+
+		// skip connections from other local processes which have been rejected
+		while( loopbackServer.socketDescriptor() < 0 && connectTimer.hasExpired( LoopbackConnectTimeout ) == false &&
+			   loopbackServer.waitForNewConnection( static_cast<int>( LoopbackConnectTimeout - connectTimer.elapsed() ) ) )
+		{
+		}
+	}
+
+	if( loopbackServer.socketDescriptor() < 0 )
+	{
+		qWarning() << Q_FUNC_INFO << "could not set up loopback connection:" << m_clientSocket->errorString();
+		m_clientSocket->abort();
+		return;
+	}
+
+	// take over server connection only after everything else succeeded as it gets closed along with us
+	m_serverSocket->setSocketDescriptor( serverSocketDescriptor );
+	m_clientSocketDescriptor = loopbackServer.socketDescriptor();
+
+	// the RFB client has negotiated the pixel format with the server already
+	m_serverProtocol.setExpectedPixelFormat( pixelFormat );
+}
+
+
+
+VncMulticastRelay::~VncMulticastRelay()
+{
+	m_serverSocket->disconnect( this );
+	m_clientSocket->disconnect( this );
+}
+
+
+
+void VncMulticastRelay::start()
+{
+	connect( m_serverSocket, &QTcpSocket::readyRead, this, &VncMulticastRelay::readFromServer );
+	connect( m_clientSocket, &QTcpSocket::readyRead, this, &VncMulticastRelay::readFromClient );
+
+	// closing either side makes the RFB client reconnect
+	connect( m_serverSocket, &QTcpSocket::disconnected, m_clientSocket, &QTcpSocket::close );
+	connect( m_clientSocket, &QTcpSocket::disconnected, m_serverSocket, &QTcpSocket::close );
+
+	m_receiver = new VncMulticastReceiver( m_groupAddress, m_port, m_key, this );
+
+	if( m_receiver->isJoined() == false )
+	{
+		// multicast is not available at all so just relay the TCP connection
+		m_mode = PassthroughMode;
+	}
+
+	connect( m_receiver, &VncMulticastReceiver::messagesAvailable, this, &VncMulticastRelay::forwardMulticastMessages );
+	connect( m_receiver, &VncMulticastReceiver::synchronizationLost, this, &VncMulticastRelay::handleSynchronizationLoss );
+
+	// process data which arrived before we took over the connection
+	readFromServer();
+	readFromClient();
+}
+
+
+
+void VncMulticastRelay::readFromServer()
+{
+	while( m_serverProtocol.receiveMessage() )
+	{
+		// updates are received via multicast only after switching
+		if( m_mode != MulticastMode || m_serverProtocol.lastMessageType() != rfbFramebufferUpdate )
+		{
+			m_clientSocket->write( m_serverProtocol.lastMessage() );
+		}
+	}
+}
+
+
+
+void VncMulticastRelay::readFromClient()
+{
+	if( m_mode == PassthroughMode )
+	{
+		m_serverSocket->write( m_clientSocket->readAll() );
+		return;
+	}
+
+	while( receiveClientMessage() )
+	{
+	}
+}
+
+
+
+void VncMulticastRelay::forwardMulticastMessages()
+{
+	QByteArray message;
+
+	if( m_mode == PassthroughMode )
+	{
+		while( m_receiver->takeMessage( message ) )
+		{
+		}
+		return;
+	}
+
+	if( m_mode == TcpMode )
+	{
+		// the receiver always starts with a key frame and the client has not received
+		// any partial message from the server connection so we can switch right now
+		qDebug() << Q_FUNC_INFO << "switching to multicast updates";
+		m_mode = MulticastMode;
+	}
+
+	while( m_receiver->takeMessage( message ) )
+	{
+		m_clientSocket->write( message );
+	}
+}
+
+
+
+void VncMulticastRelay::handleSynchronizationLoss()
+{
+	if( m_mode == MulticastMode )
+	{
+		// client has already applied updates which are missing on the server connection
+		qWarning() << Q_FUNC_INFO << "lost multicast updates";
+		emit failed();
+	}
+}
+
+
+
+bool VncMulticastRelay::receiveClientMessage()
+{
+	char messageType = 0;
+	if( m_clientSocket->peek( &messageType, sizeof(messageType) ) != sizeof(messageType) )
+	{
+		return false;
+	}
+
+	switch( messageType )
+	{
+	case rfbSetEncodings:
+		if( m_clientSocket->bytesAvailable() >= sz_rfbSetEncodingsMsg )
+		{
+			rfbSetEncodingsMsg setEncodingsMessage;
+			if( m_clientSocket->peek( reinterpret_cast<char *>( &setEncodingsMessage ), sz_rfbSetEncodingsMsg ) == sz_rfbSetEncodingsMsg )
+			{
+				return forwardClientMessage( sz_rfbSetEncodingsMsg +
+											 qFromBigEndian( setEncodingsMessage.nEncodings ) * sizeof(uint32_t) );
+			}
+		}
+		break;
+
+	case rfbClientCutText:
+		if( m_clientSocket->bytesAvailable() >= sz_rfbClientCutTextMsg )
+		{
+			rfbClientCutTextMsg cutTextMessage;
+			if( m_clientSocket->peek( reinterpret_cast<char *>( &cutTextMessage ), sz_rfbClientCutTextMsg ) == sz_rfbClientCutTextMsg )
+			{
+				return forwardClientMessage( sz_rfbClientCutTextMsg + qFromBigEndian( cutTextMessage.length ) );
+			}
+		}
+		break;
+
+	default:
+		if( m_rfbClientToServerMessageSizes.contains( messageType ) )
+		{
+			if( m_mode == MulticastMode && messageType == rfbFramebufferUpdateRequest )
+			{
+				// server must not send updates we'd discard anyway
+				return m_clientSocket->bytesAvailable() >= sz_rfbFramebufferUpdateRequestMsg &&
+						m_clientSocket->read( sz_rfbFramebufferUpdateRequestMsg ).size() == sz_rfbFramebufferUpdateRequestMsg;
+			}
+
+			return forwardClientMessage( m_rfbClientToServerMessageSizes[messageType] );
+		}
+
+		if( m_mode == MulticastMode )
+		{
+			qWarning() << Q_FUNC_INFO << "received unknown message type in multicast mode:" << static_cast<int>( messageType );
+			emit failed();
+			return false;
+		}
+
+		// we can't keep track of message boundaries any longer so stick with TCP
+		qWarning() << Q_FUNC_INFO << "received unknown message type - disabling multicast:" << static_cast<int>( messageType );
+		m_mode = PassthroughMode;
+		m_serverSocket->write( m_clientSocket->readAll() );
+		break;
+	}
+
+	return false;
+}
+
+
+
+bool VncMulticastRelay::forwardClientMessage( qint64 size )
+{
+	if( m_clientSocket->bytesAvailable() < size )
+	{
+		return false;
+	}
+
+	const auto message = m_clientSocket->read( size );
+
+	return message.size() == size && m_serverSocket->write( message ) == size;
+}
@@ -26,6 +26,7 @@
 #include <QTcpSocket>
 
 #include "AuthenticationCredentials.h"
+#include "FeatureMessage.h"
 #include "VariantArrayMessage.h"
 #include "VncServerClient.h"
 #include "VncServerProtocol.h"
@@ -197,6 +198,9 @@ bool VncServerProtocol::sendAuthenticationTypes()
 		message.write( authType );
 	}
 
+	// announce latest supported feature message format - ignored by older clients
+	message.write( FeatureMessage::LatestFormat );
+
 	return message.send();
 }
 
@@ -223,6 +227,18 @@ bool VncServerProtocol::receiveAuthenticationTypeResponse()
 			return false;
 		}
 
+		const QString username = message.read().toString();
+
+		// older clients do not send the chosen feature message format
+		auto featureMessageFormat = FeatureMessage::LegacyFormat;
+		if( message.atEnd() == false )
+		{
+			featureMessageFormat = static_cast<FeatureMessage::Format>(
+						qBound<int>( FeatureMessage::LegacyFormat, message.read().toInt(), FeatureMessage::LatestFormat ) );
+		}
+
+		FeatureMessage::setFormat( m_socket, featureMessageFormat );
+
 		if( chosenAuthType == RfbVeyonAuth::None )
 		{
 			qWarning( "VncServerProtocol::receiveAuthenticationTypeResponse(): skipping authentication." );
@@ -230,8 +246,6 @@ bool VncServerProtocol::receiveAuthenticationTypeResponse()
 			return true;
 		}
 
-		const QString username = message.read().toString();
-
 		m_client->setAuthType( chosenAuthType );
 		m_client->setUsername( username );
 		m_client->setHostAddress( m_socket->peerAddress().toString() );
@@ -253,6 +267,21 @@ bool VncServerProtocol::receiveAuthenticationTypeResponse()
 
 bool VncServerProtocol::receiveAuthenticationMessage()
 {
+	switch( m_client->authState() )
+	{
+	case VncServerClient::AuthPending:
+		// authentication is still being performed asynchronously
+		return false;
+
+	case VncServerClient::AuthFinishedSuccess:
+	case VncServerClient::AuthFinishedFail:
+		// asynchronous authentication finished in the meantime
+		return processAuthenticationResult();
+
+	default:
+		break;
+	}
+
 	VariantArrayMessage message( m_socket );
 
 	if( message.isReadyForReceive() && message.receive() )
@@ -269,6 +298,13 @@ bool VncServerProtocol::processAuthentication( VariantArrayMessage& message )
 {
 	processAuthenticationMessage( message );
 
+	return processAuthenticationResult();
+}
+
+
+
+bool VncServerProtocol::processAuthenticationResult()
+{
 	switch( m_client->authState() )
 	{
 	case VncServerClient::AuthFinishedSuccess:
@@ -26,6 +26,7 @@
 #include "rfb/keysym.h"
 
 #include "VncView.h"
+#include "ImageScaler.h"
 #include "PlatformInputDeviceFunctions.h"
 #include "KeyboardShortcutTrapper.h"
 #include "ProgressWidget.h"
@@ -34,17 +35,18 @@
 #include <QDesktopWidget>
 #include <QMouseEvent>
 #include <QPainter>
-#include <QtMath>
 
 
 VncView::VncView( const QString &host, int port, QWidget *parent, Mode mode ) :
 	QWidget( parent ),
-	m_vncConn( new VeyonVncConnection( QCoreApplication::instance() ) ),
+	m_vncConn( new VeyonVncConnection ),
 	m_mode( mode ),
 	m_cursorShape(),
 	m_cursorX( 0 ),
 	m_cursorY( 0 ),
 	m_framebufferSize( 0, 0 ),
+	m_damagedRegion(),
+	m_scaledFramebuffer(),
 	m_cursorHotX( 0 ),
 	m_cursorHotY( 0 ),
 	m_viewOnly( true ),
@@ -73,6 +75,7 @@ VncView::VncView( const QString &host, int port, QWidget *parent, Mode mode ) :
 	}
 
 	connect( m_vncConn, &VeyonVncConnection::imageUpdated, this, &VncView::updateImage );
+	connect( m_vncConn, &VeyonVncConnection::framebufferUpdateComplete, this, &VncView::finishFramebufferUpdate );
 	connect( m_vncConn, &VeyonVncConnection::framebufferSizeChanged, this, &VncView::updateFramebufferSize );
 
 	connect( m_vncConn, &VeyonVncConnection::cursorPosChanged, this, &VncView::updateCursorPos );
@@ -590,6 +593,45 @@ QRect VncView::mapFromFramebuffer( QRect r )
 
 
 
+QRegion VncView::rescaleFramebuffer( const QRegion& region )
+{
+	const auto image = m_vncConn->image();
+	const auto size = scaledSize();
+
+	if( image.isNull() || size.isEmpty() )
+	{
+		return QRegion();
+	}
+
+	QRegion scaledRegion;
+
+	if( m_scaledFramebuffer.size() != size )
+	{
+		m_scaledFramebuffer = QImage( size, QImage::Format_RGB32 );
+		scaledRegion = m_scaledFramebuffer.rect();
+	}
+	else if( region.rectCount() > MaximumDamagedRects )
+	{
+		scaledRegion = ImageScaler::mapToDestination( region.boundingRect(), image.size(), size );
+	}
+	else
+	{
+		for( const auto& rect : regionRects( region ) )
+		{
+			scaledRegion += ImageScaler::mapToDestination( rect, image.size(), size );
+		}
+	}
+
+	for( const auto& rect : regionRects( scaledRegion ) )
+	{
+		ImageScaler::scale( image, m_scaledFramebuffer, rect );
+	}
+
+	return scaledRegion;
+}
+
+
+
 void VncView::updateLocalCursor()
 {
 	if( isViewOnly()  )
@@ -652,7 +694,6 @@ bool VncView::event( QEvent * event )
 void VncView::paintEvent( QPaintEvent *paintEvent )
 {
 	QPainter p( this );
-	p.setRenderHint( QPainter::SmoothPixmapTransform );
 
 	const auto& image = m_vncConn->image();
 
@@ -664,12 +705,20 @@ void VncView::paintEvent( QPaintEvent *paintEvent )
 
 	if( isScaledView() )
 	{
-		// repaint everything in scaled mode to avoid artifacts at rectangle boundaries
-		p.drawImage( QRect( QPoint( 0, 0 ), scaledSize() ), image );
+		// scaled backing store not yet initialized or outdated after resize?
+		if( m_scaledFramebuffer.size() != scaledSize() )
+		{
+			rescaleFramebuffer( image.rect() );
+		}
+
+		// only copy pixels of updated region from scaled backing store
+		const auto rect = paintEvent->rect().intersected( m_scaledFramebuffer.rect() );
+		p.drawImage( rect.topLeft(), m_scaledFramebuffer, rect );
 	}
 	else
 	{
-		p.drawImage( 0, 0, image );
+		const auto rect = paintEvent->rect().intersected( image.rect() );
+		p.drawImage( rect.topLeft(), image, rect );
 	}
 
 	if( isViewOnly() && !m_cursorShape.isNull() )
@@ -795,10 +844,31 @@ void VncView::updateImage( int x, int y, int w, int h )
 
 	}
 
-	const auto scale = scaleFactor();
+	// collect all updated rects and repaint once the whole update has been received
+	m_damagedRegion += QRect( x, y, w, h );
+}
+
+
+
+void VncView::finishFramebufferUpdate()
+{
+	if( m_damagedRegion.isEmpty() )
+	{
+		return;
+	}
+
+	if( isScaledView() )
+	{
+		update( rescaleFramebuffer( m_damagedRegion ) );
+	}
+	else
+	{
+		m_scaledFramebuffer = QImage();
+
+		update( m_damagedRegion );
+	}
 
-	update( qMax( 0, qFloor( x*scale - 1 ) ), qMax( 0, qFloor( y*scale - 1 ) ),
-			qCeil( w*scale + 2 ), qCeil( h*scale + 2 ) );
+	m_damagedRegion = QRegion();
 }
 
 
@@ -806,6 +876,7 @@ void VncView::updateImage( int x, int y, int w, int h )
 void VncView::updateFramebufferSize( int w, int h )
 {
 	m_framebufferSize = QSize( w, h );
+	m_scaledFramebuffer = QImage();
 
 	resize( w, h );
 
@@ -240,6 +240,9 @@ void ComputerControlListModel::startComputerControlInterface( ComputerControlInt
 	connect( controlInterface.data(), &ComputerControlInterface::activeFeaturesChanged,
 			 this, [=] () { emit activeFeaturesChanged( index ); } );
 
+	connect( controlInterface.data(), &ComputerControlInterface::undeliveredFeatureChanged,
+			 this, [=] () { emit dataChanged( index, index, QVector<int>( { Qt::ToolTipRole } ) ); } );
+
 	// pass weak pointer to lambda function as otherwise the original shared pointer
 	// gets referenced once more all the time and thus the object never gets deleted
 	auto controlInterfaceWeakRef = controlInterface->weakPointer();
@@ -317,12 +320,45 @@ QString ComputerControlListModel::computerToolTipRole( ComputerControlInterface:
 	const QString user( loggedOnUserInformation( controlInterface ) );
 	const QString features( tr( "Active features: %1" ).arg( activeFeatures( controlInterface ) ) );
 
-	if( user.isEmpty() )
+	auto toolTip = QStringLiteral( "<b>%1</b><br>%2<br>%3<br>%4" ).arg( state, room, host, features );
+
+	if( user.isEmpty() == false )
+	{
+		toolTip += QStringLiteral( "<br>%1" ).arg( user );
+	}
+
+	const auto undeliveredFeature = controlInterface->undeliveredFeature();
+	if( undeliveredFeature.isNull() == false )
+	{
+		toolTip += QStringLiteral( "<br>%1" ).arg( tr( "Feature not confirmed by computer: %1" ).
+												  arg( m_master->featureManager().feature( undeliveredFeature ).displayName() ) );
+	}
+
+	if( controlInterface->state() == ComputerControlInterface::Connected )
+	{
+		toolTip += QStringLiteral( "<br>%1" ).arg( connectionStatistics( controlInterface ) );
+	}
+
+	return toolTip;
+}
+
+
+
+QString ComputerControlListModel::connectionStatistics( ComputerControlInterface::Pointer controlInterface )
+{
+	const auto statistics = controlInterface->connectionStatistics();
+
+	QString roundTripTime = tr( "unknown" );
+	if( statistics.roundTripTime >= 0 )
 	{
-		return QStringLiteral( "<b>%1</b><br>%2<br>%3<br>%4" ).arg( state, room, host, features );
+		roundTripTime = tr( "%1 ms" ).arg( statistics.roundTripTime );
 	}
 
-	return QStringLiteral( "<b>%1</b><br>%2<br>%3<br>%4<br>%5" ).arg( state, room, host, features, user);
+	return tr( "Screen updates: %1 kB/s, %2 updates/s, latency %3, update interval %4 ms" ).
+			arg( statistics.bytesPerSecond / 1024 ).
+			arg( statistics.updatesPerSecond, 0, 'f', 1 ).
+			arg( roundTripTime ).
+			arg( statistics.updateInterval );
 }
 
 
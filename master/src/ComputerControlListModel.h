@@ -92,6 +92,7 @@ private:
 	QString computerDisplayRole( ComputerControlInterface::Pointer controlInterface ) const;
 	static QString computerStateDescription( ComputerControlInterface::Pointer controlInterface );
 	static QString loggedOnUserInformation( ComputerControlInterface::Pointer controlInterface );
+	static QString connectionStatistics( ComputerControlInterface::Pointer controlInterface );
 	QString activeFeatures(  ComputerControlInterface::Pointer controlInterface ) const;
 
 	VeyonMaster* m_master;
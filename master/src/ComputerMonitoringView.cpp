@@ -25,7 +25,6 @@
 #include <QMenu>
 #include <QScrollBar>
 #include <QShowEvent>
-#include <QTimer>
 
 #include "ComputerControlListModel.h"
 #include "ComputerManager.h"
@@ -42,7 +41,8 @@ ComputerMonitoringView::ComputerMonitoringView( QWidget *parent ) :
 	ui(new Ui::ComputerMonitoringView),
 	m_master( nullptr ),
 	m_featureMenu( new QMenu( this ) ),
-	m_sortFilterProxyModel( this )
+	m_sortFilterProxyModel( this ),
+	m_screenVisibilityUpdateTimer( this )
 {
 	ui->setupUi( this );
 
@@ -55,6 +55,25 @@ ComputerMonitoringView::ComputerMonitoringView( QWidget *parent ) :
 
 	connect( ui->listView, &QListView::customContextMenuRequested,
 			 this, &ComputerMonitoringView::showContextMenu );
+
+	// collect visibility changes and update all computers at once afterwards
+	m_screenVisibilityUpdateTimer.setSingleShot( true );
+	m_screenVisibilityUpdateTimer.setInterval( ScreenVisibilityUpdateDelay );
+
+	connect( &m_screenVisibilityUpdateTimer, &QTimer::timeout,
+			 this, &ComputerMonitoringView::updateComputerScreenVisibility );
+
+	const auto scheduleVisibilityUpdate = [this]() { m_screenVisibilityUpdateTimer.start(); };
+
+	connect( ui->listView->verticalScrollBar(), &QScrollBar::valueChanged, this, scheduleVisibilityUpdate );
+	connect( ui->listView->horizontalScrollBar(), &QScrollBar::valueChanged, this, scheduleVisibilityUpdate );
+
+	connect( &m_sortFilterProxyModel, &QSortFilterProxyModel::rowsInserted, this, scheduleVisibilityUpdate );
+	connect( &m_sortFilterProxyModel, &QSortFilterProxyModel::rowsRemoved, this, scheduleVisibilityUpdate );
+	connect( &m_sortFilterProxyModel, &QSortFilterProxyModel::layoutChanged, this, scheduleVisibilityUpdate );
+	connect( &m_sortFilterProxyModel, &QSortFilterProxyModel::modelReset, this, scheduleVisibilityUpdate );
+
+	ui->listView->viewport()->installEventFilter( this );
 }
 
 
@@ -96,6 +115,11 @@ void ComputerMonitoringView::setVeyonMaster( VeyonMaster& masterCore )
 	// load custom positions
 	ui->listView->loadPositions( m_master->userConfig().computerPositions() );
 	ui->listView->setFlexible( m_master->userConfig().useCustomComputerPositions() );
+
+	// track minimizing/restoring of main window
+	window()->installEventFilter( this );
+
+	m_screenVisibilityUpdateTimer.start();
 }
 
 
@@ -157,6 +181,8 @@ void ComputerMonitoringView::setComputerScreenSize( int size )
 		m_master->computerControlListModel().updateComputerScreenSize();
 
 		ui->listView->setIconSize( QSize( size, size * 9 / 16 ) );
+
+		m_screenVisibilityUpdateTimer.start();
 	}
 }
 
@@ -200,6 +226,8 @@ void ComputerMonitoringView::autoAdjustComputerScreenSize()
 void ComputerMonitoringView::setUseCustomComputerPositions( bool enabled )
 {
 	ui->listView->setFlexible( enabled );
+
+	m_screenVisibilityUpdateTimer.start();
 }
 
 
@@ -207,6 +235,8 @@ void ComputerMonitoringView::setUseCustomComputerPositions( bool enabled )
 void ComputerMonitoringView::alignComputers()
 {
 	ui->listView->alignToGrid();
+
+	m_screenVisibilityUpdateTimer.start();
 }
 
 
@@ -247,6 +277,47 @@ void ComputerMonitoringView::runFeature( const Feature& feature )
 
 
 
+void ComputerMonitoringView::updateComputerScreenVisibility()
+{
+	if( m_master == nullptr )
+	{
+		return;
+	}
+
+	const auto& computerControlListModel = m_master->computerControlListModel();
+	const auto& computerControlInterfaces = computerControlListModel.computerControlInterfaces();
+
+	const bool viewVisible = isVisible() && window()->isMinimized() == false;
+	const auto viewportRect = ui->listView->viewport()->rect();
+
+	for( int row = 0; row < computerControlInterfaces.size(); ++row )
+	{
+		bool visible = false;
+
+		if( viewVisible )
+		{
+			const auto index = m_sortFilterProxyModel.mapFromSource( computerControlListModel.index( row ) );
+			visible = index.isValid() && ui->listView->visualRect( index ).intersects( viewportRect );
+		}
+
+		computerControlInterfaces[row]->setScreenVisible( visible );
+	}
+}
+
+
+
+bool ComputerMonitoringView::eventFilter( QObject* object, QEvent* event )
+{
+	if( ( object == window() && event->type() == QEvent::WindowStateChange ) ||
+			( object == ui->listView->viewport() && event->type() == QEvent::Resize ) )
+	{
+		m_screenVisibilityUpdateTimer.start();
+	}
+
+	return QWidget::eventFilter( object, event );
+}
+
+
 
 void ComputerMonitoringView::showEvent( QShowEvent* event )
 {
@@ -257,6 +328,17 @@ void ComputerMonitoringView::showEvent( QShowEvent* event )
 	}
 
 	QWidget::showEvent( event );
+
+	m_screenVisibilityUpdateTimer.start();
+}
+
+
+
+void ComputerMonitoringView::hideEvent( QHideEvent* event )
+{
+	QWidget::hideEvent( event );
+
+	m_screenVisibilityUpdateTimer.start();
 }
 
 
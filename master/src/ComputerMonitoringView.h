@@ -28,6 +28,7 @@
 #include "ComputerControlInterface.h"
 
 #include <QSortFilterProxyModel>
+#include <QTimer>
 #include <QWidget>
 
 class QMenu;
@@ -45,7 +46,8 @@ public:
 	enum {
 		MinimumComputerScreenSize = 50,
 		MaximumComputerScreenSize = 1000,
-		DefaultComputerScreenSize = 150
+		DefaultComputerScreenSize = 150,
+		ScreenVisibilityUpdateDelay = 100
 	};
 
 	ComputerMonitoringView( QWidget *parent = nullptr );
@@ -66,9 +68,12 @@ private slots:
 	void runDoubleClickFeature( const QModelIndex& index );
 	void showContextMenu( QPoint pos );
 	void runFeature( const Feature& feature );
+	void updateComputerScreenVisibility();
 
 private:
+	bool eventFilter( QObject* object, QEvent* event ) override;
 	void showEvent( QShowEvent* event ) override;
+	void hideEvent( QHideEvent* event ) override;
 	void wheelEvent( QWheelEvent* event ) override;
 
 	FeatureUidList activeFeatures( const ComputerControlInterfaceList& computerControlInterfaces );
@@ -82,6 +87,7 @@ private:
 	VeyonMaster* m_master;
 	QMenu* m_featureMenu;
 	QSortFilterProxyModel m_sortFilterProxyModel;
+	QTimer m_screenVisibilityUpdateTimer;
 
 signals:
 	void computerScreenSizeAdjusted( int size );
@@ -26,9 +26,11 @@
 #include <QDesktopWidget>
 #include <QIcon>
 #include <QLayout>
+#include <QtEndian>
 
 #include "DemoClient.h"
 #include "VeyonConfiguration.h"
+#include "VeyonRfbExt.h"
 #include "LockWidget.h"
 #include "PlatformCoreFunctions.h"
 #include "VncView.h"
@@ -93,6 +95,25 @@ DemoClient::~DemoClient()
 
 
 
+void DemoClient::setMulticastGroup( const QHostAddress& groupAddress, int port, const QByteArray& key )
+{
+	// connection falls back to TCP updates if multicast is not available
+	m_vncView->vncConnection()->setMulticastGroup( groupAddress, port, key );
+}
+
+
+
+void DemoClient::enableScreenSizeReports()
+{
+	// report screen size to each new connection as the server falls back to its default rendition
+	connect( m_vncView->vncConnection(), &VeyonVncConnection::stateChanged,
+			 this, &DemoClient::reportScreenSize );
+
+	reportScreenSize();
+}
+
+
+
 void DemoClient::viewDestroyed( QObject* obj )
 {
 	// prevent double deletion of toplevel widget
@@ -117,3 +138,27 @@ void DemoClient::resizeToplevelWidget()
 		m_toplevel->resize( m_vncView->sizeHint() );
 	}
 }
+
+
+
+void DemoClient::reportScreenSize()
+{
+	auto vncConnection = m_vncView->vncConnection();
+
+	if( m_toplevel == nullptr || vncConnection->state() != VeyonVncConnection::Connected )
+	{
+		return;
+	}
+
+	// framebuffer is scaled in physical pixels
+	const auto screenSize = QApplication::desktop()->screenGeometry( m_toplevel ).size() * m_toplevel->devicePixelRatio();
+
+	rfbVeyonScreenSizeMsg screenSizeMessage;
+	screenSizeMessage.type = rfbVeyonScreenSizeMessage;
+	screenSizeMessage.pad = 0;
+	screenSizeMessage.width = qToBigEndian<uint16_t>( static_cast<uint16_t>( screenSize.width() ) );
+	screenSizeMessage.height = qToBigEndian<uint16_t>( static_cast<uint16_t>( screenSize.height() ) );
+
+	vncConnection->enqueueEvent( VncClientEvent::rawMessageEvent(
+									 QByteArray( reinterpret_cast<const char *>( &screenSizeMessage ), sz_rfbVeyonScreenSizeMsg ) ) );
+}
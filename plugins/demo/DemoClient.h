@@ -27,6 +27,7 @@
 
 #include <QObject>
 
+class QHostAddress;
 class VncView;
 
 class DemoClient : public QObject
@@ -36,10 +37,16 @@ public:
 	DemoClient( const QString& host, bool fullscreen, QObject* parent = nullptr );
 	~DemoClient() override;
 
+	void setMulticastGroup( const QHostAddress& groupAddress, int port, const QByteArray& key );
+
+	// let the demo server send updates in a resolution matching the screen
+	void enableScreenSizeReports();
+
 
 private slots:
 	void viewDestroyed( QObject* obj );
 	void resizeToplevelWidget();
+	void reportScreenSize();
 
 
 private:
@@ -22,6 +22,8 @@
  *
  */
 
+#include <QHostAddress>
+
 #include "VeyonConfiguration.h"
 #include "DemoConfiguration.h"
 
@@ -44,6 +46,32 @@ DemoConfiguration::DemoConfiguration() :
 	{
 		setMemoryLimit( DefaultMemoryLimit );
 	}
+
+	if( imageQuality() <= 0 || imageQuality() > MaximumImageQuality )
+	{
+		setImageQuality( DefaultImageQuality );
+	}
+
+	if( isValidMulticastAddress( multicastAddress() ) == false )
+	{
+		setMulticastAddress( defaultMulticastAddress() );
+	}
+
+	if( multicastPort() <= 0 || multicastPort() > 65535 )
+	{
+		setMulticastPort( DefaultMulticastPort );
+	}
+}
+
+
+
+bool DemoConfiguration::isValidMulticastAddress( const QString& address )
+{
+	const QHostAddress hostAddress( address );
+
+	// receivers join IPv4 groups only (QHostAddress::isMulticast() requires Qt 5.6)
+	return hostAddress.protocol() == QAbstractSocket::IPv4Protocol &&
+			hostAddress.isInSubnet( QHostAddress( QStringLiteral( "224.0.0.0" ) ), 4 );
 }
 
 
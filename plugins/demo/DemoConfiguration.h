@@ -32,6 +32,11 @@
 	OP( DemoConfiguration, m_configuration, INT, framebufferUpdateInterval, setFramebufferUpdateInterval, "FramebufferUpdateInterval", "Demo" );	\
 	OP( DemoConfiguration, m_configuration, INT, keyFrameInterval, setKeyFrameInterval, "KeyFrameInterval", "Demo" );	\
 	OP( DemoConfiguration, m_configuration, INT, memoryLimit, setMemoryLimit, "MemoryLimit", "Demo" );	\
+	OP( DemoConfiguration, m_configuration, INT, imageQuality, setImageQuality, "ImageQuality", "Demo" );	\
+	OP( DemoConfiguration, m_configuration, BOOL, adaptiveQualityEnabled, setAdaptiveQualityEnabled, "AdaptiveQualityEnabled", "Demo" );	\
+	OP( DemoConfiguration, m_configuration, BOOL, multicastEnabled, setMulticastEnabled, "MulticastEnabled", "Demo" );	\
+	OP( DemoConfiguration, m_configuration, STRING, multicastAddress, setMulticastAddress, "MulticastAddress", "Demo" );	\
+	OP( DemoConfiguration, m_configuration, INT, multicastPort, setMulticastPort, "MulticastPort", "Demo" );	\
 
 // clazy:excludeall=ctor-missing-parent-argument
 
@@ -43,10 +48,21 @@ public:
 		DefaultFramebufferUpdateInterval = 100,	// in milliseconds
 		DefaultKeyFrameInterval = 10,			// in seconds
 		DefaultMemoryLimit = 128,				// in MB
+		DefaultImageQuality = 7,				// JPEG quality level of Tight encoding (1-9)
+		MaximumImageQuality = 9,
+		DefaultMulticastPort = 11450,
 	};
 
 	DemoConfiguration();
 
+	// organization-local scope so updates do not leave the site
+	static QString defaultMulticastAddress()
+	{
+		return QStringLiteral( "239.255.11.40" );
+	}
+
+	static bool isValidMulticastAddress( const QString& address );
+
 	FOREACH_DEMO_CONFIG_PROPERTY(DECLARE_CONFIG_PROPERTY)
 
 public slots:
@@ -54,6 +70,11 @@ public slots:
 	void setFramebufferUpdateInterval( int );
 	void setKeyFrameInterval( int );
 	void setMemoryLimit( int );
+	void setImageQuality( int );
+	void setAdaptiveQualityEnabled( bool );
+	void setMulticastEnabled( bool );
+	void setMulticastAddress( const QString& );
+	void setMulticastPort( int );
 
 } ;
 
@@ -34,9 +34,6 @@ DemoConfigurationPage::DemoConfigurationPage( DemoConfiguration& configuration,
 	m_configuration( configuration )
 {
 	ui->setupUi(this);
-
-	// MT not supported yet
-	ui->multithreadingEnabled->setVisible( false );
 }
 
 
@@ -66,6 +63,22 @@ void DemoConfigurationPage::resetWidgets()
 		m_configuration.setMemoryLimit( DemoConfiguration::DefaultMemoryLimit );
 	}
 
+	if( m_configuration.imageQuality() < ui->imageQuality->minimum() ||
+			m_configuration.imageQuality() > ui->imageQuality->maximum() )
+	{
+		m_configuration.setImageQuality( DemoConfiguration::DefaultImageQuality );
+	}
+
+	if( DemoConfiguration::isValidMulticastAddress( m_configuration.multicastAddress() ) == false )
+	{
+		m_configuration.setMulticastAddress( DemoConfiguration::defaultMulticastAddress() );
+	}
+
+	if( m_configuration.multicastPort() < ui->multicastPort->minimum() )
+	{
+		m_configuration.setMulticastPort( DemoConfiguration::DefaultMulticastPort );
+	}
+
 	FOREACH_DEMO_CONFIG_PROPERTY(INIT_WIDGET_FROM_PROPERTY);
 }
 
@@ -23,6 +23,7 @@
  */
 
 #include <QCoreApplication>
+#include <QHostAddress>
 
 #include "AuthenticationCredentials.h"
 #include "Computer.h"
@@ -94,8 +95,21 @@ bool DemoFeaturePlugin::startFeature( VeyonMasterInterface& master, const Featur
 
 		qDebug() << "DemoFeaturePlugin::startMasterFeature(): clients:" << m_demoClientHosts;
 
-		return sendFeatureMessage( FeatureMessage( feature.uid(), StartDemoClient ).addArgument( DemoAccessToken, m_demoAccessToken ),
-								   computerControlInterfaces );
+		FeatureMessage startDemoClientMessage( feature.uid(), StartDemoClient );
+		startDemoClientMessage.addArgument( DemoAccessToken, m_demoAccessToken );
+
+		if( m_configuration.multicastEnabled() )
+		{
+			startDemoClientMessage.addArgument( MulticastAddress, m_configuration.multicastAddress() );
+			startDemoClientMessage.addArgument( MulticastPort, m_configuration.multicastPort() );
+		}
+
+		if( m_configuration.adaptiveQualityEnabled() )
+		{
+			startDemoClientMessage.addArgument( AdaptiveQuality, true );
+		}
+
+		return sendFeatureMessage( startDemoClientMessage, computerControlInterfaces );
 	}
 
 	return false;
@@ -204,6 +218,15 @@ bool DemoFeaturePlugin::handleFeatureMessage( VeyonServerInterface& server, cons
 			FeatureMessage startDemoClientMessage( message.featureUid(), message.command() );
 			startDemoClientMessage.addArgument( DemoAccessToken, message.argument( DemoAccessToken ) );
 			startDemoClientMessage.addArgument( DemoServerHost, socket->peerAddress().toString() );
+			if( message.hasArgument( MulticastAddress ) )
+			{
+				startDemoClientMessage.addArgument( MulticastAddress, message.argument( MulticastAddress ) );
+				startDemoClientMessage.addArgument( MulticastPort, message.argument( MulticastPort ) );
+			}
+			if( message.hasArgument( AdaptiveQuality ) )
+			{
+				startDemoClientMessage.addArgument( AdaptiveQuality, message.argument( AdaptiveQuality ) );
+			}
 			server.featureWorkerManager().sendMessage( startDemoClientMessage );
 		}
 		else
@@ -263,6 +286,18 @@ bool DemoFeaturePlugin::handleFeatureMessage( VeyonWorkerInterface& worker, cons
 
 				qDebug() << "DemoClient: connecting with master" << demoServerHost;
 				m_demoClient = new DemoClient( demoServerHost, isFullscreenDemo );
+
+				if( message.hasArgument( MulticastAddress ) )
+				{
+					m_demoClient->setMulticastGroup( QHostAddress( message.argument( MulticastAddress ).toString() ),
+													 message.argument( MulticastPort ).toInt(),
+													 message.argument( DemoAccessToken ).toString().toUtf8() );
+				}
+				else if( message.argument( AdaptiveQuality ).toBool() )
+				{
+					// multicast updates are the same for all clients so only report screen size otherwise
+					m_demoClient->enableScreenSizeReports();
+				}
 			}
 			return true;
 
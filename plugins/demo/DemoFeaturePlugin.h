@@ -104,6 +104,9 @@ private:
 		VncServerPort,
 		VncServerPassword,
 		DemoServerHost,
+		MulticastAddress,
+		MulticastPort,
+		AdaptiveQuality,
 	};
 
 	const Feature m_fullscreenDemoFeature;
@@ -0,0 +1,336 @@
+/*
+ * DemoFramebufferUpdateLog.cpp - implementation of DemoFramebufferUpdateLog class
+ *
+ * Copyright (c) 2018 Tobias Junghans <tobydox@veyon.io>
+ *
+ * This file is part of Veyon - http://veyon.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include <QDebug>
+#include <QMutexLocker>
+
+#include "DemoFramebufferUpdateLog.h"
+
+
+DemoFramebufferUpdateLog::DemoFramebufferUpdateLog( qint64 capacity ) :
+	m_capacity( capacity ),
+	m_segmentSize( qMax<qint64>( 1, capacity / SegmentCount ) ),
+	m_mutex(),
+	m_segments( SegmentCount ),
+	m_firstSegment( 0 ),
+	m_usedSegments( 0 ),
+	m_nextSequence( 0 ),
+	m_keyFrameSequence( -1 ),
+	m_size( 0 ),
+	m_sizeSinceKeyFrame( 0 ),
+	m_keyFrameSize( 0 ),
+	m_skippableMessages()
+{
+	for( auto& segment : m_segments )
+	{
+		segment.firstSequence = 0;
+		segment.messages.reserve( InitialSegmentCapacity );
+		segment.regions.reserve( InitialSegmentCapacity );
+		segment.size = 0;
+	}
+}
+
+
+
+void DemoFramebufferUpdateLog::append( const QByteArray& message, const QRegion& updatedRegion, Flags flags )
+{
+	const bool isKeyFrame = flags.testFlag( KeyFrame );
+
+	// readers only hold the lock while copying message handles
+	QMutexLocker locker( &m_mutex );
+
+	while( m_usedSegments > 0 && m_size + message.size() > m_capacity )
+	{
+		dropFirstSegment();
+	}
+
+	if( message.size() > m_capacity )
+	{
+		qWarning() << Q_FUNC_INFO << "dropping message exceeding capacity:" << message.size();
+
+		// drop all remaining messages as well so readers do not continue behind the gap
+		// but start over with the next key frame
+		while( m_usedSegments > 0 )
+		{
+			dropFirstSegment();
+		}
+
+		m_skippableMessages.clear();
+		++m_nextSequence;
+		return;
+	}
+
+	if( isKeyFrame )
+	{
+		// previous messages are superseded by the key frame anyway
+		m_skippableMessages.clear();
+	}
+	else
+	{
+		skipMessagesUpdatedBy( updatedRegion );
+	}
+
+	if( m_usedSegments == 0 || isKeyFrame || lastSegment().size + message.size() > m_segmentSize )
+	{
+		startSegment();
+	}
+
+	auto& segment = lastSegment();
+	segment.messages.append( message );
+	segment.regions.append( updatedRegion );
+	segment.size += message.size();
+
+	if( isKeyFrame )
+	{
+		m_keyFrameSequence = m_nextSequence;
+		m_sizeSinceKeyFrame = 0;
+		m_keyFrameSize = message.size();
+	}
+
+	m_size += message.size();
+	m_sizeSinceKeyFrame += message.size();
+
+	if( flags.testFlag( Skippable ) && updatedRegion.isEmpty() == false )
+	{
+		if( m_skippableMessages.size() >= MaximumSkippableMessages )
+		{
+			// keep oldest message as it's unlikely to be updated completely any longer
+			m_skippableMessages.removeFirst();
+		}
+
+		m_skippableMessages.append( { m_nextSequence, updatedRegion } );
+	}
+
+	++m_nextSequence;
+}
+
+
+
+DemoFramebufferUpdateLog::Sequence DemoFramebufferUpdateLog::nextSequence() const
+{
+	QMutexLocker locker( &m_mutex );
+
+	return m_nextSequence;
+}
+
+
+
+qint64 DemoFramebufferUpdateLog::keyFrameSize() const
+{
+	QMutexLocker locker( &m_mutex );
+
+	return m_keyFrameSequence >= 0 ? m_keyFrameSize : 0;
+}
+
+
+
+qint64 DemoFramebufferUpdateLog::sizeSince( Sequence sequence ) const
+{
+	QMutexLocker locker( &m_mutex );
+
+	if( sequence < firstSequence() )
+	{
+		return -1;
+	}
+
+	qint64 size = 0;
+
+	for( int i = 0; i < m_usedSegments; ++i )
+	{
+		const auto& segment = m_segments[( m_firstSegment + i ) % SegmentCount];
+
+		for( int j = qMax<int>( 0, static_cast<int>( sequence - segment.firstSequence ) ); j < segment.messages.count(); ++j )
+		{
+			size += segment.messages[j].size();
+		}
+	}
+
+	return size;
+}
+
+
+
+bool DemoFramebufferUpdateLog::updatedRegion( Sequence sequence, QRegion& region ) const
+{
+	QMutexLocker locker( &m_mutex );
+
+	if( sequence < firstSequence() )
+	{
+		return false;
+	}
+
+	for( int i = 0; i < m_usedSegments; ++i )
+	{
+		const auto& segment = m_segments[( m_firstSegment + i ) % SegmentCount];
+
+		for( int j = qMax<int>( 0, static_cast<int>( sequence - segment.firstSequence ) ); j < segment.messages.count(); ++j )
+		{
+			// messages without updated region (i.e. framebuffer size messages) are never released
+			if( segment.regions[j].isEmpty() && segment.messages[j].isEmpty() == false )
+			{
+				return false;
+			}
+
+			region += segment.regions[j];
+		}
+	}
+
+	return true;
+}
+
+
+
+bool DemoFramebufferUpdateLog::read( Sequence& sequence, MessageList& messages, qint64 maxSize ) const
+{
+	QMutexLocker locker( &m_mutex );
+
+	if( sequence < m_keyFrameSequence )
+	{
+		// skip all messages superseded by the latest key frame
+		sequence = m_keyFrameSequence;
+	}
+	else if( sequence < firstSequence() )
+	{
+		// next message has been dropped and there's no key frame to start over with yet
+		sequence = -1;
+		return false;
+	}
+
+	qint64 size = 0;
+
+	for( int i = 0; i < m_usedSegments && size < maxSize; ++i )
+	{
+		const auto& segment = m_segments[( m_firstSegment + i ) % SegmentCount];
+		const auto endSequence = segment.firstSequence + segment.messages.count();
+
+		while( sequence >= segment.firstSequence && sequence < endSequence && size < maxSize )
+		{
+			const auto& message = segment.messages[static_cast<int>( sequence - segment.firstSequence )];
+
+			// skip released messages
+			if( message.isEmpty() == false )
+			{
+				messages.append( message );
+				size += message.size();
+			}
+
+			++sequence;
+		}
+	}
+
+	return sequence < m_nextSequence;
+}
+
+
+
+void DemoFramebufferUpdateLog::startSegment()
+{
+	if( m_usedSegments >= SegmentCount )
+	{
+		dropFirstSegment();
+	}
+
+	++m_usedSegments;
+
+	auto& segment = lastSegment();
+	segment.firstSequence = m_nextSequence;
+	segment.size = 0;
+}
+
+
+
+void DemoFramebufferUpdateLog::dropFirstSegment()
+{
+	auto& segment = m_segments[m_firstSegment];
+
+	if( m_keyFrameSequence >= 0 && m_keyFrameSequence < segment.firstSequence + segment.messages.count() )
+	{
+		m_keyFrameSequence = -1;
+	}
+
+	m_size -= segment.size;
+
+	// release messages but keep allocated lists for reuse
+	segment.messages.resize( 0 );
+	segment.regions.resize( 0 );
+	segment.size = 0;
+
+	m_firstSegment = ( m_firstSegment + 1 ) % SegmentCount;
+	--m_usedSegments;
+}
+
+
+
+void DemoFramebufferUpdateLog::skipMessagesUpdatedBy( const QRegion& updatedRegion )
+{
+	if( updatedRegion.isEmpty() )
+	{
+		return;
+	}
+
+	int remainingCount = 0;
+
+	for( int i = 0; i < m_skippableMessages.size(); ++i )
+	{
+		auto& skippableMessage = m_skippableMessages[i];
+
+		if( skippableMessage.region.intersects( updatedRegion ) )
+		{
+			skippableMessage.region -= updatedRegion;
+		}
+
+		if( skippableMessage.region.isEmpty() )
+		{
+			releaseMessage( skippableMessage.sequence );
+		}
+		else
+		{
+			m_skippableMessages[remainingCount++] = skippableMessage;
+		}
+	}
+
+	m_skippableMessages.resize( remainingCount );
+}
+
+
+
+void DemoFramebufferUpdateLog::releaseMessage( Sequence sequence )
+{
+	for( int i = 0; i < m_usedSegments; ++i )
+	{
+		auto& segment = m_segments[( m_firstSegment + i ) % SegmentCount];
+
+		if( sequence >= segment.firstSequence && sequence < segment.firstSequence + segment.messages.count() )
+		{
+			auto& message = segment.messages[static_cast<int>( sequence - segment.firstSequence )];
+
+			segment.size -= message.size();
+			m_size -= message.size();
+			m_sizeSinceKeyFrame -= message.size();
+
+			message = QByteArray();
+			return;
+		}
+	}
+}
@@ -0,0 +1,161 @@
+/*
+ * DemoFramebufferUpdateLog.h - header file for DemoFramebufferUpdateLog class
+ *
+ * Copyright (c) 2018 Tobias Junghans <tobydox@veyon.io>
+ *
+ * This file is part of Veyon - http://veyon.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef DEMO_FRAMEBUFFER_UPDATE_LOG_H
+#define DEMO_FRAMEBUFFER_UPDATE_LOG_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QRegion>
+#include <QVector>
+
+/** \brief Bounded log of framebuffer update messages written by the demo server and read by all connections
+ *
+ * Messages are numbered consecutively and stored in a fixed ring of segments. Each key frame starts a
+ * new segment. Whenever appending a message would exceed the capacity, the oldest segments are
+ * dropped, so the log never holds more than capacity bytes. Each reader keeps its own sequence number.
+ * New readers start with the latest key frame. Readers whose next message has been dropped wait for
+ * the next key frame.
+ *
+ * Skippable messages are released as soon as their whole region has been updated by subsequent
+ * messages. Readers never receive them. The updated region of each message is kept even after it has
+ * been released, so readers whose backlog exceeds the size of a key frame can query the region they
+ * are missing and have it re-encoded from the current framebuffer instead.
+ *
+ * append() and the size getters without arguments may only be called by the writer thread while all
+ * other functions may be called from any thread.
+ */
+class DemoFramebufferUpdateLog
+{
+public:
+	typedef qint64 Sequence;
+	typedef QVector<QByteArray> MessageList;
+
+	enum {
+		SegmentCount = 64,
+		InitialSegmentCapacity = 64,
+		MaximumSkippableMessages = 1024
+	};
+
+	enum Flag {
+		NoFlags = 0x00,
+		KeyFrame = 0x01,
+		Skippable = 0x02
+	} ;
+
+	Q_DECLARE_FLAGS(Flags, Flag)
+
+	explicit DemoFramebufferUpdateLog( qint64 capacity );
+
+	qint64 capacity() const
+	{
+		return m_capacity;
+	}
+
+	qint64 size() const
+	{
+		return m_size;
+	}
+
+	qint64 sizeSinceKeyFrame() const
+	{
+		return m_keyFrameSequence >= 0 ? m_sizeSinceKeyFrame : 0;
+	}
+
+	// key frame has been dropped or messages since key frame will cause it to be dropped soon
+	bool needsKeyFrame() const
+	{
+		return m_keyFrameSequence < 0 || m_sizeSinceKeyFrame > m_capacity / 2;
+	}
+
+	void append( const QByteArray& message, const QRegion& updatedRegion, Flags flags );
+
+	Sequence nextSequence() const;
+
+	// size of latest key frame or 0 if it has been dropped
+	qint64 keyFrameSize() const;
+
+	// size of all messages not yet released starting at given sequence or -1 if any has been dropped
+	qint64 sizeSince( Sequence sequence ) const;
+
+	// region updated by all messages starting at given sequence - returns false if any message has been
+	// dropped or resizes the framebuffer so that the reader needs the full framebuffer
+	bool updatedRegion( Sequence sequence, QRegion& region ) const;
+
+	// appends messages starting at given sequence to given list until it holds at least maxSize bytes
+	// and advances sequence - a sequence of -1 or one of a dropped message is set to the latest key
+	// frame or left at -1 if there is none - returns whether further messages are available
+	bool read( Sequence& sequence, MessageList& messages, qint64 maxSize ) const;
+
+private:
+	struct Segment {
+		Sequence firstSequence;
+		MessageList messages;
+		QVector<QRegion> regions;
+		qint64 size;
+	} ;
+
+	struct SkippableMessage {
+		Sequence sequence;
+		QRegion region;
+	} ;
+
+	Segment& lastSegment()
+	{
+		return m_segments[( m_firstSegment + m_usedSegments - 1 ) % SegmentCount];
+	}
+
+	Sequence firstSequence() const
+	{
+		return m_usedSegments > 0 ? m_segments[m_firstSegment].firstSequence : m_nextSequence;
+	}
+
+	void startSegment();
+	void dropFirstSegment();
+
+	void skipMessagesUpdatedBy( const QRegion& updatedRegion );
+	void releaseMessage( Sequence sequence );
+
+	const qint64 m_capacity;
+	const qint64 m_segmentSize;
+
+	mutable QMutex m_mutex;
+	QVector<Segment> m_segments;
+	int m_firstSegment;
+	int m_usedSegments;
+
+	Sequence m_nextSequence;
+	Sequence m_keyFrameSequence;
+
+	qint64 m_size;
+	qint64 m_sizeSinceKeyFrame;
+	qint64 m_keyFrameSize;
+
+	QVector<SkippableMessage> m_skippableMessages;
+
+} ;
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(DemoFramebufferUpdateLog::Flags)
+
+#endif
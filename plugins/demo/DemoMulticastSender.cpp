@@ -0,0 +1,282 @@
+/*
+ * DemoMulticastSender.cpp - implementation of DemoMulticastSender class
+ *
+ * Copyright (c) 2018 Tobias Junghans <tobydox@veyon.io>
+ *
+ * This file is part of Veyon - http://veyon.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include <QDebug>
+#include <QUdpSocket>
+#include <QUuid>
+
+#include "DemoMulticastSender.h"
+
+
+DemoMulticastSender::DemoMulticastSender( const QHostAddress& groupAddress, int port, const QByteArray& key,
+										  QObject* parent ) :
+	QObject( parent ),
+	m_socket( new QUdpSocket( this ) ),
+	m_groupAddress( groupAddress ),
+	m_port( static_cast<quint16>( port ) ),
+	m_key( key ),
+	// random so receivers notice when the demo server has been restarted
+	m_sessionId( QUuid::createUuid().data1 ),
+	m_heartbeatTimer( this ),
+	m_sendTimer( this ),
+	m_datagrams(),
+	m_retransmissionDatagrams(),
+	m_nextSequence( 0 ),
+	m_sentMessages(),
+	m_sentMessagesSize( 0 )
+{
+	connect( m_socket, &QUdpSocket::readyRead, this, &DemoMulticastSender::readNacks );
+	connect( &m_heartbeatTimer, &QTimer::timeout, this, &DemoMulticastSender::sendHeartbeat );
+	connect( &m_sendTimer, &QTimer::timeout, this, &DemoMulticastSender::sendDatagrams );
+
+	// receivers send NACKs to the address and port we're sending from
+	if( m_socket->bind( QHostAddress::AnyIPv4, 0 ) == false )
+	{
+		qCritical() << Q_FUNC_INFO << "could not bind multicast socket:" << m_socket->errorString();
+		return;
+	}
+
+	m_socket->setSocketOption( QAbstractSocket::MulticastTtlOption, MulticastTtl );
+	// let demo clients on this computer receive updates as well, e.g. for testing
+	m_socket->setSocketOption( QAbstractSocket::MulticastLoopbackOption, 1 );
+	m_socket->setSocketOption( QAbstractSocket::SendBufferSizeSocketOption, SendBufferSize );
+
+	m_sendTimer.setTimerType( Qt::PreciseTimer );
+	m_sendTimer.setInterval( SendInterval );
+
+	m_heartbeatTimer.start( HeartbeatInterval );
+}
+
+
+
+DemoMulticastSender::~DemoMulticastSender()
+{
+	m_socket->disconnect( this );
+}
+
+
+
+void DemoMulticastSender::sendMessage( const QByteArray& message, bool isKeyFrame )
+{
+	if( message.isEmpty() )
+	{
+		return;
+	}
+
+	if( VncMulticastProtocol::fragmentCount( static_cast<quint32>( message.size() ) ) > VncMulticastProtocol::MaximumFragmentCount )
+	{
+		// receivers will notice the missing message and fall back to TCP
+		qWarning() << Q_FUNC_INFO << "message too large for multicast:" << message.size();
+		++m_nextSequence;
+		return;
+	}
+
+	SentMessage sentMessage;
+	sentMessage.sequence = m_nextSequence++;
+	sentMessage.message = message;
+	sentMessage.flags = isKeyFrame ? VncMulticastProtocol::KeyFrame : VncMulticastProtocol::NoFlags;
+
+	enqueueMessage( sentMessage, m_datagrams );
+
+	m_sentMessages.enqueue( sentMessage );
+	m_sentMessagesSize += message.size();
+
+	// keep messages for retransmissions within bounds
+	while( m_sentMessagesSize > RetransmissionBufferSize && m_sentMessages.size() > 1 )
+	{
+		m_sentMessagesSize -= m_sentMessages.dequeue().message.size();
+	}
+}
+
+
+
+void DemoMulticastSender::readNacks()
+{
+	VncMulticastProtocol::Header header;
+	QByteArray payload;
+
+	while( m_socket->hasPendingDatagrams() )
+	{
+		QByteArray datagram( static_cast<int>( qMax<qint64>( 0, m_socket->pendingDatagramSize() ) ), 0 );
+
+		if( m_socket->readDatagram( datagram.data(), datagram.size() ) < 0 ) // Flawfinder: ignore
+		{
+			break;
+		}
+
+		// ignore anything not sent by one of our receivers
+		if( VncMulticastProtocol::parsePacket( m_key, datagram, header, payload ) &&
+				header.session == m_sessionId &&
+				header.type == VncMulticastProtocol::NackPacket )
+		{
+			retransmit( header.sequence, VncMulticastProtocol::nackIndices( payload ) );
+		}
+	}
+}
+
+
+
+void DemoMulticastSender::sendHeartbeat()
+{
+	// queue heartbeat behind pending data so it never announces messages which have not been sent yet
+	const auto heartbeat = VncMulticastProtocol::header( m_sessionId, VncMulticastProtocol::HeartbeatPacket, m_nextSequence );
+
+	enqueueDatagram( VncMulticastProtocol::packet( m_key, heartbeat ), m_datagrams );
+}
+
+
+
+void DemoMulticastSender::sendDatagrams()
+{
+	for( int i = 0; i < MaximumDatagramsPerInterval; ++i )
+	{
+		// repair data is more urgent as receivers stall until they got it
+		auto& datagrams = m_retransmissionDatagrams.isEmpty() ? m_datagrams : m_retransmissionDatagrams;
+
+		if( datagrams.isEmpty() )
+		{
+			m_sendTimer.stop();
+			return;
+		}
+
+		if( m_socket->writeDatagram( datagrams.head(), m_groupAddress, m_port ) < 0 )
+		{
+			// most likely send buffer is full so try again with next interval
+			return;
+		}
+
+		datagrams.dequeue();
+	}
+}
+
+
+
+void DemoMulticastSender::enqueueMessage( const SentMessage& sentMessage, QQueue<QByteArray>& datagrams )
+{
+	const int fragmentCount = VncMulticastProtocol::fragmentCount( static_cast<quint32>( sentMessage.message.size() ) );
+
+	VncMulticastProtocol::IndexList fragments;
+	fragments.reserve( fragmentCount );
+
+	for( int i = 0; i < fragmentCount; ++i )
+	{
+		fragments.append( static_cast<quint16>( i ) );
+	}
+
+	enqueueFragments( sentMessage, fragments, datagrams );
+
+	auto parityHeader = header( sentMessage, VncMulticastProtocol::ParityPacket );
+
+	for( int group = 0; group < VncMulticastProtocol::fecGroupCount( fragmentCount ); ++group )
+	{
+		parityHeader.index = static_cast<quint16>( group );
+		enqueueDatagram( VncMulticastProtocol::packet( m_key, parityHeader, VncMulticastProtocol::parity( sentMessage.message, group ) ),
+						 datagrams );
+	}
+}
+
+
+
+void DemoMulticastSender::enqueueFragments( const SentMessage& sentMessage, const VncMulticastProtocol::IndexList& indices,
+											QQueue<QByteArray>& datagrams )
+{
+	auto fragmentHeader = header( sentMessage, VncMulticastProtocol::DataPacket );
+
+	for( auto index : indices )
+	{
+		if( index < fragmentHeader.count )
+		{
+			fragmentHeader.index = index;
+			enqueueDatagram( VncMulticastProtocol::packet( m_key, fragmentHeader,
+														   VncMulticastProtocol::fragment( sentMessage.message, index ) ),
+							 datagrams );
+		}
+	}
+}
+
+
+
+void DemoMulticastSender::enqueueDatagram( const QByteArray& datagram, QQueue<QByteArray>& datagrams )
+{
+	if( datagrams.size() >= MaximumQueuedDatagrams )
+	{
+		// network can't keep up (or multicast can't be sent at all) so let receivers
+		// start over with a later key frame or fall back to TCP
+		qWarning() << Q_FUNC_INFO << "dropping queued datagrams";
+		datagrams.clear();
+	}
+
+	datagrams.enqueue( datagram );
+
+	if( m_sendTimer.isActive() == false )
+	{
+		m_sendTimer.start();
+	}
+}
+
+
+
+void DemoMulticastSender::retransmit( Sequence sequence, const VncMulticastProtocol::IndexList& missingFragments )
+{
+	for( auto it = m_sentMessages.begin(), end = m_sentMessages.end(); it != end; ++it )
+	{
+		if( it->sequence != sequence )
+		{
+			continue;
+		}
+
+		// NACKs of multiple receivers for the same loss are answered once
+		if( it->lastRetransmission.isValid() &&
+				it->lastRetransmission.hasExpired( MinimumRetransmissionInterval ) == false )
+		{
+			return;
+		}
+
+		it->lastRetransmission.start();
+
+		if( missingFragments.isEmpty() )
+		{
+			enqueueMessage( *it, m_retransmissionDatagrams );
+		}
+		else
+		{
+			enqueueFragments( *it, missingFragments, m_retransmissionDatagrams );
+		}
+
+		return;
+	}
+}
+
+
+
+VncMulticastProtocol::Header DemoMulticastSender::header( const SentMessage& sentMessage,
+														  VncMulticastProtocol::PacketType type ) const
+{
+	auto header = VncMulticastProtocol::header( m_sessionId, type, sentMessage.sequence );
+	header.count = static_cast<quint16>( VncMulticastProtocol::fragmentCount( static_cast<quint32>( sentMessage.message.size() ) ) );
+	header.flags = sentMessage.flags;
+	header.messageSize = static_cast<quint32>( sentMessage.message.size() );
+
+	return header;
+}
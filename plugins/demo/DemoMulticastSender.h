@@ -0,0 +1,102 @@
+/*
+ * DemoMulticastSender.h - header file for DemoMulticastSender class
+ *
+ * Copyright (c) 2018 Tobias Junghans <tobydox@veyon.io>
+ *
+ * This file is part of Veyon - http://veyon.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef DEMO_MULTICAST_SENDER_H
+#define DEMO_MULTICAST_SENDER_H
+
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QQueue>
+#include <QTimer>
+
+#include "VncMulticastProtocol.h"
+
+class QUdpSocket;
+
+/** \brief Sends framebuffer updates of the demo server to a multicast group
+ *
+ * Datagrams are paced so a key frame does not overflow the buffers of switches and receivers at once.
+ * Sent messages are kept in a bounded buffer to answer retransmission requests of receivers.
+ */
+class DemoMulticastSender : public QObject
+{
+	Q_OBJECT
+public:
+	typedef VncMulticastProtocol::Sequence Sequence;
+
+	DemoMulticastSender( const QHostAddress& groupAddress, int port, const QByteArray& key, QObject* parent );
+	~DemoMulticastSender() override;
+
+	void sendMessage( const QByteArray& message, bool isKeyFrame );
+
+private slots:
+	void readNacks();
+	void sendHeartbeat();
+	void sendDatagrams();
+
+private:
+	enum {
+		MulticastTtl = 1,
+		SendBufferSize = 4*1024*1024,
+		RetransmissionBufferSize = 16*1024*1024,
+		HeartbeatInterval = 100,				// in milliseconds
+		SendInterval = 1,						// in milliseconds
+		MaximumDatagramsPerInterval = 8,		// limits bandwidth to roughly 90 MBit/s
+		MaximumQueuedDatagrams = 32768,
+		MinimumRetransmissionInterval = 20		// in milliseconds
+	};
+
+	struct SentMessage {
+		Sequence sequence;
+		QByteArray message;
+		quint8 flags;
+		QElapsedTimer lastRetransmission;
+	} ;
+
+	void enqueueMessage( const SentMessage& sentMessage, QQueue<QByteArray>& datagrams );
+	void enqueueFragments( const SentMessage& sentMessage, const VncMulticastProtocol::IndexList& indices,
+						   QQueue<QByteArray>& datagrams );
+	void enqueueDatagram( const QByteArray& datagram, QQueue<QByteArray>& datagrams );
+	void retransmit( Sequence sequence, const VncMulticastProtocol::IndexList& missingFragments );
+
+	VncMulticastProtocol::Header header( const SentMessage& sentMessage, VncMulticastProtocol::PacketType type ) const;
+
+	QUdpSocket* m_socket;
+	const QHostAddress m_groupAddress;
+	const quint16 m_port;
+	const QByteArray m_key;
+	const quint32 m_sessionId;
+
+	QTimer m_heartbeatTimer;
+	QTimer m_sendTimer;
+	QQueue<QByteArray> m_datagrams;
+	QQueue<QByteArray> m_retransmissionDatagrams;
+
+	Sequence m_nextSequence;
+	QQueue<SentMessage> m_sentMessages;
+	qint64 m_sentMessagesSize;
+
+} ;
+
+#endif
@@ -0,0 +1,462 @@
+/*
+ * DemoRendition.cpp - implementation of DemoRendition class
+ *
+ * Copyright (c) 2018 Tobias Junghans <tobydox@veyon.io>
+ *
+ * This file is part of Veyon - http://veyon.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include <QTcpSocket>
+#include <QtEndian>
+
+#include "DemoConfiguration.h"
+#include "DemoMulticastSender.h"
+#include "DemoRendition.h"
+#include "DemoServer.h"
+
+
+DemoRendition::DemoRendition( int scale, bool lossless, int vncServerPort, const QString& vncServerPassword,
+							  qint64 memoryLimit, DemoServer* demoServer ) :
+	QObject( demoServer ),
+	m_demoServer( demoServer ),
+	m_scale( scale ),
+	m_lossless( lossless ),
+	m_vncServerPort( vncServerPort ),
+	m_vncServerSocket( new QTcpSocket( this ) ),
+	m_vncClientProtocol( m_vncServerSocket, vncServerPassword ),
+	m_lastFullFramebufferUpdate(),
+	m_keyFrameTimer(),
+	m_requestFullFramebufferUpdate( false ),
+	m_encoder( lossless, demoServer->configuration().imageQuality() ),
+	m_framebufferUpdateLog( memoryLimit ),
+	m_multicastSender( nullptr ),
+	m_framebufferMutex(),
+	m_framebuffer(),
+	m_framebufferValid( false ),
+	m_framebufferSize(),
+	m_readers( 0 )
+{
+	connect( m_vncServerSocket, &QTcpSocket::readyRead, this, &DemoRendition::readFromVncServer );
+	connect( m_vncServerSocket, &QTcpSocket::disconnected, this, &DemoRendition::reconnectToVncServer );
+}
+
+
+
+DemoRendition::~DemoRendition()
+{
+	m_vncServerSocket->disconnect( this );
+}
+
+
+
+QSize DemoRendition::framebufferSize() const
+{
+	QMutexLocker locker( &m_framebufferMutex );
+
+	return m_framebufferSize;
+}
+
+
+
+QByteArray DemoRendition::encodeUpdatesSince( DemoFramebufferUpdateLog::Sequence& sequence ) const
+{
+	QImage framebuffer;
+	QRegion region;
+	bool fullFramebuffer = sequence < 0;
+
+	m_framebufferMutex.lock();
+
+	// shadow framebuffer must match the latest size clients have been told about
+	if( m_framebufferValid == false || m_framebuffer.size() != m_framebufferSize )
+	{
+		m_framebufferMutex.unlock();
+		return QByteArray();
+	}
+
+	// shallow copy which the demo server thread detaches from when applying further updates
+	framebuffer = m_framebuffer;
+
+	if( fullFramebuffer || m_framebufferUpdateLog.updatedRegion( sequence, region ) == false )
+	{
+		fullFramebuffer = true;
+		region = framebuffer.rect();
+	}
+
+	// messages appended from now on are not contained in the shadow framebuffer yet
+	sequence = m_framebufferUpdateLog.nextSequence();
+
+	m_framebufferMutex.unlock();
+
+	auto message = m_encoder.encode( framebuffer, region );
+
+	if( fullFramebuffer && message.isEmpty() == false )
+	{
+		// client may have a different framebuffer size (e.g. when switching renditions)
+		message.prepend( framebufferSizeMessage( framebuffer.size() ) );
+	}
+
+	return message;
+}
+
+
+
+QByteArray DemoRendition::framebufferSizeMessage( const QSize& framebufferSize )
+{
+	rfbFramebufferUpdateMsg updateMessage;
+	updateMessage.type = rfbFramebufferUpdate;
+	updateMessage.pad = 0;
+	updateMessage.nRects = qToBigEndian<uint16_t>( 1 );
+
+	rfbFramebufferUpdateRectHeader rectHeader;
+	rectHeader.r.x = 0;
+	rectHeader.r.y = 0;
+	rectHeader.r.w = qToBigEndian<uint16_t>( static_cast<uint16_t>( framebufferSize.width() ) );
+	rectHeader.r.h = qToBigEndian<uint16_t>( static_cast<uint16_t>( framebufferSize.height() ) );
+	rectHeader.encoding = qToBigEndian<uint32_t>( rfbEncodingNewFBSize );
+
+	QByteArray message( reinterpret_cast<const char *>( &updateMessage ), sz_rfbFramebufferUpdateMsg );
+	message.append( reinterpret_cast<const char *>( &rectHeader ), sz_rfbFramebufferUpdateRectHeader );
+
+	return message;
+}
+
+
+
+void DemoRendition::reconnectToVncServer()
+{
+	m_vncClientProtocol.start();
+
+	m_vncServerSocket->connectToHost( QHostAddress::LocalHost, m_vncServerPort );
+}
+
+
+
+void DemoRendition::requestFramebufferUpdate()
+{
+	if( m_vncClientProtocol.state() != VncClientProtocol::Running )
+	{
+		return;
+	}
+
+	if( m_requestFullFramebufferUpdate ||
+			m_lastFullFramebufferUpdate.elapsed() >= m_demoServer->configuration().keyFrameInterval() * 1000 )
+	{
+		m_vncClientProtocol.requestFramebufferUpdate( false );
+		m_lastFullFramebufferUpdate.restart();
+		m_requestFullFramebufferUpdate = false;
+	}
+	else
+	{
+		m_vncClientProtocol.requestFramebufferUpdate( true );
+	}
+}
+
+
+
+void DemoRendition::readFromVncServer()
+{
+	if( m_vncClientProtocol.state() != VncClientProtocol::Running )
+	{
+		while( m_vncClientProtocol.read() )
+		{
+		}
+
+		if( m_vncClientProtocol.state() == VncClientProtocol::Running )
+		{
+			start();
+		}
+	}
+	else
+	{
+		bool receivedMessages = false;
+
+		while( receiveVncServerMessage() )
+		{
+			receivedMessages = true;
+		}
+
+		if( receivedMessages )
+		{
+			emit framebufferUpdateMessagesAvailable();
+		}
+	}
+}
+
+
+
+bool DemoRendition::receiveVncServerMessage()
+{
+	if( m_vncClientProtocol.receiveMessage() )
+	{
+		if( m_vncClientProtocol.lastMessageType() == rfbFramebufferUpdate )
+		{
+			enqueueFramebufferUpdateMessage( m_vncClientProtocol.lastMessage() );
+		}
+		else if( m_vncClientProtocol.lastMessageType() == rfbResizeFrameBuffer )
+		{
+			// framebuffer has been scaled or resized so clients need a full update in new size
+			m_requestFullFramebufferUpdate = true;
+		}
+		else
+		{
+			qWarning( "DemoRendition: skipping server message of type %d", (int) m_vncClientProtocol.lastMessageType() );
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+
+
+bool DemoRendition::applyFramebufferUpdate( const QByteArray& message )
+{
+	const QSize framebufferSize( m_vncClientProtocol.framebufferWidth(), m_vncClientProtocol.framebufferHeight() );
+
+	if( m_framebuffer.size() != framebufferSize )
+	{
+		// wait for a full update in new size before encoding anything from the shadow framebuffer
+		m_framebuffer = QImage( framebufferSize, QImage::Format_RGB32 );
+		m_framebuffer.fill( Qt::black );
+		m_framebufferValid = false;
+		m_requestFullFramebufferUpdate = true;
+	}
+
+	if( message.size() < sz_rfbFramebufferUpdateMsg )
+	{
+		return false;
+	}
+
+	const auto updateMessage = reinterpret_cast<const rfbFramebufferUpdateMsg *>( message.constData() );
+	const int rectCount = qFromBigEndian( updateMessage->nRects );
+
+	int offset = sz_rfbFramebufferUpdateMsg;
+
+	for( int i = 0; i < rectCount; ++i )
+	{
+		if( message.size() - offset < sz_rfbFramebufferUpdateRectHeader )
+		{
+			return false;
+		}
+
+		rfbFramebufferUpdateRectHeader rectHeader;
+		memcpy( &rectHeader, message.constData() + offset, sz_rfbFramebufferUpdateRectHeader ); // Flawfinder: ignore
+		offset += sz_rfbFramebufferUpdateRectHeader;
+
+		const auto encoding = qFromBigEndian( rectHeader.encoding );
+
+		if( encoding == rfbEncodingLastRect )
+		{
+			break;
+		}
+
+		if( encoding == rfbEncodingNewFBSize )
+		{
+			continue;
+		}
+
+		const QRect rect( qFromBigEndian( rectHeader.r.x ), qFromBigEndian( rectHeader.r.y ),
+						  qFromBigEndian( rectHeader.r.w ), qFromBigEndian( rectHeader.r.h ) );
+		const int dataSize = rect.width() * rect.height() * static_cast<int>( sizeof(QRgb) );
+
+		// only raw updates have been requested
+		if( encoding != rfbEncodingRaw || m_framebuffer.rect().contains( rect ) == false ||
+				message.size() - offset < dataSize )
+		{
+			return false;
+		}
+
+		const auto pixels = reinterpret_cast<const QRgb *>( message.constData() + offset );
+
+		for( int y = 0; y < rect.height(); ++y )
+		{
+			const auto source = pixels + y * rect.width();
+			const auto line = reinterpret_cast<QRgb *>( m_framebuffer.scanLine( rect.y() + y ) ) + rect.x();
+
+			for( int x = 0; x < rect.width(); ++x )
+			{
+				line[x] = source[x] | 0xff000000;
+			}
+		}
+
+		offset += dataSize;
+	}
+
+	return true;
+}
+
+
+
+void DemoRendition::enqueueFramebufferUpdateMessage( const QByteArray& message )
+{
+	m_framebufferMutex.lock();
+
+	if( applyFramebufferUpdate( message ) == false )
+	{
+		m_framebufferMutex.unlock();
+
+		qWarning() << Q_FUNC_INFO << "could not apply framebuffer update";
+
+		// shadow framebuffer may be incomplete now
+		m_requestFullFramebufferUpdate = true;
+		return;
+	}
+
+	const auto region = m_vncClientProtocol.lastUpdatedRegion().intersected( m_framebuffer.rect() );
+	const bool isKeyFrame = region.isEmpty() == false && ( QRegion( m_framebuffer.rect() ) - region ).isEmpty();
+
+	m_framebufferMutex.unlock();
+
+	if( region.isEmpty() || ( m_framebufferValid == false && isKeyFrame == false ) )
+	{
+		// nothing to send or clients can't start with a complete framebuffer yet
+		return;
+	}
+
+	if( isKeyFrame )
+	{
+		if( m_keyFrameTimer.elapsed() > 1 )
+		{
+			const auto memTotal = m_framebufferUpdateLog.sizeSinceKeyFrame() / 1024;
+			qDebug() << Q_FUNC_INFO
+					 << "   SCALE:" << m_scale
+					 << "   LOSSLESS:" << m_lossless
+					 << "   MEMTOTAL:" << memTotal
+					 << "   KB/s:" << ( memTotal * 1000 ) / m_keyFrameTimer.elapsed()
+					 << "   BUFFERED KB:" << m_demoServer->bufferedBytes() / 1024;
+		}
+		m_keyFrameTimer.restart();
+
+		// requested full update (e.g. after resizing) has been received
+		m_requestFullFramebufferUpdate = false;
+	}
+
+	// only this thread modifies the shadow framebuffer so it can be encoded without holding the lock
+	const auto encodedMessage = m_encoder.encode( m_framebuffer, region );
+	if( encodedMessage.isEmpty() )
+	{
+		m_requestFullFramebufferUpdate = true;
+		return;
+	}
+
+	DemoFramebufferUpdateLog::Flags flags( DemoFramebufferUpdateLog::Skippable );
+
+	if( isKeyFrame )
+	{
+		flags |= DemoFramebufferUpdateLog::KeyFrame;
+	}
+
+	QByteArray sizeMessage;
+
+	// log and framebuffer size have to be updated at once for encodeUpdatesSince()
+	m_framebufferMutex.lock();
+
+	if( isKeyFrame )
+	{
+		m_framebufferValid = true;
+
+		// clients which started with a previous key frame have to resize their framebuffer
+		if( m_framebuffer.size() != m_framebufferSize && m_framebufferSize.isEmpty() == false )
+		{
+			sizeMessage = framebufferSizeMessage( m_framebuffer.size() );
+			m_framebufferUpdateLog.append( sizeMessage, QRegion(), DemoFramebufferUpdateLog::NoFlags );
+		}
+
+		m_framebufferSize = m_framebuffer.size();
+	}
+
+	m_framebufferUpdateLog.append( encodedMessage, region, flags );
+
+	m_framebufferMutex.unlock();
+
+	if( m_multicastSender )
+	{
+		if( sizeMessage.isEmpty() == false )
+		{
+			m_multicastSender->sendMessage( sizeMessage, false );
+		}
+
+		m_multicastSender->sendMessage( encodedMessage, isKeyFrame );
+	}
+
+	// key frame dropped or about to be dropped due to memory limit?
+	if( m_framebufferUpdateLog.needsKeyFrame() )
+	{
+		// then request a full update so new clients can start over with it
+		m_requestFullFramebufferUpdate = true;
+	}
+}
+
+
+
+void DemoRendition::start()
+{
+	setVncServerPixelFormat();
+	setVncServerEncodings();
+
+	if( m_scale > 1 )
+	{
+		m_vncClientProtocol.setScale( m_scale );
+	}
+
+	m_requestFullFramebufferUpdate = true;
+
+	requestFramebufferUpdate();
+
+	while( receiveVncServerMessage() )
+	{
+	}
+
+	emit started();
+}
+
+
+
+bool DemoRendition::setVncServerPixelFormat()
+{
+	rfbPixelFormat format;
+
+	format.bitsPerPixel = 32;
+	// raw pixels in host byte order match QImage::Format_RGB32 of the shadow framebuffer
+	format.depth = 24;
+	format.bigEndian = qFromBigEndian<uint16_t>( 1 ) == 1 ? true : false;
+	format.trueColour = 1;
+	format.redShift = 16;
+	format.greenShift = 8;
+	format.blueShift = 0;
+	format.redMax = 0xff;
+	format.greenMax = 0xff;
+	format.blueMax = 0xff;
+
+	return m_vncClientProtocol.setPixelFormat( format );
+}
+
+
+
+bool DemoRendition::setVncServerEncodings()
+{
+	// updates are decoded into the shadow framebuffer and encoded for clients by ourselves
+	// so transferring them uncompressed from the local VNC server is cheapest
+	return m_vncClientProtocol.setEncodings( {
+												 rfbEncodingRaw,
+												 rfbEncodingNewFBSize,
+												 rfbEncodingLastRect
+											 } );
+}
@@ -0,0 +1,161 @@
+/*
+ * DemoRendition.h - header file for DemoRendition class
+ *
+ * Copyright (c) 2018 Tobias Junghans <tobydox@veyon.io>
+ *
+ * This file is part of Veyon - http://veyon.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef DEMO_RENDITION_H
+#define DEMO_RENDITION_H
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QMutex>
+#include <QSize>
+
+#include "DemoFramebufferUpdateLog.h"
+#include "DemoTightEncoder.h"
+#include "VncClientProtocol.h"
+
+class DemoMulticastSender;
+class DemoServer;
+
+/** \brief Framebuffer updates of the demo server in a certain resolution and quality
+ *
+ * Each rendition has its own connection to the VNC server which scales down the framebuffer by a
+ * fixed divisor and sends raw updates. These are applied to a shadow framebuffer and encoded once
+ * as self-contained Tight updates, either lossless or with JPEG compression, no matter how many
+ * clients receive them. Updates are stored in a log of their own which connections read from until
+ * they switch to another rendition. New or lagging connections receive the region they are missing
+ * encoded from the shadow framebuffer instead, so they never get more data than the screen holds.
+ */
+class DemoRendition : public QObject
+{
+	Q_OBJECT
+public:
+	DemoRendition( int scale, bool lossless, int vncServerPort, const QString& vncServerPassword,
+				   qint64 memoryLimit, DemoServer* demoServer );
+	~DemoRendition() override;
+
+	int scale() const
+	{
+		return m_scale;
+	}
+
+	bool isLossless() const
+	{
+		return m_lossless;
+	}
+
+	bool isRunning() const
+	{
+		return m_vncClientProtocol.state() == VncClientProtocol::Running;
+	}
+
+	const QByteArray& serverInitMessage() const
+	{
+		return m_vncClientProtocol.serverInitMessage();
+	}
+
+	const DemoFramebufferUpdateLog& framebufferUpdateLog() const
+	{
+		return m_framebufferUpdateLog;
+	}
+
+	// size of latest key frame or an empty size if none has been received yet - may be queried from any thread
+	QSize framebufferSize() const;
+
+	// encodes region updated since given sequence or full framebuffer including its size for a sequence of -1
+	// and advances sequence to the next message in log - returns an empty message if there is no key frame
+	// yet - may be called from any thread
+	QByteArray encodeUpdatesSince( DemoFramebufferUpdateLog::Sequence& sequence ) const;
+
+	// connections register while reading from this rendition - may be called from any thread
+	void addReader()
+	{
+		m_readers.ref();
+	}
+
+	void removeReader()
+	{
+		m_readers.deref();
+	}
+
+	bool hasReaders() const
+	{
+		return m_readers.load() > 0;
+	}
+
+	void setMulticastSender( DemoMulticastSender* multicastSender )
+	{
+		m_multicastSender = multicastSender;
+	}
+
+	// framebuffer update message which tells clients to resize their framebuffer
+	static QByteArray framebufferSizeMessage( const QSize& framebufferSize );
+
+signals:
+	void started();
+	void framebufferUpdateMessagesAvailable();
+
+public slots:
+	void reconnectToVncServer();
+	void requestFramebufferUpdate();
+
+private slots:
+	void readFromVncServer();
+
+private:
+	bool receiveVncServerMessage();
+	bool applyFramebufferUpdate( const QByteArray& message );
+	void enqueueFramebufferUpdateMessage( const QByteArray& message );
+
+	void start();
+	bool setVncServerPixelFormat();
+	bool setVncServerEncodings();
+
+	DemoServer* m_demoServer;
+	const int m_scale;
+	const bool m_lossless;
+	const int m_vncServerPort;
+
+	QTcpSocket* m_vncServerSocket;
+	VncClientProtocol m_vncClientProtocol;
+
+	QElapsedTimer m_lastFullFramebufferUpdate;
+	QElapsedTimer m_keyFrameTimer;
+	bool m_requestFullFramebufferUpdate;
+
+	DemoTightEncoder m_encoder;
+	DemoFramebufferUpdateLog m_framebufferUpdateLog;
+	DemoMulticastSender* m_multicastSender;
+
+	// shadow framebuffer is written by the demo server thread only
+	mutable QMutex m_framebufferMutex;
+	QImage m_framebuffer;
+	bool m_framebufferValid;
+	QSize m_framebufferSize;
+
+	QAtomicInt m_readers;
+
+} ;
+
+#endif
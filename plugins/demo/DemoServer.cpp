@@ -25,33 +25,58 @@
 
 #include <QTcpServer>
 #include <QTcpSocket>
+#include <QThread>
 
 #include "DemoConfiguration.h"
+#include "DemoMulticastSender.h"
 #include "DemoServer.h"
 #include "DemoServerConnection.h"
 #include "VeyonConfiguration.h"
+#include "VncConnectionPool.h"
 
 
 DemoServer::DemoServer( int vncServerPort, const QString& vncServerPassword, const QString& demoAccessToken,
 						const DemoConfiguration& configuration, QObject *parent ) :
 	QObject( parent ),
 	m_configuration( configuration ),
-	m_vncServerPort( vncServerPort ),
 	m_demoAccessToken( demoAccessToken ),
 	m_tcpServer( new QTcpServer( this ) ),
-	m_vncServerSocket( new QTcpSocket( this ) ),
-	m_vncClientProtocol( m_vncServerSocket, vncServerPassword ),
+	m_renditions(),
+	m_defaultRendition( new DemoRendition( 1, false, vncServerPort, vncServerPassword, renditionMemoryLimit(), this ) ),
+	m_connectionPool( new VncConnectionPool( m_configuration.multithreadingEnabled() ?
+												 QThread::idealThreadCount() : 1 ) ),
+	m_connections(),
 	m_framebufferUpdateTimer( this ),
-	m_lastFullFramebufferUpdate(),
-	m_requestFullFramebufferUpdate( false ),
-	m_keyFrame( 0 )
+	m_multicastSender( nullptr )
 {
+	if( m_configuration.adaptiveQualityEnabled() )
+	{
+		// clients with a fast connection may receive lossless updates while clients with
+		// smaller screens or slow connections receive updates scaled down by the VNC server
+		m_renditions += new DemoRendition( 1, true, vncServerPort, vncServerPassword, renditionMemoryLimit(), this );
+		m_renditions += m_defaultRendition;
+
+		for( int scale = 2; scale <= MaximumRenditionScale; ++scale )
+		{
+			m_renditions += new DemoRendition( scale, false, vncServerPort, vncServerPassword,
+											   renditionMemoryLimit(), this );
+		}
+	}
+	else
+	{
+		m_renditions += m_defaultRendition;
+	}
+
 	connect( m_tcpServer, &QTcpServer::newConnection, this, &DemoServer::acceptPendingConnections );
+	connect( m_defaultRendition, &DemoRendition::started, this, &DemoServer::acceptPendingConnections );
 
-	connect( m_vncServerSocket, &QTcpSocket::readyRead, this, &DemoServer::readFromVncServer );
-	connect( m_vncServerSocket, &QTcpSocket::disconnected, this, &DemoServer::reconnectToVncServer );
+	for( auto rendition : qAsConst( m_renditions ) )
+	{
+		connect( rendition, &DemoRendition::framebufferUpdateMessagesAvailable,
+				 this, &DemoServer::framebufferUpdateMessagesAvailable );
+	}
 
-	connect( &m_framebufferUpdateTimer, &QTimer::timeout, this, &DemoServer::requestFramebufferUpdate );
+	connect( &m_framebufferUpdateTimer, &QTimer::timeout, this, &DemoServer::requestFramebufferUpdates );
 
 	if( m_tcpServer->listen( QHostAddress::Any, VeyonCore::config().demoServerPort() ) == false )
 	{
@@ -59,9 +84,22 @@ DemoServer::DemoServer( int vncServerPort, const QString& vncServerPassword, con
 		return;
 	}
 
+	if( m_configuration.multicastEnabled() )
+	{
+		// clients receive all updates via TCP until they got a key frame via multicast
+		m_multicastSender = new DemoMulticastSender( QHostAddress( m_configuration.multicastAddress() ),
+													 m_configuration.multicastPort(),
+													 m_demoAccessToken.toUtf8(),
+													 this );
+		m_defaultRendition->setMulticastSender( m_multicastSender );
+	}
+
 	m_framebufferUpdateTimer.start( m_configuration.framebufferUpdateInterval() );
 
-	reconnectToVncServer();
+	for( auto rendition : qAsConst( m_renditions ) )
+	{
+		rendition->reconnectToVncServer();
+	}
 }
 
 
@@ -69,19 +107,24 @@ DemoServer::DemoServer( int vncServerPort, const QString& vncServerPassword, con
 DemoServer::~DemoServer()
 {
 	qDebug() << Q_FUNC_INFO << "disconnecting signals";
-	m_vncServerSocket->disconnect( this );
 	m_tcpServer->disconnect( this );
 
 	qDebug() << Q_FUNC_INFO << "deleting connections";
 
-	QList<DemoServerConnection *> l;
-	while( !( l = findChildren<DemoServerConnection *>() ).isEmpty() )
+	// connections live in threads of connection pool so let them be deleted there
+	for( auto connection : qAsConst( m_connections ) )
 	{
-		delete l.front();
+		connection->deleteLater();
 	}
 
-	qDebug() << Q_FUNC_INFO << "deleting server socket";
-	delete m_vncServerSocket;
+	m_connections.clear();
+
+	// finishes all threads after processing pending deletions
+	delete m_connectionPool;
+
+	qDebug() << Q_FUNC_INFO << "deleting renditions";
+	qDeleteAll( m_renditions );
+	m_renditions.clear();
 
 	qDebug() << Q_FUNC_INFO << "deleting TCP server";
 	delete m_tcpServer;
@@ -91,204 +134,81 @@ DemoServer::~DemoServer()
 
 
 
-void DemoServer::acceptPendingConnections()
+qint64 DemoServer::bufferedBytes() const
 {
-	if( m_vncClientProtocol.state() != VncClientProtocol::Running )
-	{
-		return;
-	}
+	qint64 bytes = 0;
 
-	while( m_tcpServer->hasPendingConnections() )
+	for( auto connection : m_connections )
 	{
-		new DemoServerConnection( m_demoAccessToken, m_tcpServer->nextPendingConnection(), this );
+		bytes += connection->bufferedBytes();
 	}
-}
-
-
 
-void DemoServer::reconnectToVncServer()
-{
-	m_vncClientProtocol.start();
-
-	m_vncServerSocket->connectToHost( QHostAddress::LocalHost, m_vncServerPort );
+	return bytes;
 }
 
 
 
-void DemoServer::readFromVncServer()
+qint64 DemoServer::renditionMemoryLimit() const
 {
-	if( m_vncClientProtocol.state() != VncClientProtocol::Running )
-	{
-		while( m_vncClientProtocol.read() )
-		{
-		}
+	// lossless and default rendition plus one for each scale
+	const int renditionCount = m_configuration.adaptiveQualityEnabled() ? MaximumRenditionScale + 1 : 1;
 
-		if( m_vncClientProtocol.state() == VncClientProtocol::Running )
-		{
-			start();
-		}
-	}
-	else
-	{
-		while( receiveVncServerMessage() )
-		{
-		}
-	}
+	return static_cast<qint64>( m_configuration.memoryLimit() ) * 1024 * 1024 / renditionCount;
 }
 
 
 
-void DemoServer::requestFramebufferUpdate()
+void DemoServer::acceptPendingConnections()
 {
-	if( m_vncClientProtocol.state() != VncClientProtocol::Running )
+	if( m_defaultRendition->isRunning() == false )
 	{
 		return;
 	}
 
-	if( m_requestFullFramebufferUpdate ||
-			m_lastFullFramebufferUpdate.elapsed() >= m_configuration.keyFrameInterval() * 1000 )
-	{
-		m_vncClientProtocol.requestFramebufferUpdate( false );
-		m_lastFullFramebufferUpdate.restart();
-		m_requestFullFramebufferUpdate = false;
-	}
-	else
+	while( m_tcpServer->hasPendingConnections() )
 	{
-		m_vncClientProtocol.requestFramebufferUpdate( true );
-	}
-}
+		auto socket = m_tcpServer->nextPendingConnection();
+		auto connection = new DemoServerConnection( m_demoAccessToken, socket, this );
 
+		connect( socket, &QTcpSocket::disconnected, this, [=]() { closeConnection( connection ); } );
+		connect( this, &DemoServer::framebufferUpdateMessagesAvailable,
+				 connection, &DemoServerConnection::sendFramebufferUpdate );
 
+		// updates are written to each client in a thread of the connection pool so
+		// slow clients neither stall other clients nor the ingestion of new updates
+		connection->moveToThread( m_connectionPool->acquireThread() );
 
-bool DemoServer::receiveVncServerMessage()
-{
-	if( m_vncClientProtocol.receiveMessage() )
-	{
-		if( m_vncClientProtocol.lastMessageType() == rfbFramebufferUpdate )
-		{
-			enqueueFramebufferUpdateMessage( m_vncClientProtocol.lastMessage() );
-		}
-		else
-		{
-			qWarning( "DemoServer: skipping server message of type %d", (int) m_vncClientProtocol.lastMessageType() );
-		}
+		m_connections += connection;
 
-		return true;
+		QMetaObject::invokeMethod( connection, "start", Qt::QueuedConnection );
 	}
-
-	return false;
 }
 
 
 
-void DemoServer::enqueueFramebufferUpdateMessage( const QByteArray& message )
+void DemoServer::closeConnection( DemoServerConnection* connection )
 {
-	bool isFullUpdate = false;
-	const auto lastUpdatedRect = m_vncClientProtocol.lastUpdatedRect();
-
-	if( lastUpdatedRect.x() == 0 && lastUpdatedRect.y() == 0 &&
-			lastUpdatedRect.width() == m_vncClientProtocol.framebufferWidth() &&
-			lastUpdatedRect.height() == m_vncClientProtocol.framebufferHeight() )
-	{
-		isFullUpdate = true;
-	}
-
-	m_dataLock.lockForWrite();
-
-	if( isFullUpdate || framebufferUpdateMessageQueueSize() > m_configuration.memoryLimit()*2*1024*1024  )
+	if( m_connections.removeAll( connection ) == 0 )
 	{
-		if( m_keyFrameTimer.elapsed() > 1 )
-		{
-			const auto memTotal = framebufferUpdateMessageQueueSize() / 1024;
-			qDebug() << Q_FUNC_INFO
-					 << "   MEMTOTAL:" << memTotal
-					 << "   KB/s:" << ( memTotal * 1000 ) / m_keyFrameTimer.elapsed();
-		}
-		m_keyFrameTimer.restart();
-		++m_keyFrame;
-		m_framebufferUpdateMessages.clear();
-	}
-
-	m_framebufferUpdateMessages.append( message );
-
-	m_dataLock.unlock();
-
-	// we're about to reach memory limits?
-	if( framebufferUpdateMessageQueueSize() > m_configuration.memoryLimit() * 1024 * 1024 )
-	{
-		// then request a full update so we can clear our queue
-		m_requestFullFramebufferUpdate = true;
+		return;
 	}
-}
 
+	m_connectionPool->releaseThread( connection->thread() );
 
-
-qint64 DemoServer::framebufferUpdateMessageQueueSize() const
-{
-	qint64 size = 0;
-
-	for( const auto& message : qAsConst( m_framebufferUpdateMessages ) )
-	{
-		size += message.size();
-	}
-
-	return size;
+	connection->deleteLater();
 }
 
 
 
-void DemoServer::start()
+void DemoServer::requestFramebufferUpdates()
 {
-	setVncServerPixelFormat();
-	setVncServerEncodings();
-
-	m_requestFullFramebufferUpdate = true;
-
-	requestFramebufferUpdate();
-
-	while( receiveVncServerMessage() )
+	for( auto rendition : qAsConst( m_renditions ) )
 	{
+		// do not let the VNC server encode renditions no client receives - the default rendition
+		// is kept up to date for new connections and multicast receivers though
+		if( rendition == m_defaultRendition || rendition->hasReaders() )
+		{
+			rendition->requestFramebufferUpdate();
+		}
 	}
-
-	acceptPendingConnections();
-}
-
-
-
-bool DemoServer::setVncServerPixelFormat()
-{
-	rfbPixelFormat format;
-
-	format.bitsPerPixel = 32;
-	format.depth = 32;
-	format.bigEndian = qFromBigEndian<uint16_t>( 1 ) == 1 ? true : false;
-	format.trueColour = 1;
-	format.redShift = 16;
-	format.greenShift = 8;
-	format.blueShift = 0;
-	format.redMax = 0xff;
-	format.greenMax = 0xff;
-	format.blueMax = 0xff;
-
-	return m_vncClientProtocol.setPixelFormat( format );
-}
-
-
-
-bool DemoServer::setVncServerEncodings()
-{
-	return m_vncClientProtocol.
-			setEncodings( {
-							  rfbEncodingUltraZip,
-							  rfbEncodingUltra,
-							  rfbEncodingCopyRect,
-							  rfbEncodingHextile,
-							  rfbEncodingCoRRE,
-							  rfbEncodingRRE,
-							  rfbEncodingRaw,
-							  rfbEncodingCompressLevel9,
-							  rfbEncodingQualityLevel7,
-							  rfbEncodingNewFBSize,
-							  rfbEncodingLastRect
-						  } );
 }
@@ -26,21 +26,21 @@
 #ifndef DEMO_SERVER_H
 #define DEMO_SERVER_H
 
-#include <QElapsedTimer>
-#include <QReadWriteLock>
 #include <QTimer>
+#include <QVector>
 
-#include "VncClientProtocol.h"
+#include "DemoRendition.h"
 
 class DemoConfiguration;
+class DemoMulticastSender;
+class DemoServerConnection;
 class QTcpServer;
+class VncConnectionPool;
 
 class DemoServer : public QObject
 {
 	Q_OBJECT
 public:
-	typedef QVector<QByteArray> MessageList;
-
 	DemoServer( int vncServerPort, const QString& vncServerPassword, const QString& demoAccessToken,
 				const DemoConfiguration& configuration, QObject *parent );
 	~DemoServer() override;
@@ -52,61 +52,54 @@ public:
 
 	const QByteArray& serverInitMessage() const
 	{
-		return m_vncClientProtocol.serverInitMessage();
+		return m_defaultRendition->serverInitMessage();
 	}
 
-	void lockDataForRead()
+	// rendition new connections start with and which is sent via multicast
+	DemoRendition* defaultRendition() const
 	{
-		m_dataLock.lockForRead();
+		return m_defaultRendition;
 	}
 
-	void unlockData()
+	// all renditions ordered by decreasing bandwidth requirements - list does
+	// not change after construction and thus may be accessed from any thread
+	const QVector<DemoRendition *>& renditions() const
 	{
-		m_dataLock.unlock();
+		return m_renditions;
 	}
 
-	int keyFrame() const
-	{
-		return m_keyFrame;
-	}
+	qint64 bufferedBytes() const;
 
-	const MessageList& framebufferUpdateMessages() const
-	{
-		return m_framebufferUpdateMessages;
-	}
+signals:
+	void framebufferUpdateMessagesAvailable();
 
 private slots:
 	void acceptPendingConnections();
-	void reconnectToVncServer();
-	void readFromVncServer();
-	void requestFramebufferUpdate();
+	void closeConnection( DemoServerConnection* connection );
+	void requestFramebufferUpdates();
 
 private:
-	bool receiveVncServerMessage();
-	void enqueueFramebufferUpdateMessage( const QByteArray& message );
-
-	qint64 framebufferUpdateMessageQueueSize() const;
+	enum {
+		MaximumRenditionScale = 3
+	};
 
-	void start();
-	bool setVncServerPixelFormat();
-	bool setVncServerEncodings();
+	// configured memory limit is shared by all renditions
+	qint64 renditionMemoryLimit() const;
 
 	const DemoConfiguration& m_configuration;
-	const int m_vncServerPort;
 	const QString m_demoAccessToken;
 
 	QTcpServer* m_tcpServer;
-	QTcpSocket* m_vncServerSocket;
-	VncClientProtocol m_vncClientProtocol;
 
-	QReadWriteLock m_dataLock;
+	QVector<DemoRendition *> m_renditions;
+	DemoRendition* m_defaultRendition;
+
+	VncConnectionPool* m_connectionPool;
+	QList<DemoServerConnection *> m_connections;
+
 	QTimer m_framebufferUpdateTimer;
-	QElapsedTimer m_lastFullFramebufferUpdate;
-	QElapsedTimer m_keyFrameTimer;
-	bool m_requestFullFramebufferUpdate;
 
-	int m_keyFrame;
-	MessageList m_framebufferUpdateMessages;
+	DemoMulticastSender* m_multicastSender;
 
 } ;
 
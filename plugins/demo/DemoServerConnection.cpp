@@ -24,16 +24,18 @@
  */
 
 #include <QTcpSocket>
+#include <QtEndian>
 
 #include "DemoConfiguration.h"
 #include "DemoServer.h"
 #include "DemoServerConnection.h"
+#include "VeyonRfbExt.h"
 
 
 DemoServerConnection::DemoServerConnection( const QString& demoAccessToken,
 											QTcpSocket* socket,
 											DemoServer* demoServer ) :
-	QObject( demoServer ),
+	QObject( nullptr ),
 	m_demoServer( demoServer ),
 	m_socket( socket ),
 	m_vncServerClient(),
@@ -44,26 +46,47 @@ DemoServerConnection::DemoServerConnection( const QString& demoAccessToken,
 									 std::pair<int, int>( rfbKeyEvent, sz_rfbKeyEventMsg ),
 									 std::pair<int, int>( rfbPointerEvent, sz_rfbPointerEventMsg ),
 									 } ),
-	m_keyFrame( -1 ),
-	m_framebufferUpdateMessageIndex( 0 ),
-	m_framebufferUpdateInterval( m_demoServer->configuration().framebufferUpdateInterval() )
+	m_framebufferUpdateSequence( -1 ),
+	m_framebufferUpdateRequested( false ),
+	m_framebufferUpdatePending( false ),
+	m_bufferedBytes( 0 ),
+	m_screenSize(),
+	m_rendition( demoServer->defaultRendition() ),
+	m_renditionIndex( demoServer->renditions().indexOf( m_rendition ) ),
+	m_bestRenditionIndex( m_renditionIndex ),
+	m_lagTimer(),
+	m_upgradeTimer(),
+	m_upgradeInterval( InitialUpgradeInterval )
 {
+	// move socket along with this connection to a connection thread
+	m_socket->setParent( this );
+
+	m_rendition->addReader();
+
 	connect( m_socket, &QTcpSocket::readyRead, this, &DemoServerConnection::processClient );
-	connect( m_socket, &QTcpSocket::disconnected, this, &DemoServerConnection::deleteLater );
+	connect( m_socket, &QTcpSocket::bytesWritten, this, &DemoServerConnection::processBytesWritten );
 
 	m_serverProtocol.setServerInitMessage( m_demoServer->serverInitMessage() );
-	m_serverProtocol.start();
 }
 
 
 
 DemoServerConnection::~DemoServerConnection()
 {
+	m_rendition->removeReader();
+
 	delete m_socket;
 }
 
 
 
+void DemoServerConnection::start()
+{
+	m_serverProtocol.start();
+}
+
+
+
 void DemoServerConnection::processClient()
 {
 	if( m_serverProtocol.state() != VncServerProtocol::Running )
@@ -112,6 +135,18 @@ bool DemoServerConnection::receiveClientMessage()
 		}
 		break;
 
+	case rfbVeyonScreenSizeMessage:
+		if( m_socket->bytesAvailable() >= sz_rfbVeyonScreenSizeMsg )
+		{
+			rfbVeyonScreenSizeMsg screenSizeMessage;
+			if( m_socket->read( reinterpret_cast<char *>( &screenSizeMessage ), sz_rfbVeyonScreenSizeMsg ) == sz_rfbVeyonScreenSizeMsg ) // Flawfinder: ignore
+			{
+				selectRenditions( QSize( qFromBigEndian( screenSizeMessage.width ), qFromBigEndian( screenSizeMessage.height ) ) );
+				return true;
+			}
+		}
+		break;
+
 	default:
 		if( m_rfbClientToServerMessageSizes.contains( messageType ) == false )
 		{
@@ -130,6 +165,8 @@ bool DemoServerConnection::receiveClientMessage()
 
 		if( messageType == rfbFramebufferUpdateRequest )
 		{
+			m_framebufferUpdateRequested = true;
+
 			sendFramebufferUpdate();
 		}
 
@@ -141,33 +178,205 @@ bool DemoServerConnection::receiveClientMessage()
 
 
 
+void DemoServerConnection::updateBufferedBytes()
+{
+	m_bufferedBytes = static_cast<int>( qMin<qint64>( m_socket->bytesToWrite(), INT_MAX ) );
+}
+
+
+
+void DemoServerConnection::processBytesWritten()
+{
+	updateBufferedBytes();
+
+	if( m_framebufferUpdatePending && m_socket->bytesToWrite() < MaximumBytesToWrite )
+	{
+		m_framebufferUpdatePending = false;
+
+		sendFramebufferUpdate();
+	}
+}
+
+
+
 void DemoServerConnection::sendFramebufferUpdate()
 {
-	m_demoServer->lockDataForRead();
+	if( m_framebufferUpdateRequested == false )
+	{
+		return;
+	}
+
+	if( m_socket->bytesToWrite() >= MaximumBytesToWrite )
+	{
+		// client can't keep up so do not queue any further updates but continue
+		// once it has received buffered data - all updates enqueued in the meantime
+		// are sent at once then or skipped in favour of a newer key frame
+		m_framebufferUpdatePending = true;
+		adaptRendition( true );
+		return;
+	}
 
-	const auto& framebufferUpdateMessages = m_demoServer->framebufferUpdateMessages();
+	const auto& framebufferUpdateLog = m_rendition->framebufferUpdateLog();
 
-	const int framebufferUpdateMessageCount = framebufferUpdateMessages.count();
+	DemoFramebufferUpdateLog::MessageList framebufferUpdateMessages;
+	qint64 maxSize = MaximumBytesToWrite - m_socket->bytesToWrite();
 
-	if( m_demoServer->keyFrame() != m_keyFrame ||
-			m_framebufferUpdateMessageIndex > framebufferUpdateMessageCount )
+	const auto backlog = m_framebufferUpdateSequence >= 0 ?
+							 framebufferUpdateLog.sizeSince( m_framebufferUpdateSequence ) : -1;
+
+	if( backlog < 0 || backlog > framebufferUpdateLog.keyFrameSize() )
 	{
-		m_framebufferUpdateMessageIndex = 0;
-		m_keyFrame = m_demoServer->keyFrame();
+		// client just started, switched renditions or lags behind so send the region it
+		// is missing encoded from the current framebuffer which is never larger than the screen
+		const auto message = m_rendition->encodeUpdatesSince( m_framebufferUpdateSequence );
+		if( message.isEmpty() == false )
+		{
+			framebufferUpdateMessages.append( message );
+			maxSize -= message.size();
+		}
 	}
 
-	bool sentUpdates = false;
-	for( ; m_framebufferUpdateMessageIndex < framebufferUpdateMessageCount; ++m_framebufferUpdateMessageIndex )
+	const bool moreUpdatesAvailable =
+			framebufferUpdateLog.read( m_framebufferUpdateSequence, framebufferUpdateMessages, maxSize );
+
+	for( const auto& message : qAsConst( framebufferUpdateMessages ) )
 	{
-		m_socket->write( framebufferUpdateMessages[m_framebufferUpdateMessageIndex] );
-		sentUpdates = true;
+		m_socket->write( message );
 	}
 
-	m_demoServer->unlockData();
+	updateBufferedBytes();
 
-	if( sentUpdates == false )
+	if( moreUpdatesAvailable )
 	{
-		// did not send updates but client still waiting for update? then try again soon
-		QTimer::singleShot( m_framebufferUpdateInterval, this, &DemoServerConnection::sendFramebufferUpdate );
+		// send remaining updates as soon as the socket has drained
+		m_framebufferUpdatePending = true;
 	}
+	else if( framebufferUpdateMessages.isEmpty() == false )
+	{
+		m_framebufferUpdateRequested = false;
+	}
+
+	// otherwise client still waits for an update which is sent as soon as
+	// the demo server signals new framebuffer update messages
+
+	adaptRendition( moreUpdatesAvailable );
+}
+
+
+
+void DemoServerConnection::selectRenditions( const QSize& screenSize )
+{
+	const auto& renditions = m_demoServer->renditions();
+
+	m_screenSize = screenSize;
+
+	// use the most downscaled rendition which still covers the client's screen so we
+	// neither send more pixels than it can display nor make it scale up updates
+	int scale = 1;
+
+	for( auto rendition : renditions )
+	{
+		const auto framebufferSize = rendition->framebufferSize();
+
+		if( rendition->scale() > scale &&
+				( framebufferSize.width() >= screenSize.width() || framebufferSize.height() >= screenSize.height() ) )
+		{
+			scale = rendition->scale();
+		}
+	}
+
+	int index = -1;
+	m_bestRenditionIndex = -1;
+
+	for( int i = 0; i < renditions.size(); ++i )
+	{
+		if( renditions[i]->scale() == scale )
+		{
+			if( m_bestRenditionIndex < 0 )
+			{
+				m_bestRenditionIndex = i;
+			}
+
+			// start with JPEG compressed updates and switch to lossless ones only if the client keeps up
+			if( index < 0 && renditions[i]->isLossless() == false )
+			{
+				index = i;
+			}
+		}
+	}
+
+	qDebug() << Q_FUNC_INFO << "client screen size:" << screenSize << "scale:" << scale;
+
+	m_upgradeTimer.restart();
+
+	switchRendition( index );
+}
+
+
+
+void DemoServerConnection::adaptRendition( bool lagging )
+{
+	if( m_screenSize.isEmpty() )
+	{
+		// client did not report its screen size (e.g. as it receives updates via multicast)
+		return;
+	}
+
+	if( lagging )
+	{
+		if( m_lagTimer.isValid() == false )
+		{
+			m_lagTimer.start();
+		}
+		else if( m_lagTimer.hasExpired( DowngradeLagTime ) && switchRendition( m_renditionIndex + 1 ) )
+		{
+			// client could not keep up so wait longer before trying a more demanding rendition again
+			m_upgradeInterval = qMin<int>( m_upgradeInterval * 2, MaximumUpgradeInterval );
+		}
+
+		return;
+	}
+
+	// short lags occur when sending key frames so only consider sustained ones
+	if( m_lagTimer.isValid() && m_lagTimer.hasExpired( SustainedLagTime ) )
+	{
+		m_upgradeTimer.restart();
+	}
+
+	m_lagTimer.invalidate();
+
+	if( m_renditionIndex > m_bestRenditionIndex && m_upgradeTimer.hasExpired( m_upgradeInterval ) )
+	{
+		switchRendition( m_renditionIndex - 1 );
+	}
+}
+
+
+
+bool DemoServerConnection::switchRendition( int index )
+{
+	const auto& renditions = m_demoServer->renditions();
+
+	// rendition has to provide a key frame to start with
+	if( index < 0 || index >= renditions.size() || index == m_renditionIndex ||
+			renditions[index]->framebufferSize().isEmpty() )
+	{
+		return false;
+	}
+
+	qDebug() << Q_FUNC_INFO << "switching to rendition with scale" << renditions[index]->scale()
+			 << "lossless:" << renditions[index]->isLossless();
+
+	m_rendition->removeReader();
+	m_rendition = renditions[index];
+	m_rendition->addReader();
+	m_renditionIndex = index;
+
+	// continue with full framebuffer of new rendition
+	m_framebufferUpdateSequence = -1;
+
+	m_lagTimer.invalidate();
+	m_upgradeTimer.restart();
+
+	return true;
 }
@@ -25,32 +25,57 @@
 #ifndef DEMO_SERVER_CONNECTION_H
 #define DEMO_SERVER_CONNECTION_H
 
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QSize>
+
+#include "DemoFramebufferUpdateLog.h"
 #include "DemoServerProtocol.h"
 
+class DemoRendition;
 class DemoServer;
 
 // clazy:excludeall=ctor-missing-parent-argument
 
-// the demo server creates an instance of this class for each client connection,
-// i.e. each client is connected to a different server thread for best
-// performance
+// the demo server creates an instance of this class for each client connection
+// and moves it to one of the threads of its connection pool for best performance
 class DemoServerConnection : public QObject
 {
 	Q_OBJECT
 public:
 	enum {
 		ProtocolRetryTime = 250,
+		MaximumBytesToWrite = 2*1024*1024,
+		SustainedLagTime = 1000,				// in milliseconds
+		DowngradeLagTime = 3000,				// in milliseconds
+		InitialUpgradeInterval = 30000,			// in milliseconds
+		MaximumUpgradeInterval = 600000			// in milliseconds
 	};
 
 	DemoServerConnection( const QString& demoAccessToken, QTcpSocket* socket, DemoServer* demoServer );
 	~DemoServerConnection() override;
 
+	// number of bytes not yet written to the client - may be queried from any thread
+	qint64 bufferedBytes() const
+	{
+		return m_bufferedBytes.load();
+	}
+
 public slots:
+	void start();
 	void processClient();
 	void sendFramebufferUpdate();
 
+private slots:
+	void processBytesWritten();
+
 private:
 	bool receiveClientMessage();
+	void updateBufferedBytes();
+
+	void selectRenditions( const QSize& screenSize );
+	void adaptRendition( bool lagging );
+	bool switchRendition( int index );
 
 	DemoServer* m_demoServer;
 
@@ -61,10 +86,20 @@ private:
 
 	const QMap<int, int> m_rfbClientToServerMessageSizes;
 
-	int m_keyFrame;
-	int m_framebufferUpdateMessageIndex;
+	DemoFramebufferUpdateLog::Sequence m_framebufferUpdateSequence;
+	bool m_framebufferUpdateRequested;
+	bool m_framebufferUpdatePending;
+
+	QAtomicInt m_bufferedBytes;
 
-	const int m_framebufferUpdateInterval;
+	// renditions are adapted only after the client reported its screen size
+	QSize m_screenSize;
+	DemoRendition* m_rendition;
+	int m_renditionIndex;
+	int m_bestRenditionIndex;
+	QElapsedTimer m_lagTimer;
+	QElapsedTimer m_upgradeTimer;
+	int m_upgradeInterval;
 
 } ;
 
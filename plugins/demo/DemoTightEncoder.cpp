@@ -0,0 +1,284 @@
+/*
+ * DemoTightEncoder.cpp - implementation of DemoTightEncoder class
+ *
+ * Copyright (c) 2018 Tobias Junghans <tobydox@veyon.io>
+ *
+ * This file is part of Veyon - http://veyon.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include <QBuffer>
+#include <QDebug>
+#include <QImageWriter>
+#include <QtEndian>
+
+#include <zlib.h>
+
+#include "rfb/rfbproto.h"
+
+#include "DemoTightEncoder.h"
+#include "VeyonCore.h"
+
+
+DemoTightEncoder::DemoTightEncoder( bool lossless, int qualityLevel ) :
+	m_lossless( lossless ),
+	m_jpegQuality( jpegQuality( qualityLevel ) )
+{
+}
+
+
+
+QByteArray DemoTightEncoder::encode( const QImage& framebuffer, const QRegion& region ) const
+{
+	const auto rects = splitRegion( region.intersected( framebuffer.rect() ) );
+	if( rects.isEmpty() || rects.size() > 0xffff )
+	{
+		return QByteArray();
+	}
+
+	z_stream zlibStream;
+	memset( &zlibStream, 0, sizeof(zlibStream) );
+
+	if( deflateInit( &zlibStream, ZlibCompressionLevel ) != Z_OK )
+	{
+		qCritical() << Q_FUNC_INFO << "could not initialize zlib stream";
+		return QByteArray();
+	}
+
+	rfbFramebufferUpdateMsg updateMessage;
+	updateMessage.type = rfbFramebufferUpdate;
+	updateMessage.pad = 0;
+	updateMessage.nRects = qToBigEndian<uint16_t>( static_cast<uint16_t>( rects.size() ) );
+
+	QByteArray message( reinterpret_cast<const char *>( &updateMessage ), sz_rfbFramebufferUpdateMsg );
+
+	for( const auto& rect : rects )
+	{
+		rfbFramebufferUpdateRectHeader rectHeader;
+		rectHeader.r.x = qToBigEndian<uint16_t>( static_cast<uint16_t>( rect.x() ) );
+		rectHeader.r.y = qToBigEndian<uint16_t>( static_cast<uint16_t>( rect.y() ) );
+		rectHeader.r.w = qToBigEndian<uint16_t>( static_cast<uint16_t>( rect.width() ) );
+		rectHeader.r.h = qToBigEndian<uint16_t>( static_cast<uint16_t>( rect.height() ) );
+		rectHeader.encoding = qToBigEndian<uint32_t>( rfbEncodingTight );
+
+		message.append( reinterpret_cast<const char *>( &rectHeader ), sz_rfbFramebufferUpdateRectHeader );
+
+		encodeRect( framebuffer, rect, &zlibStream, message );
+	}
+
+	deflateEnd( &zlibStream );
+
+	return message;
+}
+
+
+
+QVector<QRect> DemoTightEncoder::splitRegion( const QRegion& region ) const
+{
+	if( region.rectCount() > MaximumRegionRects )
+	{
+		// overhead of many small rects outweighs the additional pixels of the bounding rect
+		return splitRegion( region.boundingRect() );
+	}
+
+	QVector<QRect> rects;
+
+	// limit rects to a size each client can decode and whose compressed data length fits into Tight's compact length
+	for( const auto& rect : regionRects( region ) )
+	{
+		const int width = qMin<int>( rect.width(), MaximumRectWidth );
+		const int height = qMax<int>( 1, MaximumRectSize / width );
+
+		for( int y = rect.top(); y <= rect.bottom(); y += height )
+		{
+			for( int x = rect.left(); x <= rect.right(); x += width )
+			{
+				rects.append( QRect( x, y, width, height ).intersected( rect ) );
+			}
+		}
+	}
+
+	return rects;
+}
+
+
+
+void DemoTightEncoder::encodeRect( const QImage& framebuffer, const QRect& rect, z_stream* zlibStream, QByteArray& data ) const
+{
+	if( encodeFillRect( framebuffer, rect, data ) )
+	{
+		return;
+	}
+
+	if( m_lossless == false && rect.width() * rect.height() >= MinimumJpegRectSize &&
+			encodeJpegRect( framebuffer, rect, data ) )
+	{
+		return;
+	}
+
+	if( encodeBasicRect( framebuffer, rect, zlibStream, data ) == false )
+	{
+		// keep message decodable at the expense of this rect's contents
+		qCritical() << Q_FUNC_INFO << "could not compress rect" << rect;
+
+		data.append( static_cast<char>( rfbTightFill << 4 ) );
+		data.append( QByteArray( PixelSize, 0 ) );
+	}
+}
+
+
+
+bool DemoTightEncoder::encodeFillRect( const QImage& framebuffer, const QRect& rect, QByteArray& data ) const
+{
+	const auto firstPixel = reinterpret_cast<const QRgb *>( framebuffer.constScanLine( rect.y() ) )[rect.x()];
+
+	for( int y = rect.top(); y <= rect.bottom(); ++y )
+	{
+		const auto line = reinterpret_cast<const QRgb *>( framebuffer.constScanLine( y ) );
+
+		for( int x = rect.left(); x <= rect.right(); ++x )
+		{
+			if( ( line[x] ^ firstPixel ) & RGB_MASK )
+			{
+				return false;
+			}
+		}
+	}
+
+	char fillData[1+PixelSize];
+	fillData[0] = static_cast<char>( rfbTightFill << 4 );
+	writePixel( firstPixel, fillData + 1 );
+
+	data.append( fillData, sizeof(fillData) );
+
+	return true;
+}
+
+
+
+bool DemoTightEncoder::encodeJpegRect( const QImage& framebuffer, const QRect& rect, QByteArray& data ) const
+{
+	QByteArray jpegData;
+	QBuffer buffer( &jpegData );
+	buffer.open( QIODevice::WriteOnly );
+
+	QImageWriter writer( &buffer, "JPEG" );
+	writer.setQuality( m_jpegQuality );
+
+	if( writer.write( framebuffer.copy( rect ) ) == false )
+	{
+		// e.g. image format plugin not available so fall back to lossless compression
+		return false;
+	}
+
+	data.append( static_cast<char>( rfbTightJpeg << 4 ) );
+	appendCompactLength( jpegData.size(), data );
+	data.append( jpegData );
+
+	return true;
+}
+
+
+
+bool DemoTightEncoder::encodeBasicRect( const QImage& framebuffer, const QRect& rect, z_stream* zlibStream, QByteArray& data ) const
+{
+	const int dataSize = rect.width() * rect.height() * PixelSize;
+
+	QByteArray pixelData( dataSize, Qt::Uninitialized );
+	auto pixel = pixelData.data();
+
+	for( int y = rect.top(); y <= rect.bottom(); ++y )
+	{
+		const auto line = reinterpret_cast<const QRgb *>( framebuffer.constScanLine( y ) );
+
+		for( int x = rect.left(); x <= rect.right(); ++x )
+		{
+			writePixel( line[x], pixel );
+			pixel += PixelSize;
+		}
+	}
+
+	if( dataSize < MinimumDataSizeToCompress )
+	{
+		// small amounts of data are sent uncompressed using the copy filter
+		data.append( static_cast<char>( 0 ) );
+		data.append( pixelData );
+		return true;
+	}
+
+	// start a new zlib stream which receivers are told to start over with as well
+	deflateReset( zlibStream );
+
+	QByteArray compressedData( static_cast<int>( deflateBound( zlibStream, static_cast<uLong>( dataSize ) ) ) + ZlibFlushMargin,
+							   Qt::Uninitialized );
+
+	zlibStream->next_in = reinterpret_cast<Bytef *>( pixelData.data() );
+	zlibStream->avail_in = static_cast<uInt>( dataSize );
+	zlibStream->next_out = reinterpret_cast<Bytef *>( compressedData.data() );
+	zlibStream->avail_out = static_cast<uInt>( compressedData.size() );
+
+	if( deflate( zlibStream, Z_SYNC_FLUSH ) != Z_OK || zlibStream->avail_in > 0 || zlibStream->avail_out == 0 )
+	{
+		return false;
+	}
+
+	compressedData.truncate( compressedData.size() - static_cast<int>( zlibStream->avail_out ) );
+
+	data.append( static_cast<char>( ZlibStreamReset ) );
+	appendCompactLength( compressedData.size(), data );
+	data.append( compressedData );
+
+	return true;
+}
+
+
+
+int DemoTightEncoder::jpegQuality( int qualityLevel )
+{
+	// JPEG quality per Tight quality level as used by common VNC servers
+	static const int jpegQualities[] = { 15, 29, 41, 42, 62, 77, 79, 86, 92, 100 };
+
+	return jpegQualities[qBound( 0, qualityLevel, 9 )];
+}
+
+
+
+void DemoTightEncoder::writePixel( QRgb pixel, char* data )
+{
+	// Tight transfers pixels with depth 24 as RGB triplets
+	data[0] = static_cast<char>( qRed( pixel ) );
+	data[1] = static_cast<char>( qGreen( pixel ) );
+	data[2] = static_cast<char>( qBlue( pixel ) );
+}
+
+
+
+void DemoTightEncoder::appendCompactLength( int length, QByteArray& data )
+{
+	data.append( static_cast<char>( ( length & 0x7f ) | ( length > 0x7f ? 0x80 : 0 ) ) );
+
+	if( length > 0x7f )
+	{
+		data.append( static_cast<char>( ( ( length >> 7 ) & 0x7f ) | ( length > 0x3fff ? 0x80 : 0 ) ) );
+
+		if( length > 0x3fff )
+		{
+			data.append( static_cast<char>( ( length >> 14 ) & 0xff ) );
+		}
+	}
+}
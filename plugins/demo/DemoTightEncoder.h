@@ -0,0 +1,76 @@
+/*
+ * DemoTightEncoder.h - header file for DemoTightEncoder class
+ *
+ * Copyright (c) 2018 Tobias Junghans <tobydox@veyon.io>
+ *
+ * This file is part of Veyon - http://veyon.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef DEMO_TIGHT_ENCODER_H
+#define DEMO_TIGHT_ENCODER_H
+
+#include <QImage>
+#include <QRegion>
+
+typedef struct z_stream_s z_stream;
+
+/** \brief Encodes regions of a framebuffer image as Tight encoded framebuffer update messages
+ *
+ * Unlike a VNC server, the encoder does not continue zlib streams across rects. Each rect resets
+ * the zlib stream it uses, so every message can be decoded without any previous messages. Pixels
+ * are sent for clients with 32 bits per pixel and depth 24. The encoder has no state and thus may
+ * be used from any thread.
+ */
+class DemoTightEncoder
+{
+public:
+	DemoTightEncoder( bool lossless, int qualityLevel );
+
+	QByteArray encode( const QImage& framebuffer, const QRegion& region ) const;
+
+private:
+	enum {
+		MaximumRegionRects = 64,
+		MaximumRectWidth = 2048,
+		MaximumRectSize = 65536,
+		MinimumJpegRectSize = 256,
+		MinimumDataSizeToCompress = 12,
+		ZlibCompressionLevel = 6,
+		ZlibFlushMargin = 64,
+		ZlibStreamReset = 0x01,	// reset bit of stream 0 in compression control byte
+		PixelSize = 3
+	};
+
+	QVector<QRect> splitRegion( const QRegion& region ) const;
+
+	void encodeRect( const QImage& framebuffer, const QRect& rect, z_stream* zlibStream, QByteArray& data ) const;
+	bool encodeFillRect( const QImage& framebuffer, const QRect& rect, QByteArray& data ) const;
+	bool encodeJpegRect( const QImage& framebuffer, const QRect& rect, QByteArray& data ) const;
+	bool encodeBasicRect( const QImage& framebuffer, const QRect& rect, z_stream* zlibStream, QByteArray& data ) const;
+
+	static int jpegQuality( int qualityLevel );
+	static void writePixel( QRgb pixel, char* data );
+	static void appendCompactLength( int length, QByteArray& data );
+
+	const bool m_lossless;
+	const int m_jpegQuality;
+
+} ;
+
+#endif
@@ -36,28 +36,49 @@ ComputerControlClient::ComputerControlClient( ComputerControlServer* server,
 											  QObject* parent ) :
 	VncProxyConnection( clientSocket, vncServerPort, parent ),
 	m_server( server ),
-	m_serverClient(),
+	m_serverClient( this ),
 	m_serverProtocol( clientSocket,
 					  &m_serverClient,
 					  server->authenticationManager(),
 					  server->accessControlManager() ),
-	m_clientProtocol( vncServerSocket(), vncServerPassword )
+	m_clientProtocol( vncServerSocket(), vncServerPassword ),
+	m_clientSupportsThumbnails( false ),
+	m_clientSupportsNewFBSize( false ),
+	m_thumbnailEncoder(),
+	m_thumbnailModeEnabled( false ),
+	m_thumbnailUpdateRequested( false ),
+	m_pendingFeatureMessagesMutex(),
+	m_pendingFeatureMessages()
 {
-	m_serverProtocol.start();
-	m_clientProtocol.start();
+	m_server->addClient( this );
 }
 
 
 
 ComputerControlClient::~ComputerControlClient()
 {
+	m_server->removeClient( this );
+
 	m_server->accessControlManager().removeClient( &m_serverClient );
 }
 
 
 
+void ComputerControlClient::start()
+{
+	m_serverProtocol.start();
+	m_clientProtocol.start();
+
+	VncProxyConnection::start();
+}
+
+
+
 bool ComputerControlClient::receiveClientMessage()
 {
+	// also called at server message boundaries so send messages deferred until then
+	sendPendingFeatureMessages();
+
 	auto socket = proxyClientSocket();
 
 	char messageType = 0;
@@ -66,10 +87,395 @@ bool ComputerControlClient::receiveClientMessage()
 		return false;
 	}
 
-	if( messageType == rfbVeyonFeatureMessage )
+	switch( messageType )
 	{
+	case rfbVeyonFeatureMessage:
+	case rfbVeyonThumbnailMessage:
+	case rfbSetEncodings:
+		// handling these messages writes data to the client so wait until
+		// it has received the current framebuffer update completely
+		if( deferUntilServerMessageBoundary() )
+		{
+			return false;
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	switch( messageType )
+	{
+	case rfbVeyonFeatureMessage:
 		return m_server->handleFeatureMessage( socket );
+
+	case rfbVeyonThumbnailMessage:
+		return receiveThumbnailMessage();
+
+	case rfbSetPixelFormat:
+		return receiveSetPixelFormatMessage();
+
+	case rfbSetEncodings:
+		return receiveSetEncodingsMessage();
+
+	case rfbFramebufferUpdateRequest:
+		if( m_thumbnailModeEnabled )
+		{
+			return receiveFramebufferUpdateRequestMessage();
+		}
+		break;
+
+	default:
+		break;
 	}
 
 	return VncProxyConnection::receiveClientMessage();
 }
+
+
+
+bool ComputerControlClient::receiveServerMessage()
+{
+	if( m_thumbnailModeEnabled == false )
+	{
+		return VncProxyConnection::receiveServerMessage();
+	}
+
+	if( m_clientProtocol.receiveMessage() == false )
+	{
+		return false;
+	}
+
+	switch( m_clientProtocol.lastMessageType() )
+	{
+	case rfbFramebufferUpdate:
+		if( m_thumbnailEncoder.applyFramebufferUpdate( m_clientProtocol.lastMessage() ) == false )
+		{
+			// update could not be applied completely so request full update
+			m_clientProtocol.requestFramebufferUpdate( false );
+		}
+		sendThumbnailUpdate();
+		break;
+
+	case rfbResizeFrameBuffer:
+		m_thumbnailEncoder.setFramebufferSize( m_clientProtocol.framebufferWidth(), m_clientProtocol.framebufferHeight() );
+		m_clientProtocol.requestFramebufferUpdate( false );
+		break;
+
+	default:
+		proxyClientSocket()->write( m_clientProtocol.lastMessage() );
+		break;
+	}
+
+	return true;
+}
+
+
+
+void ComputerControlClient::sendFeatureMessage( const FeatureMessage& message )
+{
+	m_pendingFeatureMessagesMutex.lock();
+	m_pendingFeatureMessages.append( message );
+	m_pendingFeatureMessagesMutex.unlock();
+
+	QMetaObject::invokeMethod( this, "sendPendingFeatureMessages", Qt::QueuedConnection );
+}
+
+
+
+void ComputerControlClient::sendPendingFeatureMessages()
+{
+	QMutexLocker locker( &m_pendingFeatureMessagesMutex );
+
+	if( m_pendingFeatureMessages.isEmpty() ||
+			serverProtocol().state() != VncServerProtocol::Running ||
+			deferUntilServerMessageBoundary() )
+	{
+		return;
+	}
+
+	auto socket = proxyClientSocket();
+
+	for( const auto& message : qAsConst( m_pendingFeatureMessages ) )
+	{
+		const char rfbMessageType = rfbVeyonFeatureMessage;
+		socket->write( &rfbMessageType, sizeof(rfbMessageType) );
+		message.send( socket );
+	}
+
+	m_pendingFeatureMessages.clear();
+}
+
+
+
+bool ComputerControlClient::receiveSetPixelFormatMessage()
+{
+	auto socket = proxyClientSocket();
+
+	if( socket->bytesAvailable() < sz_rfbSetPixelFormatMsg )
+	{
+		return false;
+	}
+
+	setClientSetPixelFormatMessage( socket->peek( sz_rfbSetPixelFormatMsg ) );
+
+	if( m_thumbnailModeEnabled == false )
+	{
+		return VncProxyConnection::receiveClientMessage();
+	}
+
+	// do not forward as server has to keep sending in our pixel format
+	socket->read( sz_rfbSetPixelFormatMsg ); // Flawfinder: ignore
+
+	if( VncThumbnailEncoder::isPixelFormatSupported( clientPixelFormat() ) )
+	{
+		m_thumbnailEncoder.setClientPixelFormat( clientPixelFormat() );
+		m_thumbnailEncoder.invalidateThumbnail();
+	}
+	else
+	{
+		stopThumbnailMode();
+	}
+
+	return true;
+}
+
+
+
+bool ComputerControlClient::receiveSetEncodingsMessage()
+{
+	auto socket = proxyClientSocket();
+
+	rfbSetEncodingsMsg setEncodingsMessage;
+	if( socket->bytesAvailable() < sz_rfbSetEncodingsMsg ||
+			socket->peek( reinterpret_cast<char *>( &setEncodingsMessage ), sz_rfbSetEncodingsMsg ) != sz_rfbSetEncodingsMsg )
+	{
+		return false;
+	}
+
+	const auto nEncodings = qFromBigEndian( setEncodingsMessage.nEncodings );
+	if( nEncodings > MAX_ENCODINGS )
+	{
+		// let default implementation handle the error
+		return VncProxyConnection::receiveClientMessage();
+	}
+
+	const qint64 messageSize = sz_rfbSetEncodingsMsg + nEncodings * sizeof(uint32_t);
+	if( socket->bytesAvailable() < messageSize )
+	{
+		return false;
+	}
+
+	setClientSetEncodingsMessage( socket->peek( messageSize ) );
+	m_clientSupportsThumbnails = false;
+	m_clientSupportsNewFBSize = false;
+
+	const auto encodings = reinterpret_cast<const uchar *>( clientSetEncodingsMessage().constData() + sz_rfbSetEncodingsMsg );
+
+	for( int i = 0; i < nEncodings; ++i )
+	{
+		switch( qFromBigEndian<uint32_t>( encodings + i * sizeof(uint32_t) ) )
+		{
+		case rfbEncodingVeyonThumbnail: m_clientSupportsThumbnails = true; break;
+		case rfbEncodingNewFBSize: m_clientSupportsNewFBSize = true; break;
+		default: break;
+		}
+	}
+
+	if( m_clientSupportsThumbnails )
+	{
+		// acknowledge that we're able to send thumbnails
+		rfbVeyonThumbnailMsg thumbnailMessage;
+		thumbnailMessage.type = rfbVeyonThumbnailMessage;
+		thumbnailMessage.pad = 0;
+		thumbnailMessage.width = 0;
+		thumbnailMessage.height = 0;
+
+		socket->write( reinterpret_cast<const char *>( &thumbnailMessage ), sz_rfbVeyonThumbnailMsg );
+	}
+
+	if( m_thumbnailModeEnabled == false )
+	{
+		return VncProxyConnection::receiveClientMessage();
+	}
+
+	// do not forward as server has to keep sending raw updates
+	socket->read( messageSize ); // Flawfinder: ignore
+
+	if( m_clientSupportsThumbnails == false || m_clientSupportsNewFBSize == false )
+	{
+		stopThumbnailMode();
+	}
+
+	return true;
+}
+
+
+
+bool ComputerControlClient::receiveThumbnailMessage()
+{
+	auto socket = proxyClientSocket();
+
+	rfbVeyonThumbnailMsg thumbnailMessage;
+	if( socket->bytesAvailable() < sz_rfbVeyonThumbnailMsg ||
+			socket->read( reinterpret_cast<char *>( &thumbnailMessage ), sz_rfbVeyonThumbnailMsg ) != sz_rfbVeyonThumbnailMsg ) // Flawfinder: ignore
+	{
+		return false;
+	}
+
+	const QSize thumbnailSize( qFromBigEndian( thumbnailMessage.width ), qFromBigEndian( thumbnailMessage.height ) );
+
+	if( thumbnailSize.isEmpty() )
+	{
+		stopThumbnailMode();
+	}
+	else
+	{
+		startThumbnailMode( thumbnailSize );
+	}
+
+	return true;
+}
+
+
+
+bool ComputerControlClient::receiveFramebufferUpdateRequestMessage()
+{
+	auto socket = proxyClientSocket();
+
+	rfbFramebufferUpdateRequestMsg updateRequest;
+	if( socket->bytesAvailable() < sz_rfbFramebufferUpdateRequestMsg ||
+			socket->read( reinterpret_cast<char *>( &updateRequest ), sz_rfbFramebufferUpdateRequestMsg ) != sz_rfbFramebufferUpdateRequestMsg ) // Flawfinder: ignore
+	{
+		return false;
+	}
+
+	m_thumbnailUpdateRequested = true;
+
+	if( updateRequest.incremental == 0 )
+	{
+		m_thumbnailEncoder.invalidateThumbnail();
+	}
+
+	// request changes of native framebuffer from server
+	m_clientProtocol.requestFramebufferUpdate( m_thumbnailEncoder.hasValidFramebuffer() );
+
+	sendThumbnailUpdate();
+
+	return true;
+}
+
+
+
+rfbPixelFormat ComputerControlClient::clientPixelFormat() const
+{
+	rfbPixelFormat format;
+
+	if( clientSetPixelFormatMessage().size() >= sz_rfbSetPixelFormatMsg )
+	{
+		rfbSetPixelFormatMsg setPixelFormatMessage;
+		memcpy( &setPixelFormatMessage, clientSetPixelFormatMessage().constData(), sz_rfbSetPixelFormatMsg ); // Flawfinder: ignore
+		format = setPixelFormatMessage.format;
+	}
+	else
+	{
+		// client did not set a pixel format so it uses the one of the server
+		rfbServerInitMsg serverInitMessage;
+		memcpy( &serverInitMessage, m_clientProtocol.serverInitMessage().constData(), sz_rfbServerInitMsg ); // Flawfinder: ignore
+		format = serverInitMessage.format;
+	}
+
+	format.redMax = qFromBigEndian( format.redMax );
+	format.greenMax = qFromBigEndian( format.greenMax );
+	format.blueMax = qFromBigEndian( format.blueMax );
+
+	return format;
+}
+
+
+
+void ComputerControlClient::startThumbnailMode( QSize thumbnailSize )
+{
+	if( m_clientSupportsNewFBSize == false ||
+			VncThumbnailEncoder::isPixelFormatSupported( clientPixelFormat() ) == false )
+	{
+		qWarning( "ComputerControlClient::startThumbnailMode(): client does not support NewFBSize encoding or pixel format" );
+		return;
+	}
+
+	m_thumbnailEncoder.setThumbnailSize( thumbnailSize );
+	m_thumbnailEncoder.setClientPixelFormat( clientPixelFormat() );
+
+	if( m_thumbnailModeEnabled )
+	{
+		sendThumbnailUpdate();
+		return;
+	}
+
+	m_thumbnailModeEnabled = true;
+
+	// client always waits for an initial update after requesting thumbnails
+	m_thumbnailUpdateRequested = true;
+
+	// receive framebuffer from server in raw format so we can scale it
+	m_thumbnailEncoder.setFramebufferSize( m_clientProtocol.framebufferWidth(), m_clientProtocol.framebufferHeight() );
+
+	// receive complete updates as they have to be scaled instead of forwarded
+	m_clientProtocol.setForwardingDevice( nullptr );
+
+	// thumbnails are generated from updates received through own connection
+	unsubscribeFromSharedConnection();
+
+	m_clientProtocol.setPixelFormat( VncThumbnailEncoder::nativePixelFormat() );
+	m_clientProtocol.setEncodings( { rfbEncodingRaw, rfbEncodingNewFBSize } );
+	m_clientProtocol.requestFramebufferUpdate( false );
+}
+
+
+
+void ComputerControlClient::stopThumbnailMode()
+{
+	if( m_thumbnailModeEnabled == false )
+	{
+		return;
+	}
+
+	m_thumbnailModeEnabled = false;
+	m_thumbnailEncoder.setThumbnailSize( QSize() );
+
+	// restore pixel format and encodings requested by client
+	m_clientProtocol.setPixelFormat( clientPixelFormat() );
+	if( clientSetEncodingsMessage().isEmpty() == false )
+	{
+		vncServerSocket()->write( clientSetEncodingsMessage() );
+	}
+
+	// let client resize its framebuffer to native size - it requests a full update afterwards
+	rfbFramebufferUpdateMsg updateMessage;
+	updateMessage.type = rfbFramebufferUpdate;
+	updateMessage.pad = 0;
+	updateMessage.nRects = qToBigEndian<uint16_t>( 1 );
+
+	rfbFramebufferUpdateRectHeader rectHeader;
+	rectHeader.encoding = qToBigEndian<uint32_t>( rfbEncodingNewFBSize );
+	rectHeader.r.x = 0;
+	rectHeader.r.y = 0;
+	rectHeader.r.w = qToBigEndian<uint16_t>( m_clientProtocol.framebufferWidth() );
+	rectHeader.r.h = qToBigEndian<uint16_t>( m_clientProtocol.framebufferHeight() );
+
+	proxyClientSocket()->write( reinterpret_cast<const char *>( &updateMessage ), sz_rfbFramebufferUpdateMsg );
+	proxyClientSocket()->write( reinterpret_cast<const char *>( &rectHeader ), sz_rfbFramebufferUpdateRectHeader );
+
+	enableServerMessageForwarding();
+}
+
+
+
+void ComputerControlClient::sendThumbnailUpdate()
+{
+	if( m_thumbnailUpdateRequested && m_thumbnailEncoder.hasChanges() )
+	{
+		proxyClientSocket()->write( m_thumbnailEncoder.encodeUpdate() );
+		m_thumbnailUpdateRequested = false;
+	}
+}
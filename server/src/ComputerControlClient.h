@@ -25,9 +25,13 @@
 #ifndef COMPUTER_CONTROL_CLIENT_H
 #define COMPUTER_CONTROL_CLIENT_H
 
+#include <QMutex>
+
+#include "FeatureMessage.h"
 #include "VncClientProtocol.h"
 #include "VncProxyConnection.h"
 #include "VncServerClient.h"
+#include "VncThumbnailEncoder.h"
 #include "VeyonServerProtocol.h"
 
 class ComputerControlServer;
@@ -43,7 +47,13 @@ public:
 						   QObject* parent );
 	~ComputerControlClient() override;
 
+	void start() override;
+
 	bool receiveClientMessage() override;
+	bool receiveServerMessage() override;
+
+	// may be called from any thread
+	void sendFeatureMessage( const FeatureMessage& message );
 
 protected:
 	VncClientProtocol& clientProtocol() override
@@ -56,7 +66,21 @@ protected:
 		return m_serverProtocol;
 	}
 
+private slots:
+	void sendPendingFeatureMessages();
+
 private:
+	bool receiveSetPixelFormatMessage();
+	bool receiveSetEncodingsMessage();
+	bool receiveThumbnailMessage();
+	bool receiveFramebufferUpdateRequestMessage();
+
+	rfbPixelFormat clientPixelFormat() const;
+
+	void startThumbnailMode( QSize thumbnailSize );
+	void stopThumbnailMode();
+	void sendThumbnailUpdate();
+
 	ComputerControlServer* m_server;
 
 	VncServerClient m_serverClient;
@@ -64,6 +88,16 @@ private:
 	VeyonServerProtocol m_serverProtocol;
 	VncClientProtocol m_clientProtocol;
 
+	bool m_clientSupportsThumbnails;
+	bool m_clientSupportsNewFBSize;
+
+	VncThumbnailEncoder m_thumbnailEncoder;
+	bool m_thumbnailModeEnabled;
+	bool m_thumbnailUpdateRequested;
+
+	QMutex m_pendingFeatureMessagesMutex;
+	QList<FeatureMessage> m_pendingFeatureMessages;
+
 } ;
 
 #endif
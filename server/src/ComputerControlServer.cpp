@@ -24,6 +24,7 @@
 
 #include <QCoreApplication>
 #include <QHostInfo>
+#include <QTimer>
 
 #include "AccessControlProvider.h"
 #include "ComputerControlServer.h"
@@ -37,6 +38,8 @@ ComputerControlServer::ComputerControlServer( QObject* parent ) :
 	QObject( parent ),
 	m_allowedIPs(),
 	m_failedAuthHosts(),
+	m_clientsMutex( QMutex::Recursive ),
+	m_clients(),
 	m_builtinFeatures(),
 	m_featureManager(),
 	m_featureWorkerManager( *this, m_featureManager ),
@@ -55,6 +58,9 @@ ComputerControlServer::ComputerControlServer( QObject* parent ) :
 					QString::number( VeyonCore::config().primaryServicePort() + VeyonCore::sessionId() ) ),
 				m_featureWorkerManager );
 
+	m_vncProxyServer.setThreadCount( VeyonCore::config().connectionThreadCount() );
+	m_vncProxyServer.setFramebufferUpdateSharingEnabled( VeyonCore::config().isFramebufferUpdateSharingEnabled() );
+
 	// make app terminate once the VNC server thread has finished
 	connect( &m_vncServer, &VncServer::finished, QCoreApplication::instance(), &QCoreApplication::quit );
 
@@ -92,6 +98,25 @@ VncProxyConnection* ComputerControlServer::createVncProxyConnection( QTcpSocket*
 
 
 
+void ComputerControlServer::addClient( ComputerControlClient* client )
+{
+	QMutexLocker locker( &m_clientsMutex );
+
+	m_clients[client->proxyClientSocket()] = client;
+}
+
+
+
+void ComputerControlServer::removeClient( ComputerControlClient* client )
+{
+	// waits for feature messages of this client currently being processed in the main thread
+	QMutexLocker locker( &m_clientsMutex );
+
+	m_clients.remove( client->proxyClientSocket() );
+}
+
+
+
 bool ComputerControlServer::handleFeatureMessage( QTcpSocket* socket )
 {
 	char messageType;
@@ -111,7 +136,37 @@ bool ComputerControlServer::handleFeatureMessage( QTcpSocket* socket )
 
 	featureMessage.receive();
 
-	return m_featureManager.handleFeatureMessage( *this, featureMessage );
+	// feature plugins and FeatureWorkerManager are not thread-safe so let the main thread handle the message
+	QTimer::singleShot( 0, this, [=]() { processFeatureMessage( featureMessage ); } );
+
+	return true;
+}
+
+
+
+void ComputerControlServer::sendFeatureMessage( QIODevice* ioDevice, const FeatureMessage& message )
+{
+	QMutexLocker locker( &m_clientsMutex );
+
+	// client might have disconnected already
+	auto client = m_clients.value( ioDevice );
+	if( client )
+	{
+		client->sendFeatureMessage( message );
+	}
+}
+
+
+
+void ComputerControlServer::processFeatureMessage( const FeatureMessage& message )
+{
+	// keep client from being deleted while plugins access its socket (e.g. for subscriptions)
+	QMutexLocker locker( &m_clientsMutex );
+
+	if( m_clients.contains( message.ioDevice() ) )
+	{
+		m_featureManager.handleFeatureMessage( *this, message );
+	}
 }
 
 
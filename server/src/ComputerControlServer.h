@@ -25,6 +25,7 @@
 #ifndef COMPUTER_CONTROL_SERVER_H
 #define COMPUTER_CONTROL_SERVER_H
 
+#include <QtCore/QMap>
 #include <QtCore/QMutex>
 #include <QtCore/QStringList>
 
@@ -39,6 +40,8 @@
 #include "VncProxyConnectionFactory.h"
 #include "VncServer.h"
 
+class ComputerControlClient;
+
 class ComputerControlServer : public QObject, VncProxyConnectionFactory, VeyonServerInterface
 {
 	Q_OBJECT
@@ -63,6 +66,11 @@ public:
 		return m_serverAccessControlManager;
 	}
 
+	// may be called from any connection thread
+	void addClient( ComputerControlClient* client );
+	void removeClient( ComputerControlClient* client );
+
+	// receives message within the connection thread and queues it for the main thread
 	bool handleFeatureMessage( QTcpSocket* socket );
 
 	void setAllowedIPs( const QStringList &allowedIPs );
@@ -72,8 +80,12 @@ public:
 		return m_featureWorkerManager;
 	}
 
+	void sendFeatureMessage( QIODevice* ioDevice, const FeatureMessage& message ) override;
+
 
 private:
+	void processFeatureMessage( const FeatureMessage& message );
+
 	void showAuthenticationErrorMessage( const QString& host, const QString& user );
 
 	QMutex m_dataMutex;
@@ -81,6 +93,9 @@ private:
 
 	QStringList m_failedAuthHosts;
 
+	QMutex m_clientsMutex;
+	QMap<QIODevice *, ComputerControlClient *> m_clients;
+
 	BuiltinFeatures m_builtinFeatures;
 	FeatureManager m_featureManager;
 	FeatureWorkerManager m_featureWorkerManager;
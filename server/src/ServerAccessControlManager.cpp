@@ -22,10 +22,13 @@
  *
  */
 
+#include <QFutureWatcher>
+#include <QTimer>
+#include <QtConcurrent>
+
 #include "VeyonCore.h"
 
 #include "ServerAccessControlManager.h"
-#include "AccessControlProvider.h"
 #include "DesktopAccessDialog.h"
 #include "VeyonConfiguration.h"
 #include "VariantArrayMessage.h"
@@ -37,9 +40,14 @@ ServerAccessControlManager::ServerAccessControlManager( FeatureWorkerManager& fe
 	QObject( parent ),
 	m_featureWorkerManager( featureWorkerManager ),
 	m_desktopAccessDialog( desktopAccessDialog ),
+	m_accessControlThreadPool(),
+	m_dataMutex(),
 	m_clients(),
+	m_desktopAccessDialogStarting( false ),
 	m_desktopAccessChoices()
 {
+	// access control rules are evaluated one after another
+	m_accessControlThreadPool.setMaxThreadCount( 1 );
 }
 
 
@@ -65,6 +73,7 @@ void ServerAccessControlManager::addClient( VncServerClient* client )
 
 	if( client->accessControlState() == VncServerClient::AccessControlSuccessful )
 	{
+		QMutexLocker l( &m_dataMutex );
 		m_clients.append( client );
 	}
 }
@@ -73,6 +82,8 @@ void ServerAccessControlManager::addClient( VncServerClient* client )
 
 void ServerAccessControlManager::removeClient( VncServerClient* client )
 {
+	m_dataMutex.lock();
+
 	m_clients.removeAll( client );
 
 	// force all remaining clients to pass access control again as conditions might
@@ -81,17 +92,15 @@ void ServerAccessControlManager::removeClient( VncServerClient* client )
 	const VncServerClientList previousClients = m_clients;
 	m_clients.clear();
 
-	for( auto prevClient : qAsConst( previousClients ) )
-	{
-		prevClient->setAccessControlState( VncServerClient::AccessControlInit );
-		addClient( prevClient );
+	m_dataMutex.unlock();
 
-		if( prevClient->accessControlState() != VncServerClient::AccessControlSuccessful &&
-				prevClient->accessControlState() != VncServerClient::AccessControlPending )
-		{
-			qDebug( "ServerAccessControlManager::removeClient(): closing connection as client does not pass access control any longer" );
-			prevClient->setProtocolState( VncServerProtocol::Close );
-		}
+	for( auto prevClient : previousClients )
+	{
+		// clients may live in different threads so let each one be processed in its own thread
+		QTimer::singleShot( 0, prevClient, [=]() {
+			prevClient->setAccessControlState( VncServerClient::AccessControlInit );
+			addClient( prevClient );
+		} );
 	}
 }
 
@@ -117,11 +126,34 @@ void ServerAccessControlManager::performAccessControl( VncServerClient* client )
 		break;
 	}
 
-	const auto accessResult =
-			AccessControlProvider().checkAccess( client->username(),
-												 client->hostAddress(),
-												 connectedUsers() );
+	client->setAccessControlState( VncServerClient::AccessControlPending );
+
+	const auto username = client->username();
+	const auto hostAddress = client->hostAddress();
+
+	m_dataMutex.lock();
+	const auto users = connectedUsers();
+	m_dataMutex.unlock();
+
+	// evaluating access control rules may involve slow lookups (e.g. in directory services)
+	// so do not block data forwarding of other connections running in the same thread
+	auto watcher = new QFutureWatcher<AccessControlProvider::AccessResult>( client );
+
+	connect( watcher, &QFutureWatcherBase::finished, client, [=]() {
+		finishAccessControl( client, watcher->result() );
+		watcher->deleteLater();
+	} );
+
+	watcher->setFuture( QtConcurrent::run( &m_accessControlThreadPool, [=]() {
+		return AccessControlProvider().checkAccess( username, hostAddress, users );
+	} ) );
+}
+
+
 
+void ServerAccessControlManager::finishAccessControl( VncServerClient* client,
+													  AccessControlProvider::AccessResult accessResult )
+{
 	switch( accessResult )
 	{
 	case AccessControlProvider::AccessAllow:
@@ -137,6 +169,27 @@ void ServerAccessControlManager::performAccessControl( VncServerClient* client )
 		client->setProtocolState( VncServerProtocol::Close );
 		break;
 	}
+
+	switch( client->accessControlState() )
+	{
+	case VncServerClient::AccessControlSuccessful:
+		m_dataMutex.lock();
+		m_clients.append( client );
+		m_dataMutex.unlock();
+		break;
+
+	case VncServerClient::AccessControlPending:
+		break;
+
+	default:
+		// client passed access control before (see removeClient()) but not this time
+		if( client->protocolState() == VncServerProtocol::Running )
+		{
+			qDebug( "ServerAccessControlManager::finishAccessControl(): closing connection as client does not pass access control any longer" );
+			client->setProtocolState( VncServerProtocol::Close );
+		}
+		break;
+	}
 }
 
 
@@ -145,10 +198,16 @@ VncServerClient::AccessControlState ServerAccessControlManager::confirmDesktopAc
 {
 	const HostUserPair hostUserPair( client->username(), client->hostAddress() );
 
+	m_dataMutex.lock();
+
 	// did we save a previous choice because user chose "always" or "never"?
 	if( m_desktopAccessChoices.contains( hostUserPair ) )
 	{
-		if( qAsConst(m_desktopAccessChoices)[hostUserPair] == DesktopAccessDialog::ChoiceAlways )
+		const auto choice = qAsConst(m_desktopAccessChoices)[hostUserPair];
+
+		m_dataMutex.unlock();
+
+		if( choice == DesktopAccessDialog::ChoiceAlways )
 		{
 			return VncServerClient::AccessControlSuccessful;
 		}
@@ -156,13 +215,19 @@ VncServerClient::AccessControlState ServerAccessControlManager::confirmDesktopAc
 		return VncServerClient::AccessControlFailed;
 	}
 
-	// already an access dialog running?
-	if( m_desktopAccessDialog.isBusy( &m_featureWorkerManager ) )
+	// already an access dialog running or about to be started?
+	if( m_desktopAccessDialogStarting || m_desktopAccessDialog.isBusy( &m_featureWorkerManager ) )
 	{
-		// then close connection so that client has to try again later
+		m_dataMutex.unlock();
+
+		// then client has to try again later
 		return VncServerClient::AccessControlWaiting;
 	}
 
+	m_desktopAccessDialogStarting = true;
+
+	m_dataMutex.unlock();
+
 	// get notified whenever the dialog finishes - use signal indirection for
 	// automatically breaking connection if VncServerClient gets deleted while
 	// dialog is active (e.g. due another connection being closed and thus
@@ -172,16 +237,31 @@ VncServerClient::AccessControlState ServerAccessControlManager::confirmDesktopAc
 			 client, &VncServerClient::finishAccessControl );
 
 	connect( client, &VncServerClient::accessControlFinished,
-			 this, &ServerAccessControlManager::finishDesktopAccessConfirmation );
+			 this, &ServerAccessControlManager::finishDesktopAccessConfirmation, Qt::DirectConnection );
 
-	// start the dialog (non-blocking)
-	m_desktopAccessDialog.exec( &m_featureWorkerManager, client->username(), client->hostAddress() );
+	// dialog has to be run from the main thread - do not wait for it as the main thread
+	// in turn may be waiting for the connection threads (e.g. when stopping the server)
+	QMetaObject::invokeMethod( this, "startDesktopAccessDialog", Qt::QueuedConnection,
+							   Q_ARG(QString, client->username()),
+							   Q_ARG(QString, client->hostAddress()) );
 
 	return VncServerClient::AccessControlPending;
 }
 
 
 
+void ServerAccessControlManager::startDesktopAccessDialog( const QString& user, const QString& host )
+{
+	// start the dialog (non-blocking)
+	m_desktopAccessDialog.exec( &m_featureWorkerManager, user, host );
+
+	// from now on DesktopAccessDialog::isBusy() returns true
+	QMutexLocker l( &m_dataMutex );
+	m_desktopAccessDialogStarting = false;
+}
+
+
+
 void ServerAccessControlManager::finishDesktopAccessConfirmation( VncServerClient* client )
 {
 	// break helper connections for asynchronous desktop access control operations
@@ -193,6 +273,8 @@ void ServerAccessControlManager::finishDesktopAccessConfirmation( VncServerClien
 
 	const auto choice = m_desktopAccessDialog.choice();
 
+	QMutexLocker l( &m_dataMutex );
+
 	// remember choices "always" and "never"
 	if( choice == DesktopAccessDialog::ChoiceAlways || choice == DesktopAccessDialog::ChoiceNever )
 	{
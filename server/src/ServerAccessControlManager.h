@@ -25,6 +25,10 @@
 #ifndef SERVER_ACCESS_CONTROL_MANAGER_H
 #define SERVER_ACCESS_CONTROL_MANAGER_H
 
+#include <QMutex>
+#include <QThreadPool>
+
+#include "AccessControlProvider.h"
 #include "DesktopAccessDialog.h"
 #include "RfbVeyonAuth.h"
 #include "VncServerClient.h"
@@ -39,6 +43,7 @@ public:
 								DesktopAccessDialog& desktopAccessDialog,
 								QObject* parent );
 
+	// may be called from any connection thread
 	void addClient( VncServerClient* client );
 	void removeClient( VncServerClient* client );
 
@@ -46,12 +51,16 @@ public:
 signals:
 	void accessControlError( const QString& host, const QString& user );
 
+private slots:
+	void startDesktopAccessDialog( const QString& user, const QString& host );
+
 private:
 	enum {
 		ClientWaitInterval = 1000
 	};
 
 	void performAccessControl( VncServerClient* client );
+	void finishAccessControl( VncServerClient* client, AccessControlProvider::AccessResult accessResult );
 	VncServerClient::AccessControlState confirmDesktopAccess( VncServerClient* client );
 	void finishDesktopAccessConfirmation( VncServerClient* client );
 
@@ -60,7 +69,11 @@ private:
 	FeatureWorkerManager& m_featureWorkerManager;
 	DesktopAccessDialog& m_desktopAccessDialog;
 
+	QThreadPool m_accessControlThreadPool;
+
+	QMutex m_dataMutex;
 	VncServerClientList m_clients;
+	bool m_desktopAccessDialogStarting;
 
 	typedef QPair<QString, QString> HostUserPair;
 	typedef QMap<HostUserPair, DesktopAccessDialog::Choice> DesktopAccessChoiceMap;
@@ -22,7 +22,9 @@
  *
  */
 
+#include <QFutureWatcher>
 #include <QHostAddress>
+#include <QtConcurrent>
 
 #include "AuthenticationCredentials.h"
 #include "ServerAuthenticationManager.h"
@@ -35,11 +37,12 @@
 
 ServerAuthenticationManager::ServerAuthenticationManager( QObject* parent ) :
 	QObject( parent ),
+	m_authenticationThreadPool(),
 	m_allowedIPs(),
 	m_failedAuthHosts()
 {
-
-
+	// authentication backends such as PAM are not guaranteed to be reentrant
+	m_authenticationThreadPool.setMaxThreadCount( 1 );
 }
 
 
@@ -152,21 +155,24 @@ VncServerClient::AuthState ServerAuthenticationManager::performKeyAuthentication
 		// now try to verify received signed data using public key of the user
 		// under which the client claims to run
 		const auto signature = message.read().toByteArray(); // Flawfinder: ignore
+		const auto challenge = client->challenge();
 
 		const auto publicKeyPath = VeyonCore::filesystem().publicKeyPath( authKeyName );
 
-		qDebug() << "ServerAuthenticationManager: loading public key" << publicKeyPath;
-		CryptoCore::PublicKey publicKey( publicKeyPath );
+		return finishAuthenticationLater( client, [=]() {
+			qDebug() << "ServerAuthenticationManager: loading public key" << publicKeyPath;
+			CryptoCore::PublicKey publicKey( publicKeyPath );
 
-		if( publicKey.isNull() || publicKey.isPublic() == false ||
-				publicKey.verifyMessage( client->challenge(), signature, CryptoCore::DefaultSignatureAlgorithm ) == false )
-		{
-			qWarning( "ServerAuthenticationManager::performKeyAuthentication(): FAIL" );
-			return VncServerClient::AuthFinishedFail;
-		}
+			if( publicKey.isNull() || publicKey.isPublic() == false ||
+					publicKey.verifyMessage( challenge, signature, CryptoCore::DefaultSignatureAlgorithm ) == false )
+			{
+				qWarning( "ServerAuthenticationManager::performKeyAuthentication(): FAIL" );
+				return false;
+			}
 
-		qDebug( "ServerAuthenticationManager::performKeyAuthentication(): SUCCESS" );
-		return VncServerClient::AuthFinishedSuccess;
+			qDebug( "ServerAuthenticationManager::performKeyAuthentication(): SUCCESS" );
+			return true;
+		} );
 	}
 
 	default:
@@ -202,31 +208,38 @@ VncServerClient::AuthState ServerAuthenticationManager::performLogonAuthenticati
 
 	case VncServerClient::AuthPassword:
 	{
-		CryptoCore::PrivateKey privateKey = CryptoCore::PrivateKey::fromPEM( client->privateKey() );
-
-		CryptoCore::SecureArray encryptedPassword( message.read().toByteArray() ); // Flawfinder: ignore
-
-		CryptoCore::SecureArray decryptedPassword;
-
-		if( privateKey.decrypt( encryptedPassword,
-								&decryptedPassword,
-								CryptoCore::DefaultEncryptionAlgorithm ) == false )
-		{
-			qWarning( "ServerAuthenticationManager::performLogonAuthentication(): failed to decrypt password" );
-			return VncServerClient::AuthFinishedFail;
-		}
-
-		qInfo() << "ServerAuthenticationManager::performLogonAuthentication(): authenticating user" << client->username();
-
-		if( VeyonCore::platform().userFunctions().authenticate( client->username(),
-																QString::fromUtf8( decryptedPassword.toByteArray() ) ) )
-		{
-			qDebug( "ServerAuthenticationManager::performLogonAuthentication(): SUCCESS" );
-			return VncServerClient::AuthFinishedSuccess;
-		}
-
-		qDebug( "ServerAuthenticationManager::performLogonAuthentication(): FAIL" );
-		return VncServerClient::AuthFinishedFail;
+		const auto privateKeyPEM = client->privateKey();
+		const auto encryptedPasswordData = message.read().toByteArray(); // Flawfinder: ignore
+		const auto username = client->username();
+
+		// decrypting and verifying the password may take several seconds
+		return finishAuthenticationLater( client, [=]() {
+			CryptoCore::PrivateKey privateKey = CryptoCore::PrivateKey::fromPEM( privateKeyPEM );
+
+			CryptoCore::SecureArray encryptedPassword( encryptedPasswordData );
+
+			CryptoCore::SecureArray decryptedPassword;
+
+			if( privateKey.decrypt( encryptedPassword,
+									&decryptedPassword,
+									CryptoCore::DefaultEncryptionAlgorithm ) == false )
+			{
+				qWarning( "ServerAuthenticationManager::performLogonAuthentication(): failed to decrypt password" );
+				return false;
+			}
+
+			qInfo() << "ServerAuthenticationManager::performLogonAuthentication(): authenticating user" << username;
+
+			if( VeyonCore::platform().userFunctions().authenticate( username,
+																	QString::fromUtf8( decryptedPassword.toByteArray() ) ) )
+			{
+				qDebug( "ServerAuthenticationManager::performLogonAuthentication(): SUCCESS" );
+				return true;
+			}
+
+			qDebug( "ServerAuthenticationManager::performLogonAuthentication(): FAIL" );
+			return false;
+		} );
 	}
 
 	default:
@@ -293,3 +306,30 @@ VncServerClient::AuthState ServerAuthenticationManager::performTokenAuthenticati
 
 	return VncServerClient::AuthFinishedFail;
 }
+
+
+
+VncServerClient::AuthState ServerAuthenticationManager::finishAuthenticationLater( VncServerClient* client,
+																				   const std::function<bool()>& authenticate )
+{
+	// do not block the connection's thread and thus all other connections in it
+	auto watcher = new QFutureWatcher<bool>( client );
+
+	connect( watcher, &QFutureWatcherBase::finished, client, [=]() {
+		if( watcher->result() )
+		{
+			client->setAuthState( VncServerClient::AuthFinishedSuccess );
+		}
+		else
+		{
+			client->setAuthState( VncServerClient::AuthFinishedFail );
+			emit authenticationError( client->hostAddress(), client->username() );
+		}
+
+		watcher->deleteLater();
+	} );
+
+	watcher->setFuture( QtConcurrent::run( &m_authenticationThreadPool, authenticate ) );
+
+	return VncServerClient::AuthPending;
+}
@@ -27,6 +27,9 @@
 
 #include <QMutex>
 #include <QStringList>
+#include <QThreadPool>
+
+#include <functional>
 
 #include "RfbVeyonAuth.h"
 #include "VncServerClient.h"
@@ -56,6 +59,11 @@ private:
 	VncServerClient::AuthState performHostWhitelistAuth( VncServerClient* client, VariantArrayMessage& message );
 	VncServerClient::AuthState performTokenAuthentication( VncServerClient* client, VariantArrayMessage& message );
 
+	VncServerClient::AuthState finishAuthenticationLater( VncServerClient* client,
+														  const std::function<bool()>& authenticate );
+
+	QThreadPool m_authenticationThreadPool;
+
 	QMutex m_dataMutex;
 	QStringList m_allowedIPs;
 
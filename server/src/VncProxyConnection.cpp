@@ -29,14 +29,26 @@
 
 #include "VncClientProtocol.h"
 #include "VncProxyConnection.h"
+#include "VncProxyServer.h"
 #include "VncServerProtocol.h"
+#include "VncSharedConnection.h"
 
 VncProxyConnection::VncProxyConnection( QTcpSocket* clientSocket,
 										int vncServerPort,
 										QObject* parent ) :
 	QObject( parent ),
+	m_vncServerPort( vncServerPort ),
 	m_proxyClientSocket( clientSocket ),
 	m_vncServerSocket( new QTcpSocket( this ) ),
+	m_forwardingBuffer(),
+	m_readFromClientAtServerMessageBoundary( false ),
+	m_framebufferUpdateRequestDeferred( false ),
+	m_deferredFramebufferUpdateIncremental( true ),
+	m_deferredFramebufferUpdateRequest(),
+	m_clientSetPixelFormatMessage(),
+	m_clientSetEncodingsMessage(),
+	m_proxyServer( nullptr ),
+	m_sharedConnection(),
 	m_rfbClientToServerMessageSizes( {
 									 std::pair<int, int>( rfbSetPixelFormat, sz_rfbSetPixelFormatMsg ),
 									 std::pair<int, int>( rfbFramebufferUpdateRequest, sz_rfbFramebufferUpdateRequestMsg ),
@@ -45,19 +57,23 @@ VncProxyConnection::VncProxyConnection( QTcpSocket* clientSocket,
 									 std::pair<int, int>( rfbXvp, sz_rfbXvpMsg ),
 									 } )
 {
+	// let client socket be moved to the thread of this connection together with us
+	m_proxyClientSocket->setParent( this );
+
 	connect( m_proxyClientSocket, &QTcpSocket::readyRead, this, &VncProxyConnection::readFromClient );
+	connect( m_proxyClientSocket, &QTcpSocket::bytesWritten, this, &VncProxyConnection::processClientBytesWritten );
 	connect( m_vncServerSocket, &QTcpSocket::readyRead, this, &VncProxyConnection::readFromServer );
 
 	connect( m_vncServerSocket, &QTcpSocket::disconnected, this, &VncProxyConnection::clientConnectionClosed );
 	connect( m_proxyClientSocket, &QTcpSocket::disconnected, this, &VncProxyConnection::serverConnectionClosed );
-
-	m_vncServerSocket->connectToHost( QHostAddress::LocalHost, vncServerPort );
 }
 
 
 
 VncProxyConnection::~VncProxyConnection()
 {
+	unsubscribeFromSharedConnection();
+
 	// do not get notified about disconnects any longer
 	disconnect( m_vncServerSocket );
 	disconnect( m_proxyClientSocket );
@@ -68,6 +84,13 @@ VncProxyConnection::~VncProxyConnection()
 
 
 
+void VncProxyConnection::start()
+{
+	m_vncServerSocket->connectToHost( QHostAddress::LocalHost, m_vncServerPort );
+}
+
+
+
 void VncProxyConnection::readFromClient()
 {
 	if( serverProtocol().state() != VncServerProtocol::Running )
@@ -113,6 +136,8 @@ void VncProxyConnection::readFromServer()
 			// we can forward to the real client
 			serverProtocol().setServerInitMessage( clientProtocol().serverInitMessage() );
 
+			enableServerMessageForwarding();
+
 			readFromServerLater();
 		}
 	}
@@ -133,13 +158,26 @@ void VncProxyConnection::readFromServer()
 
 bool VncProxyConnection::forwardDataToClient( qint64 size )
 {
-	if( m_vncServerSocket->bytesAvailable() >= size )
+	return forwardData( m_vncServerSocket, m_proxyClientSocket, size );
+}
+
+
+
+bool VncProxyConnection::forwardDataToServer( qint64 size )
+{
+	return forwardData( m_proxyClientSocket, m_vncServerSocket, size );
+}
+
+
+
+bool VncProxyConnection::deferUntilServerMessageBoundary()
+{
+	if( clientProtocol().isForwardingFramebufferUpdate() )
 	{
-		const auto data = m_vncServerSocket->read( size ); // Flawfinder: ignore
-		if( data.size() == size )
-		{
-			return m_proxyClientSocket->write( data ) == size;
-		}
+		// client is receiving a framebuffer update which must not be interrupted
+		// so read from client again as soon as it is complete
+		m_readFromClientAtServerMessageBoundary = true;
+		return true;
 	}
 
 	return false;
@@ -147,15 +185,65 @@ bool VncProxyConnection::forwardDataToClient( qint64 size )
 
 
 
-bool VncProxyConnection::forwardDataToServer( qint64 size )
+void VncProxyConnection::enableServerMessageForwarding()
 {
-	if( m_proxyClientSocket->bytesAvailable() >= size )
+	// pass on server messages while they're being received unless framebuffer updates are
+	// sent through a shared connection as well and messages of both must not be interleaved
+	if( m_proxyServer == nullptr )
 	{
-		const auto data = m_proxyClientSocket->read( size ); // Flawfinder: ignore
-		if( data.size() == size )
-		{
-			return m_vncServerSocket->write( data ) == size;
-		}
+		clientProtocol().setForwardingDevice( m_proxyClientSocket );
+	}
+}
+
+
+
+void VncProxyConnection::setClientSetPixelFormatMessage( const QByteArray& message )
+{
+	m_clientSetPixelFormatMessage = message;
+
+	// updates of current shared connection no longer match client's pixel format
+	unsubscribeFromSharedConnection();
+}
+
+
+
+void VncProxyConnection::setClientSetEncodingsMessage( const QByteArray& message )
+{
+	m_clientSetEncodingsMessage = message;
+
+	unsubscribeFromSharedConnection();
+}
+
+
+
+void VncProxyConnection::unsubscribeFromSharedConnection()
+{
+	if( m_sharedConnection )
+	{
+		m_sharedConnection->unsubscribe( m_proxyClientSocket );
+	}
+
+	m_sharedConnection = nullptr;
+}
+
+
+
+bool VncProxyConnection::forwardData( QTcpSocket* source, QTcpSocket* destination, qint64 size )
+{
+	if( source->bytesAvailable() < size )
+	{
+		return false;
+	}
+
+	// reuse buffer instead of allocating a new one for each message
+	if( m_forwardingBuffer.size() < size )
+	{
+		m_forwardingBuffer.resize( static_cast<int>( size ) );
+	}
+
+	if( source->read( m_forwardingBuffer.data(), size ) == size ) // Flawfinder: ignore
+	{
+		return destination->write( m_forwardingBuffer.constData(), size ) == size;
 	}
 
 	return false;
@@ -163,6 +251,25 @@ bool VncProxyConnection::forwardDataToServer( qint64 size )
 
 
 
+void VncProxyConnection::processClientBytesWritten()
+{
+	if( m_framebufferUpdateRequestDeferred &&
+			m_proxyClientSocket->bytesToWrite() < MaximumBytesToWrite )
+	{
+		m_framebufferUpdateRequestDeferred = false;
+
+		// the server accumulates all changes since its last update so a single
+		// request replaces all requests received while the client was lagging
+		m_deferredFramebufferUpdateRequest.incremental = m_deferredFramebufferUpdateIncremental ? 1 : 0;
+		m_deferredFramebufferUpdateIncremental = true;
+
+		m_vncServerSocket->write( reinterpret_cast<const char *>( &m_deferredFramebufferUpdateRequest ),
+								  sz_rfbFramebufferUpdateRequestMsg );
+	}
+}
+
+
+
 void VncProxyConnection::readFromServerLater()
 {
 	QTimer::singleShot( ProtocolRetryTime, this, &VncProxyConnection::readFromServer );
@@ -202,11 +309,45 @@ bool VncProxyConnection::receiveClientMessage()
 					socket->close();
 					return false;
 				}
-				return forwardDataToServer( sz_rfbSetEncodingsMsg + nEncodings * sizeof(uint32_t) );
+				const qint64 messageSize = sz_rfbSetEncodingsMsg + nEncodings * sizeof(uint32_t);
+				if( socket->bytesAvailable() < messageSize )
+				{
+					return false;
+				}
+
+				setClientSetEncodingsMessage( socket->peek( messageSize ) );
+
+				return forwardDataToServer( messageSize );
 			}
 		}
 		break;
 
+	case rfbSetPixelFormat:
+		if( socket->bytesAvailable() >= sz_rfbSetPixelFormatMsg )
+		{
+			rfbSetPixelFormatMsg setPixelFormatMessage;
+			if( socket->peek( (char *) &setPixelFormatMessage, sz_rfbSetPixelFormatMsg ) == sz_rfbSetPixelFormatMsg )
+			{
+				// server will send updates in new pixel format which affects parsing e.g. Tight encoded rects
+				clientProtocol().setExpectedPixelFormat( setPixelFormatMessage.format );
+				setClientSetPixelFormatMessage( socket->peek( sz_rfbSetPixelFormatMsg ) );
+				return forwardDataToServer( sz_rfbSetPixelFormatMsg );
+			}
+		}
+		break;
+
+	case rfbFramebufferUpdateRequest:
+		if( m_proxyServer )
+		{
+			return receiveFramebufferUpdateRequest();
+		}
+		if( m_framebufferUpdateRequestDeferred ||
+				socket->bytesToWrite() >= MaximumBytesToWrite )
+		{
+			return deferFramebufferUpdateRequest();
+		}
+		return forwardDataToServer( sz_rfbFramebufferUpdateRequestMsg );
+
 	default:
 		if( m_rfbClientToServerMessageSizes.contains( messageType ) == false )
 		{
@@ -225,12 +366,96 @@ bool VncProxyConnection::receiveClientMessage()
 
 bool VncProxyConnection::receiveServerMessage()
 {
+	// messages are written to client by client protocol while being received
 	if( clientProtocol().receiveMessage() )
 	{
-		m_proxyClientSocket->write( clientProtocol().lastMessage() );
+		if( clientProtocol().forwardingDevice() == nullptr )
+		{
+			m_proxyClientSocket->write( clientProtocol().lastMessage() );
+		}
+
+		if( m_readFromClientAtServerMessageBoundary )
+		{
+			m_readFromClientAtServerMessageBoundary = false;
+			QTimer::singleShot( 0, this, &VncProxyConnection::readFromClient );
+		}
 
 		return true;
 	}
 
 	return false;
 }
+
+
+
+bool VncProxyConnection::receiveFramebufferUpdateRequest()
+{
+	auto socket = proxyClientSocket();
+
+	rfbFramebufferUpdateRequestMsg updateRequest;
+	if( socket->bytesAvailable() < sz_rfbFramebufferUpdateRequestMsg ||
+			socket->read( reinterpret_cast<char *>( &updateRequest ), sz_rfbFramebufferUpdateRequestMsg ) != sz_rfbFramebufferUpdateRequestMsg ) // Flawfinder: ignore
+	{
+		return false;
+	}
+
+	return requestSharedFramebufferUpdate( updateRequest.incremental != 0 );
+}
+
+
+
+bool VncProxyConnection::requestSharedFramebufferUpdate( bool incremental )
+{
+	// do not let the VNC server encode updates for this connection but receive them
+	// through the connection shared with all clients using the same pixel format and encodings
+	if( m_sharedConnection.isNull() )
+	{
+		QThread* sharedConnectionThread = nullptr;
+
+		m_sharedConnection = m_proxyServer->sharedConnection( m_clientSetPixelFormatMessage, m_clientSetEncodingsMessage,
+															  &sharedConnectionThread );
+		if( m_sharedConnection.isNull() )
+		{
+			// continue within thread of shared connection - stop processing messages in this thread
+			// immediately as all further events of this connection are delivered in the new thread
+			m_proxyServer->moveConnectionToThread( this, sharedConnectionThread );
+
+			QTimer::singleShot( 0, this, [=]() {
+				if( requestSharedFramebufferUpdate( incremental ) )
+				{
+					readFromClient();
+				}
+			} );
+
+			return false;
+		}
+
+		m_sharedConnection->subscribe( m_proxyClientSocket );
+	}
+
+	m_sharedConnection->requestFramebufferUpdate( m_proxyClientSocket, incremental );
+
+	return true;
+}
+
+
+
+bool VncProxyConnection::deferFramebufferUpdateRequest()
+{
+	auto socket = proxyClientSocket();
+
+	rfbFramebufferUpdateRequestMsg updateRequest;
+	if( socket->bytesAvailable() < sz_rfbFramebufferUpdateRequestMsg ||
+			socket->read( reinterpret_cast<char *>( &updateRequest ), sz_rfbFramebufferUpdateRequestMsg ) != sz_rfbFramebufferUpdateRequestMsg ) // Flawfinder: ignore
+	{
+		return false;
+	}
+
+	// client can't keep up with the updates already buffered for it so do not let the
+	// server send further updates which would be outdated once delivered anyway
+	m_deferredFramebufferUpdateRequest = updateRequest;
+	m_deferredFramebufferUpdateIncremental &= updateRequest.incremental != 0;
+	m_framebufferUpdateRequestDeferred = true;
+
+	return true;
+}
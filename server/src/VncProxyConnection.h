@@ -25,20 +25,27 @@
 #ifndef VNC_PROXY_CONNECTION_H
 #define VNC_PROXY_CONNECTION_H
 
+#include <QPointer>
+
 #include "VeyonCore.h"
 
+#include "rfb/rfbproto.h"
+
 class QBuffer;
 class QTcpSocket;
 
 class VncClientProtocol;
+class VncProxyServer;
 class VncServerProtocol;
+class VncSharedConnection;
 
 class VncProxyConnection : public QObject
 {
 	Q_OBJECT
 public:
 	enum {
-		ProtocolRetryTime = 250
+		ProtocolRetryTime = 250,
+		MaximumBytesToWrite = 2*1024*1024
 	};
 
 	VncProxyConnection( QTcpSocket* clientSocket, int vncServerPort, QObject* parent );
@@ -54,6 +61,16 @@ public:
 		return m_vncServerSocket;
 	}
 
+	// receive framebuffer updates through shared connections of given proxy server
+	void setProxyServer( VncProxyServer* proxyServer )
+	{
+		m_proxyServer = proxyServer;
+	}
+
+public slots:
+	// has to be called in the thread the connection has been moved to
+	virtual void start();
+
 protected slots:
 	void readFromClient();
 	void readFromServer();
@@ -71,10 +88,51 @@ protected:
 	virtual VncClientProtocol& clientProtocol() = 0;
 	virtual VncServerProtocol& serverProtocol() = 0;
 
+	bool deferUntilServerMessageBoundary();
+
+	void enableServerMessageForwarding();
+
+	const QByteArray& clientSetPixelFormatMessage() const
+	{
+		return m_clientSetPixelFormatMessage;
+	}
+
+	const QByteArray& clientSetEncodingsMessage() const
+	{
+		return m_clientSetEncodingsMessage;
+	}
+
+	void setClientSetPixelFormatMessage( const QByteArray& message );
+	void setClientSetEncodingsMessage( const QByteArray& message );
+
+	void unsubscribeFromSharedConnection();
+
+private slots:
+	void processClientBytesWritten();
+
 private:
+	bool forwardData( QTcpSocket* source, QTcpSocket* destination, qint64 size );
+	bool receiveFramebufferUpdateRequest();
+	bool requestSharedFramebufferUpdate( bool incremental );
+	bool deferFramebufferUpdateRequest();
+
+	const int m_vncServerPort;
 	QTcpSocket* m_proxyClientSocket;
 	QTcpSocket* m_vncServerSocket;
 
+	QByteArray m_forwardingBuffer;
+	bool m_readFromClientAtServerMessageBoundary;
+
+	bool m_framebufferUpdateRequestDeferred;
+	bool m_deferredFramebufferUpdateIncremental;
+	rfbFramebufferUpdateRequestMsg m_deferredFramebufferUpdateRequest;
+
+	QByteArray m_clientSetPixelFormatMessage;
+	QByteArray m_clientSetEncodingsMessage;
+
+	VncProxyServer* m_proxyServer;
+	QPointer<VncSharedConnection> m_sharedConnection;
+
 	const QMap<int, int> m_rfbClientToServerMessageSizes;
 
 signals:
@@ -24,11 +24,14 @@
 
 #include <QTcpServer>
 #include <QTcpSocket>
+#include <QThread>
 
 #include "VeyonCore.h"
+#include "VncConnectionPool.h"
 #include "VncProxyServer.h"
 #include "VncProxyConnection.h"
 #include "VncProxyConnectionFactory.h"
+#include "VncSharedConnection.h"
 
 
 VncProxyServer::VncProxyServer( const QHostAddress& listenAddress,
@@ -41,7 +44,13 @@ VncProxyServer::VncProxyServer( const QHostAddress& listenAddress,
 	m_listenAddress( listenAddress ),
 	m_listenPort( listenPort ),
 	m_server( new QTcpServer( this ) ),
-	m_connectionFactory( connectionFactory )
+	m_connectionFactory( connectionFactory ),
+	m_threadCount( VncConnectionPool::DefaultThreadCount ),
+	m_connectionPool( nullptr ),
+	m_connections(),
+	m_framebufferUpdateSharingEnabled( false ),
+	m_sharedConnectionsMutex(),
+	m_sharedConnections()
 {
 	connect( m_server, &QTcpServer::newConnection, this, &VncProxyServer::acceptConnection );
 }
@@ -60,6 +69,11 @@ void VncProxyServer::start( int vncServerPort, const QString& vncServerPassword
 	m_vncServerPort = vncServerPort;
 	m_vncServerPassword = vncServerPassword;
 
+	if( m_connectionPool == nullptr )
+	{
+		m_connectionPool = new VncConnectionPool( m_threadCount );
+	}
+
 	if( m_server->listen( m_listenAddress, m_listenPort ) == false )
 	{
 		qWarning() << "VncProxyServer: could not listen on port" << m_listenPort << m_server->errorString();
@@ -72,13 +86,29 @@ void VncProxyServer::start( int vncServerPort, const QString& vncServerPassword
 
 void VncProxyServer::stop()
 {
+	// connections live in threads of connection pool so let them be deleted there
 	for( auto connection : qAsConst( m_connections ) )
 	{
-		delete connection;
+		connection->deleteLater();
 	}
 
 	m_connections.clear();
 
+	// finishes all threads after processing pending deletions
+	delete m_connectionPool;
+	m_connectionPool = nullptr;
+
+	m_sharedConnectionsMutex.lock();
+
+	for( auto sharedConnection : qAsConst( m_sharedConnections ) )
+	{
+		delete sharedConnection;
+	}
+
+	m_sharedConnections.clear();
+
+	m_sharedConnectionsMutex.unlock();
+
 	delete m_server;
 	m_server = nullptr;
 }
@@ -91,19 +121,84 @@ void VncProxyServer::acceptConnection()
 			m_connectionFactory->createVncProxyConnection( m_server->nextPendingConnection(),
 														   m_vncServerPort,
 														   m_vncServerPassword,
-														   this );
+														   nullptr );
 
 	connect( connection, &VncProxyConnection::clientConnectionClosed, this, [=]() { closeConnection( connection ); } );
 	connect( connection, &VncProxyConnection::serverConnectionClosed, this, [=]() { closeConnection( connection ); } );
 
+	if( m_framebufferUpdateSharingEnabled )
+	{
+		connection->setProxyServer( this );
+	}
+
+	// all data of a connection (including its sockets) is processed in one thread
+	// of the connection pool so slow connections do not stall others
+	connection->moveToThread( m_connectionPool->acquireThread() );
+
 	m_connections += connection;
+
+	QMetaObject::invokeMethod( connection, "start", Qt::QueuedConnection );
+}
+
+
+
+VncSharedConnection* VncProxyServer::sharedConnection( const QByteArray& setPixelFormatMessage,
+														const QByteArray& setEncodingsMessage,
+														QThread** sharedConnectionThread )
+{
+	const auto key = setPixelFormatMessage + setEncodingsMessage;
+
+	QMutexLocker locker( &m_sharedConnectionsMutex );
+
+	auto sharedConnection = m_sharedConnections.value( key );
+	if( sharedConnection && sharedConnection->thread() != QThread::currentThread() )
+	{
+		// subscribers of a shared connection have to live in the same thread as
+		// framebuffer updates are written to their sockets directly
+		*sharedConnectionThread = sharedConnection->thread();
+		return nullptr;
+	}
+
+	if( sharedConnection == nullptr )
+	{
+		sharedConnection = new VncSharedConnection( m_vncServerPort, m_vncServerPassword,
+													setPixelFormatMessage, setEncodingsMessage, nullptr );
+
+		connect( sharedConnection, &VncSharedConnection::subscribersGone, sharedConnection, [=]() {
+			m_sharedConnectionsMutex.lock();
+			m_sharedConnections.remove( key );
+			m_sharedConnectionsMutex.unlock();
+
+			sharedConnection->deleteLater();
+		} );
+
+		m_sharedConnections[key] = sharedConnection;
+	}
+
+	return sharedConnection;
+}
+
+
+
+void VncProxyServer::moveConnectionToThread( VncProxyConnection* connection, QThread* thread )
+{
+	m_connectionPool->releaseThread( connection->thread() );
+	m_connectionPool->acquireThread( thread );
+
+	connection->moveToThread( thread );
 }
 
 
 
 void VncProxyServer::closeConnection( VncProxyConnection* connection )
 {
-	m_connections.removeAll( connection );
+	// both sockets of a connection might have been closed
+	if( m_connections.removeAll( connection ) == 0 )
+	{
+		return;
+	}
+
+	m_connectionPool->releaseThread( connection->thread() );
 
 	connection->deleteLater();
 }
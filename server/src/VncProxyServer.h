@@ -26,11 +26,16 @@
 #define VNC_PROXY_SERVER_H
 
 #include <QHostAddress>
+#include <QMap>
+#include <QMutex>
 #include <QVector>
 
 class QTcpServer;
+class QThread;
+class VncConnectionPool;
 class VncProxyConnection;
 class VncProxyConnectionFactory;
+class VncSharedConnection;
 
 class VncProxyServer : public QObject
 {
@@ -44,9 +49,31 @@ public:
 					QObject* parent = nullptr );
 	~VncProxyServer() override;
 
+	// number of threads connections are distributed across - has to be set before start()
+	void setThreadCount( int threadCount )
+	{
+		m_threadCount = threadCount;
+	}
+
 	void start( int vncServerPort, const QString& vncServerPassword );
 	void stop();
 
+	// let connections with identical pixel format and encodings receive
+	// framebuffer updates through a single shared VNC server connection
+	void setFramebufferUpdateSharingEnabled( bool enabled )
+	{
+		m_framebufferUpdateSharingEnabled = enabled;
+	}
+
+	// may be called from any connection thread - returns nullptr if the shared connection lives in a
+	// different thread, which the caller then has to move to as updates are written to subscribers directly
+	VncSharedConnection* sharedConnection( const QByteArray& setPixelFormatMessage,
+										   const QByteArray& setEncodingsMessage,
+										   QThread** sharedConnectionThread );
+
+	// has to be called from the current thread of the connection
+	void moveConnectionToThread( VncProxyConnection* connection, QThread* thread );
+
 	const VncProxyConnectionList& clients() const
 	{
 		return m_connections;
@@ -63,8 +90,14 @@ private:
 	int m_listenPort;
 	QTcpServer* m_server;
 	VncProxyConnectionFactory* m_connectionFactory;
+	int m_threadCount;
+	VncConnectionPool* m_connectionPool;
 	VncProxyConnectionList m_connections;
 
+	bool m_framebufferUpdateSharingEnabled;
+	QMutex m_sharedConnectionsMutex;
+	QMap<QByteArray, VncSharedConnection *> m_sharedConnections;
+
 } ;
 
 #endif
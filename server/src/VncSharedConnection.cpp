@@ -0,0 +1,395 @@
+/*
+ * VncSharedConnection.cpp - VNC server connection shared by multiple proxy connections
+ *
+ * Copyright (c) 2018 Tobias Junghans <tobydox@veyon.io>
+ *
+ * This file is part of Veyon - http://veyon.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include <QHostAddress>
+#include <QTcpSocket>
+#include <QtEndian>
+
+#include "VncSharedConnection.h"
+
+
+VncSharedConnection::VncSharedConnection( int vncServerPort, const QString& vncServerPassword,
+										  const QByteArray& setPixelFormatMessage,
+										  const QByteArray& setEncodingsMessage,
+										  QObject* parent ) :
+	QObject( parent ),
+	m_vncServerPort( vncServerPort ),
+	m_setPixelFormatMessage( setPixelFormatMessage ),
+	m_setEncodingsMessage( setEncodingsMessage ),
+	m_vncServerSocket( new QTcpSocket( this ) ),
+	m_vncClientProtocol( m_vncServerSocket, vncServerPassword ),
+	m_serverUpdateRequested( false ),
+	m_requestFullFramebufferUpdate( false ),
+	m_keyFrame( 0 ),
+	m_framebufferUpdateMessages(),
+	m_framebufferUpdateMessagesSize( 0 ),
+	m_subscribers()
+{
+	connect( m_vncServerSocket, &QTcpSocket::readyRead, this, &VncSharedConnection::readFromVncServer );
+	connect( m_vncServerSocket, &QTcpSocket::disconnected, this, &VncSharedConnection::reconnectToVncServer );
+
+	reconnectToVncServer();
+}
+
+
+
+VncSharedConnection::~VncSharedConnection()
+{
+	m_vncServerSocket->disconnect( this );
+
+	for( auto it = m_subscribers.constBegin(), end = m_subscribers.constEnd(); it != end; ++it )
+	{
+		it.key()->disconnect( this );
+	}
+
+	delete m_vncServerSocket;
+}
+
+
+
+void VncSharedConnection::subscribe( QTcpSocket* clientSocket )
+{
+	if( m_subscribers.contains( clientSocket ) )
+	{
+		return;
+	}
+
+	// start with the current key frame
+	Subscriber subscriber;
+	subscriber.keyFrame = -1;
+	subscriber.messageIndex = 0;
+	subscriber.updateRequested = false;
+
+	m_subscribers[clientSocket] = subscriber;
+
+	// continue sending pending updates as soon as client has received previous data
+	connect( clientSocket, &QTcpSocket::bytesWritten, this, [=]() { sendFramebufferUpdates( clientSocket ); } );
+}
+
+
+
+void VncSharedConnection::unsubscribe( QTcpSocket* clientSocket )
+{
+	if( m_subscribers.remove( clientSocket ) == 0 )
+	{
+		return;
+	}
+
+	clientSocket->disconnect( this );
+
+	if( m_subscribers.isEmpty() )
+	{
+		emit subscribersGone();
+	}
+}
+
+
+
+void VncSharedConnection::requestFramebufferUpdate( QTcpSocket* clientSocket, bool incremental )
+{
+	auto it = m_subscribers.find( clientSocket );
+	if( it == m_subscribers.end() )
+	{
+		return;
+	}
+
+	it->updateRequested = true;
+
+	if( incremental == false )
+	{
+		// start over with key frame as it covers the whole framebuffer
+		it->keyFrame = -1;
+	}
+
+	sendFramebufferUpdates( clientSocket );
+
+	requestFramebufferUpdateFromServer();
+}
+
+
+
+void VncSharedConnection::reconnectToVncServer()
+{
+	m_vncClientProtocol.start();
+
+	// updates from new connection must not be decoded with zlib stream state of previous connection
+	m_vncClientProtocol.resetTightZlibStreams();
+
+	m_serverUpdateRequested = false;
+
+	m_vncServerSocket->connectToHost( QHostAddress::LocalHost, m_vncServerPort );
+}
+
+
+
+void VncSharedConnection::readFromVncServer()
+{
+	if( m_vncClientProtocol.state() != VncClientProtocol::Running )
+	{
+		while( m_vncClientProtocol.read() ) // Flawfinder: ignore
+		{
+		}
+
+		if( m_vncClientProtocol.state() == VncClientProtocol::Running )
+		{
+			start();
+		}
+	}
+	else
+	{
+		while( receiveVncServerMessage() )
+		{
+		}
+	}
+}
+
+
+
+void VncSharedConnection::start()
+{
+	setVncServerPixelFormat();
+	setVncServerEncodings();
+
+	// initial update serves as key frame
+	m_requestFullFramebufferUpdate = false;
+	m_vncClientProtocol.requestFramebufferUpdate( false );
+	m_serverUpdateRequested = true;
+
+	while( receiveVncServerMessage() )
+	{
+	}
+}
+
+
+
+bool VncSharedConnection::setVncServerPixelFormat()
+{
+	if( m_setPixelFormatMessage.size() < sz_rfbSetPixelFormatMsg )
+	{
+		// subscribers use pixel format of server
+		return true;
+	}
+
+	rfbSetPixelFormatMsg setPixelFormatMessage;
+	memcpy( &setPixelFormatMessage, m_setPixelFormatMessage.constData(), sz_rfbSetPixelFormatMsg ); // Flawfinder: ignore
+
+	auto format = setPixelFormatMessage.format;
+	format.redMax = qFromBigEndian( format.redMax );
+	format.greenMax = qFromBigEndian( format.greenMax );
+	format.blueMax = qFromBigEndian( format.blueMax );
+
+	return m_vncClientProtocol.setPixelFormat( format );
+}
+
+
+
+bool VncSharedConnection::setVncServerEncodings()
+{
+	if( m_setEncodingsMessage.size() < sz_rfbSetEncodingsMsg )
+	{
+		// subscribers accept raw encoding only
+		return true;
+	}
+
+	rfbSetEncodingsMsg setEncodingsMessage;
+	memcpy( &setEncodingsMessage, m_setEncodingsMessage.constData(), sz_rfbSetEncodingsMsg ); // Flawfinder: ignore
+
+	const int nEncodings = qMin<int>( qFromBigEndian( setEncodingsMessage.nEncodings ),
+									  ( m_setEncodingsMessage.size() - sz_rfbSetEncodingsMsg ) / sizeof(uint32_t) );
+	const auto data = reinterpret_cast<const uchar *>( m_setEncodingsMessage.constData() + sz_rfbSetEncodingsMsg );
+
+	QVector<uint32_t> encodings;
+	encodings.reserve( nEncodings );
+
+	for( int i = 0; i < nEncodings; ++i )
+	{
+		const auto encoding = qFromBigEndian<uint32_t>( data + i * sizeof(uint32_t) );
+
+		switch( encoding )
+		{
+		case rfbEncodingZlib:
+		case rfbEncodingZlibHex:
+		case rfbEncodingZRLE:
+		case rfbEncodingZYWRLE:
+			// zlib streams of these encodings can't be reset so updates would never be
+			// decodable by subscribers which did not receive all previous updates
+			break;
+		default:
+			encodings.append( encoding );
+			break;
+		}
+	}
+
+	return m_vncClientProtocol.setEncodings( encodings );
+}
+
+
+
+bool VncSharedConnection::receiveVncServerMessage()
+{
+	if( m_vncClientProtocol.receiveMessage() == false )
+	{
+		return false;
+	}
+
+	// all other messages are received through each subscriber's own connection
+	if( m_vncClientProtocol.lastMessageType() == rfbFramebufferUpdate )
+	{
+		m_serverUpdateRequested = false;
+
+		enqueueFramebufferUpdateMessage( m_vncClientProtocol.lastMessage() );
+
+		sendFramebufferUpdatesToAll();
+		requestFramebufferUpdateFromServer();
+	}
+
+	return true;
+}
+
+
+
+void VncSharedConnection::enqueueFramebufferUpdateMessage( const QByteArray& message )
+{
+	const auto lastUpdatedRect = m_vncClientProtocol.lastUpdatedRect();
+
+	const bool isFullUpdate = lastUpdatedRect.x() == 0 && lastUpdatedRect.y() == 0 &&
+			lastUpdatedRect.width() == m_vncClientProtocol.framebufferWidth() &&
+			lastUpdatedRect.height() == m_vncClientProtocol.framebufferHeight();
+
+	// new subscribers start with the first message so it has to be decodable without any previous updates
+	if( isFullUpdate && m_vncClientProtocol.isLastUpdateSelfContained() )
+	{
+		++m_keyFrame;
+		m_framebufferUpdateMessages.clear();
+		m_framebufferUpdateMessagesSize = 0;
+	}
+
+	m_framebufferUpdateMessages.append( message );
+	m_framebufferUpdateMessagesSize += message.size();
+
+	if( m_framebufferUpdateMessagesSize > MessageListSizeLimit * 2 )
+	{
+		// still no key frame received so start over with a new connection whose initial update
+		// serves as key frame instead of dropping updates subscribers can't do without
+		m_vncServerSocket->disconnectFromHost();
+	}
+	else if( m_framebufferUpdateMessagesSize > MessageListSizeLimit )
+	{
+		// request a full update so we can clear our queue
+		m_requestFullFramebufferUpdate = true;
+	}
+}
+
+
+
+void VncSharedConnection::requestFramebufferUpdateFromServer()
+{
+	if( m_vncClientProtocol.state() != VncClientProtocol::Running || m_serverUpdateRequested )
+	{
+		return;
+	}
+
+	bool subscriberWaiting = false;
+	for( auto it = m_subscribers.constBegin(), end = m_subscribers.constEnd(); it != end; ++it )
+	{
+		subscriberWaiting |= it->updateRequested;
+	}
+
+	// do not let server encode anything as long as nobody is interested
+	if( subscriberWaiting == false )
+	{
+		return;
+	}
+
+	if( m_requestFullFramebufferUpdate )
+	{
+		if( m_vncClientProtocol.usesTightZlibStreams() )
+		{
+			// a key frame must be decodable without any previous updates however
+			// the server can't be told to reset its zlib streams so start over with a new connection
+			m_vncServerSocket->disconnectFromHost();
+			return;
+		}
+
+		m_vncClientProtocol.requestFramebufferUpdate( false );
+		m_requestFullFramebufferUpdate = false;
+	}
+	else
+	{
+		m_vncClientProtocol.requestFramebufferUpdate( true );
+	}
+
+	m_serverUpdateRequested = true;
+}
+
+
+
+void VncSharedConnection::sendFramebufferUpdates( QTcpSocket* clientSocket )
+{
+	auto it = m_subscribers.find( clientSocket );
+	if( it == m_subscribers.end() || it->updateRequested == false )
+	{
+		return;
+	}
+
+	auto& subscriber = *it;
+
+	const int framebufferUpdateMessageCount = m_framebufferUpdateMessages.count();
+
+	// lagging subscribers skip all updates superseded by a new key frame
+	if( subscriber.keyFrame != m_keyFrame ||
+			subscriber.messageIndex > framebufferUpdateMessageCount )
+	{
+		subscriber.keyFrame = m_keyFrame;
+		subscriber.messageIndex = 0;
+	}
+
+	bool sentUpdates = false;
+
+	// do not buffer more data than the client is able to receive in time
+	while( subscriber.messageIndex < framebufferUpdateMessageCount &&
+		   clientSocket->bytesToWrite() < MaximumBytesToWrite )
+	{
+		clientSocket->write( m_framebufferUpdateMessages[subscriber.messageIndex] );
+		++subscriber.messageIndex;
+		sentUpdates = true;
+	}
+
+	if( sentUpdates && subscriber.messageIndex >= framebufferUpdateMessageCount )
+	{
+		subscriber.updateRequested = false;
+	}
+}
+
+
+
+void VncSharedConnection::sendFramebufferUpdatesToAll()
+{
+	const auto clientSockets = m_subscribers.keys();
+
+	for( auto clientSocket : clientSockets )
+	{
+		sendFramebufferUpdates( clientSocket );
+	}
+}
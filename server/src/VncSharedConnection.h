@@ -0,0 +1,103 @@
+/*
+ * VncSharedConnection.h - VNC server connection shared by multiple proxy connections
+ *
+ * Copyright (c) 2018 Tobias Junghans <tobydox@veyon.io>
+ *
+ * This file is part of Veyon - http://veyon.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef VNC_SHARED_CONNECTION_H
+#define VNC_SHARED_CONNECTION_H
+
+#include <QMap>
+#include <QVector>
+
+#include "VncClientProtocol.h"
+
+class QTcpSocket;
+
+// receives framebuffer updates from the VNC server once and passes them on to all
+// subscribed proxy clients which requested the same pixel format and encodings -
+// like DemoServer it keeps a key frame and all subsequent updates so new or lagging
+// subscribers can start over without any further load on the VNC server
+class VncSharedConnection : public QObject
+{
+	Q_OBJECT
+public:
+	typedef QVector<QByteArray> MessageList;
+
+	VncSharedConnection( int vncServerPort, const QString& vncServerPassword,
+						 const QByteArray& setPixelFormatMessage, const QByteArray& setEncodingsMessage,
+						 QObject* parent );
+	~VncSharedConnection() override;
+
+	void subscribe( QTcpSocket* clientSocket );
+	void unsubscribe( QTcpSocket* clientSocket );
+
+	void requestFramebufferUpdate( QTcpSocket* clientSocket, bool incremental );
+
+signals:
+	void subscribersGone();
+
+private slots:
+	void reconnectToVncServer();
+	void readFromVncServer();
+
+private:
+	enum {
+		MessageListSizeLimit = 16*1024*1024,
+		MaximumBytesToWrite = 1024*1024
+	};
+
+	struct Subscriber {
+		int keyFrame;
+		int messageIndex;
+		bool updateRequested;
+	} ;
+
+	void start();
+	bool setVncServerPixelFormat();
+	bool setVncServerEncodings();
+
+	bool receiveVncServerMessage();
+	void enqueueFramebufferUpdateMessage( const QByteArray& message );
+	void requestFramebufferUpdateFromServer();
+
+	void sendFramebufferUpdates( QTcpSocket* clientSocket );
+	void sendFramebufferUpdatesToAll();
+
+	const int m_vncServerPort;
+	const QByteArray m_setPixelFormatMessage;
+	const QByteArray m_setEncodingsMessage;
+
+	QTcpSocket* m_vncServerSocket;
+	VncClientProtocol m_vncClientProtocol;
+
+	bool m_serverUpdateRequested;
+	bool m_requestFullFramebufferUpdate;
+
+	int m_keyFrame;
+	MessageList m_framebufferUpdateMessages;
+	qint64 m_framebufferUpdateMessagesSize;
+
+	QMap<QTcpSocket *, Subscriber> m_subscribers;
+
+} ;
+
+#endif
@@ -0,0 +1,279 @@
+/*
+ * VncThumbnailEncoder.cpp - implementation of the VncThumbnailEncoder class
+ *
+ * Copyright (c) 2018 Tobias Junghans <tobydox@veyon.io>
+ *
+ * This file is part of Veyon - http://veyon.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include <QtEndian>
+
+#include "ImageScaler.h"
+#include "VncThumbnailEncoder.h"
+
+
+VncThumbnailEncoder::VncThumbnailEncoder() :
+	m_framebuffer(),
+	m_framebufferValid( false ),
+	m_thumbnailSize(),
+	m_thumbnailSizeChanged( false ),
+	m_thumbnail(),
+	m_clientPixelFormat( nativePixelFormat() ),
+	m_changedRect()
+{
+}
+
+
+
+rfbPixelFormat VncThumbnailEncoder::nativePixelFormat()
+{
+	// pixel layout matching QImage::Format_RGB32 so raw data can be copied into the framebuffer image
+	rfbPixelFormat format;
+	format.bitsPerPixel = 32;
+	format.depth = 24;
+	format.bigEndian = Q_BYTE_ORDER == Q_BIG_ENDIAN ? 1 : 0;
+	format.trueColour = 1;
+	format.redMax = 0xff;
+	format.greenMax = 0xff;
+	format.blueMax = 0xff;
+	format.redShift = 16;
+	format.greenShift = 8;
+	format.blueShift = 0;
+	format.pad1 = 0;
+	format.pad2 = 0;
+
+	return format;
+}
+
+
+
+bool VncThumbnailEncoder::isPixelFormatSupported( const rfbPixelFormat& format )
+{
+	return format.bitsPerPixel == 32 && format.trueColour &&
+			format.redMax > 0 && format.greenMax > 0 && format.blueMax > 0;
+}
+
+
+
+void VncThumbnailEncoder::setFramebufferSize( int width, int height )
+{
+	m_framebuffer = QImage( width, height, QImage::Format_RGB32 );
+	m_framebuffer.fill( Qt::black );
+	m_framebufferValid = false;
+
+	invalidateThumbnail();
+}
+
+
+
+void VncThumbnailEncoder::setThumbnailSize( QSize size )
+{
+	if( size != m_thumbnailSize )
+	{
+		m_thumbnailSize = size;
+		m_thumbnailSizeChanged = true;
+	}
+}
+
+
+
+void VncThumbnailEncoder::invalidateThumbnail()
+{
+	m_changedRect = m_framebuffer.rect();
+}
+
+
+
+bool VncThumbnailEncoder::applyFramebufferUpdate( const QByteArray& message )
+{
+	if( message.size() < sz_rfbFramebufferUpdateMsg )
+	{
+		return false;
+	}
+
+	const auto data = message.constData();
+
+	rfbFramebufferUpdateMsg updateMessage;
+	memcpy( &updateMessage, data, sz_rfbFramebufferUpdateMsg ); // Flawfinder: ignore
+
+	const int nRects = qFromBigEndian( updateMessage.nRects );
+	int pos = sz_rfbFramebufferUpdateMsg;
+	bool needsFullUpdate = false;
+
+	for( int i = 0; i < nRects; ++i )
+	{
+		if( pos + sz_rfbFramebufferUpdateRectHeader > message.size() )
+		{
+			return false;
+		}
+
+		rfbFramebufferUpdateRectHeader rectHeader;
+		memcpy( &rectHeader, data + pos, sz_rfbFramebufferUpdateRectHeader ); // Flawfinder: ignore
+		pos += sz_rfbFramebufferUpdateRectHeader;
+
+		const auto encoding = qFromBigEndian( rectHeader.encoding );
+		const QRect rect( qFromBigEndian( rectHeader.r.x ), qFromBigEndian( rectHeader.r.y ),
+						  qFromBigEndian( rectHeader.r.w ), qFromBigEndian( rectHeader.r.h ) );
+
+		if( encoding == rfbEncodingLastRect )
+		{
+			break;
+		}
+
+		if( encoding == rfbEncodingNewFBSize )
+		{
+			setFramebufferSize( rect.width(), rect.height() );
+			needsFullUpdate = true;
+			continue;
+		}
+
+		// we only request raw encoding, however there might be updates with other encodings
+		// which have been requested before
+		if( encoding != rfbEncodingRaw )
+		{
+			return false;
+		}
+
+		const int bytesPerLine = rect.width() * 4;
+		if( pos + rect.height() * bytesPerLine > message.size() ||
+				m_framebuffer.rect().contains( rect ) == false )
+		{
+			return false;
+		}
+
+		for( int y = 0; y < rect.height(); ++y )
+		{
+			auto line = reinterpret_cast<QRgb *>( m_framebuffer.scanLine( rect.y() + y ) ) + rect.x();
+			memcpy( line, data + pos, bytesPerLine ); // Flawfinder: ignore
+			pos += bytesPerLine;
+
+			// RGB32 requires alpha channel to be set
+			for( int x = 0; x < rect.width(); ++x )
+			{
+				line[x] |= 0xff000000;
+			}
+		}
+
+		m_changedRect |= rect;
+	}
+
+	if( needsFullUpdate )
+	{
+		return false;
+	}
+
+	m_framebufferValid = true;
+
+	return true;
+}
+
+
+
+QByteArray VncThumbnailEncoder::encodeUpdate()
+{
+	if( hasChanges() == false || m_thumbnailSize.isEmpty() )
+	{
+		return QByteArray();
+	}
+
+	if( m_thumbnail.size() != m_thumbnailSize )
+	{
+		m_thumbnail = QImage( m_thumbnailSize, QImage::Format_RGB32 );
+		m_changedRect = m_framebuffer.rect();
+	}
+
+	// only rescale the area of the cached thumbnail affected by the changes
+	const auto changedThumbnailRect = ImageScaler::mapToDestination( m_changedRect, m_framebuffer.size(), m_thumbnailSize );
+	ImageScaler::scale( m_framebuffer, m_thumbnail, changedThumbnailRect );
+
+	const auto rect = m_thumbnailSizeChanged ? m_thumbnail.rect() : changedThumbnailRect;
+
+	const int rectCount = m_thumbnailSizeChanged ? 2 : 1;
+
+	QByteArray message( sz_rfbFramebufferUpdateMsg + rectCount * sz_rfbFramebufferUpdateRectHeader +
+						rect.width() * rect.height() * 4, 0 );
+	auto data = message.data();
+
+	rfbFramebufferUpdateMsg updateMessage;
+	updateMessage.type = rfbFramebufferUpdate;
+	updateMessage.pad = 0;
+	updateMessage.nRects = qToBigEndian<uint16_t>( rectCount );
+	memcpy( data, &updateMessage, sz_rfbFramebufferUpdateMsg ); // Flawfinder: ignore
+	data += sz_rfbFramebufferUpdateMsg;
+
+	rfbFramebufferUpdateRectHeader rectHeader;
+
+	if( m_thumbnailSizeChanged )
+	{
+		// tell client to resize its framebuffer to thumbnail size
+		rectHeader.encoding = qToBigEndian<uint32_t>( rfbEncodingNewFBSize );
+		rectHeader.r.x = 0;
+		rectHeader.r.y = 0;
+		rectHeader.r.w = qToBigEndian<uint16_t>( m_thumbnail.width() );
+		rectHeader.r.h = qToBigEndian<uint16_t>( m_thumbnail.height() );
+		memcpy( data, &rectHeader, sz_rfbFramebufferUpdateRectHeader ); // Flawfinder: ignore
+		data += sz_rfbFramebufferUpdateRectHeader;
+	}
+
+	rectHeader.encoding = qToBigEndian<uint32_t>( rfbEncodingRaw );
+	rectHeader.r.x = qToBigEndian<uint16_t>( rect.x() );
+	rectHeader.r.y = qToBigEndian<uint16_t>( rect.y() );
+	rectHeader.r.w = qToBigEndian<uint16_t>( rect.width() );
+	rectHeader.r.h = qToBigEndian<uint16_t>( rect.height() );
+	memcpy( data, &rectHeader, sz_rfbFramebufferUpdateRectHeader ); // Flawfinder: ignore
+	data += sz_rfbFramebufferUpdateRectHeader;
+
+	writePixels( data, m_thumbnail, rect );
+
+	m_changedRect = QRect();
+	m_thumbnailSizeChanged = false;
+
+	return message;
+}
+
+
+
+void VncThumbnailEncoder::writePixels( char* buffer, const QImage& image, const QRect& rect ) const
+{
+	const auto& format = m_clientPixelFormat;
+
+	for( int y = rect.top(); y <= rect.bottom(); ++y )
+	{
+		const auto line = reinterpret_cast<const QRgb *>( image.constScanLine( y ) );
+
+		for( int x = rect.left(); x <= rect.right(); ++x )
+		{
+			const auto pixel = line[x];
+			const uint32_t value = ( ( qRed( pixel ) * format.redMax / 255 ) << format.redShift ) |
+					( ( qGreen( pixel ) * format.greenMax / 255 ) << format.greenShift ) |
+					( ( qBlue( pixel ) * format.blueMax / 255 ) << format.blueShift );
+
+			if( format.bigEndian )
+			{
+				qToBigEndian<uint32_t>( value, reinterpret_cast<uchar *>( buffer ) );
+			}
+			else
+			{
+				qToLittleEndian<uint32_t>( value, reinterpret_cast<uchar *>( buffer ) );
+			}
+
+			buffer += 4;
+		}
+	}
+}
@@ -0,0 +1,98 @@
+/*
+ * VncThumbnailEncoder.h - header file for the VncThumbnailEncoder class
+ *
+ * Copyright (c) 2018 Tobias Junghans <tobydox@veyon.io>
+ *
+ * This file is part of Veyon - http://veyon.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef VNC_THUMBNAIL_ENCODER_H
+#define VNC_THUMBNAIL_ENCODER_H
+
+#include <QImage>
+#include <QRect>
+
+#include "rfb/rfbproto.h"
+
+/** \brief Maintains a copy of a framebuffer from raw updates and encodes downscaled updates of it
+ *
+ * The framebuffer has to be sent in nativePixelFormat() using raw encoding. Thumbnail updates
+ * are encoded as raw rects in the pixel format of the client, preceded by a NewFBSize rect
+ * whenever the thumbnail size changes.
+ */
+class VncThumbnailEncoder
+{
+public:
+	VncThumbnailEncoder();
+
+	static rfbPixelFormat nativePixelFormat();
+	static bool isPixelFormatSupported( const rfbPixelFormat& format );
+
+	void setFramebufferSize( int width, int height );
+
+	QSize framebufferSize() const
+	{
+		return m_framebuffer.size();
+	}
+
+	void setThumbnailSize( QSize size );
+
+	QSize thumbnailSize() const
+	{
+		return m_thumbnailSize;
+	}
+
+	void setClientPixelFormat( const rfbPixelFormat& format )
+	{
+		m_clientPixelFormat = format;
+	}
+
+	bool hasValidFramebuffer() const
+	{
+		return m_framebufferValid;
+	}
+
+	bool hasChanges() const
+	{
+		return m_framebufferValid && ( m_thumbnailSizeChanged || m_changedRect.isEmpty() == false );
+	}
+
+	void invalidateThumbnail();
+
+	bool applyFramebufferUpdate( const QByteArray& message );
+
+	QByteArray encodeUpdate();
+
+private:
+	void writePixels( char* buffer, const QImage& image, const QRect& rect ) const;
+
+	QImage m_framebuffer;
+	bool m_framebufferValid;
+
+	QSize m_thumbnailSize;
+	bool m_thumbnailSizeChanged;
+	QImage m_thumbnail;
+
+	rfbPixelFormat m_clientPixelFormat;
+
+	QRect m_changedRect;
+
+} ;
+
+#endif
@@ -70,7 +70,17 @@ void FeatureWorkerManagerConnection::receiveMessage()
 
 	while( featureMessage.isReadyForReceive() )
 	{
-		if( featureMessage.receive() )
+		if( featureMessage.receive() == false )
+		{
+			continue;
+		}
+
+		if( m_featureUid.isNull() && featureMessage.command() == FeatureMessage::InitCommand )
+		{
+			m_featureUid = featureMessage.featureUid();
+			emit featureAssigned( m_featureUid );
+		}
+		else
 		{
 			m_featureManager.handleFeatureMessage( m_worker, featureMessage );
 		}
@@ -41,6 +41,9 @@ public:
 									Feature::Uid featureUid,
 								 	QObject* parent = nullptr );
 
+signals:
+	// emitted once FeatureWorkerManager assigned a feature to a standby worker
+	void featureAssigned( const Feature::Uid& featureUid );
 
 private slots:
 	void sendInitMessage();
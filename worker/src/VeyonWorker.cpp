@@ -32,10 +32,32 @@
 VeyonWorker::VeyonWorker( const QString& featureUid, QObject* parent ) :
 	QObject( parent ),
 	m_core( QCoreApplication::instance(),
-			QStringLiteral( "FeatureWorker-" ) + VeyonCore::formattedUuid( featureUid ) ),
+			QStringLiteral( "FeatureWorker-" ) +
+			( featureUid.isEmpty() ? QStringLiteral( "Standby" ) : VeyonCore::formattedUuid( featureUid ) ) ),
 	m_builtinFeatures(),
 	m_featureManager(),
 	m_workerManagerConnection( nullptr )
+{
+	if( featureUid.isEmpty() )
+	{
+		m_workerManagerConnection = new FeatureWorkerManagerConnection( *this, m_featureManager, Feature::Uid(), this );
+
+		connect( m_workerManagerConnection, &FeatureWorkerManagerConnection::featureAssigned,
+				 this, &VeyonWorker::initFeature );
+
+		qInfo( "Running standby worker" );
+	}
+	else
+	{
+		initFeature( featureUid );
+
+		m_workerManagerConnection = new FeatureWorkerManagerConnection( *this, m_featureManager, featureUid, this );
+	}
+}
+
+
+
+void VeyonWorker::initFeature( const Feature::Uid& featureUid )
 {
 	const Feature* workerFeature = nullptr;
 
@@ -52,12 +74,10 @@ VeyonWorker::VeyonWorker( const QString& featureUid, QObject* parent ) :
 		qFatal( "Could not find specified feature" );
 	}
 
-	if( m_core.config().disabledFeatures().contains( featureUid ) )
+	if( m_core.config().disabledFeatures().contains( featureUid.toString() ) )
 	{
 		qFatal( "Specified feature is disabled by configuration!" );
 	}
 
-	m_workerManagerConnection = new FeatureWorkerManagerConnection( *this, m_featureManager, featureUid, this );
-
 	qInfo() << "Running worker for feature" << workerFeature->displayName();
 }
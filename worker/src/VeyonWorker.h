@@ -35,9 +35,12 @@ class VeyonWorker : public QObject, VeyonWorkerInterface
 {
 	Q_OBJECT
 public:
+	// empty feature UID makes worker wait for a feature to be assigned
 	VeyonWorker( const QString& featureUid, QObject* parent = nullptr );
 
 private:
+	void initFeature( const Feature::Uid& featureUid );
+
 	VeyonCore m_core;
 	BuiltinFeatures m_builtinFeatures;
 	FeatureManager m_featureManager;
@@ -24,6 +24,7 @@
 
 #include <QApplication>
 
+#include "FeatureWorkerManager.h"
 #include "VeyonWorker.h"
 
 
@@ -38,8 +39,13 @@ int main( int argc, char **argv )
 		qFatal( "Not enough arguments (feature)" );
 	}
 
-	const auto featureUid = arguments[1];
-	if( QUuid( featureUid ).isNull() )
+	auto featureUid = arguments[1];
+	if( featureUid == FeatureWorkerManager::standbyWorkerArgument() )
+	{
+		// feature is assigned by FeatureWorkerManager later on
+		featureUid.clear();
+	}
+	else if( QUuid( featureUid ).isNull() )
 	{
 		qFatal( "Invalid feature UID given" );
 	}